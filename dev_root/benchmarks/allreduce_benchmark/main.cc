@@ -297,11 +297,14 @@ int main(int argc, char* argv[]) {
     // Submit timed jobs
     std::cout << "Submitting " << tconf.num_jobs << " jobs." << std::endl;
     std::vector<unsigned long> durations_ns;
+    uint64_t submission_ns = 0; // Time spent inside AllReduceAsync which is the per job overhead paid by the submitting thread.
     std::chrono::time_point<switchml::clock> begin = switchml::clock::now();
     uint32_t jobs_before_sync = 0;
     for(uint32_t i = 0; i < tconf.num_jobs; i++) {
         if(stop) exit(EXIT_SUCCESS);
+        std::chrono::time_point<switchml::clock> submit_begin = switchml::clock::now();
         ctx.AllReduceAsync(src_data, dst_data, tconf.tensor_numel, switchml_data_type, switchml::AllReduceOperation::SUM);
+        submission_ns += std::chrono::duration_cast<std::chrono::nanoseconds>(switchml::clock::now() - submit_begin).count();
         jobs_before_sync++;
         if((i+1)%tconf.sync_every == 0) {
             ctx.WaitForAllJobs();
@@ -431,6 +434,11 @@ int main(int argc, char* argv[]) {
     double std_dev = sqrt(sq_sum / double(durations_ns.size()));
     std::cout << "Std dev " << std_dev << " ns" << std::endl;
 
+    // Per job overhead. With small tensors this is dominated by the cost of submitting and completing jobs.
+    // The durations only cover the jobs up to the last sync so the jobs after it are not counted.
+    std::cout << "Mean time per job " << sum / double(durations_ns.size() * tconf.sync_every) << " ns" << std::endl;
+    std::cout << "Mean submission time per job " << submission_ns / double(tconf.num_jobs) << " ns" << std::endl;
+
     // Cleanup
     std::cout << "Cleaning up." << std::endl;
     ctx.Stop();
@@ -315,8 +315,12 @@ int main(int argc, char* argv[]) {
             std::this_thread::sleep_for(std::chrono::nanoseconds(layer.backward_pass_ns));
             if(stop) exit(EXIT_SUCCESS);
             // Launch communication in the background.
+            // Each layer is submitted as soon as its gradients are ready so that its reduction overlaps with the rest of the backward pass.
+            // Schedulers only reorder the jobs of a batch so priorities would not change anything here.
             layer.allreduce_job = ctx.AllReduceAsync(layer.data, layer.data, layer.numel, switchml::DataType::FLOAT32, switchml::AllReduceOperation::SUM);
         }
+        // Dispatch the layers that the scheduler may still hold back (Ex. the 'fusion' scheduler) before the next forward pass waits on them.
+        ctx.Flush();
         if (i >= tconf.num_warmup) {
             end = switchml::clock::now();
             durations_ns.push_back(std::chrono::duration_cast<std::chrono::nanoseconds>(end - begin).count());
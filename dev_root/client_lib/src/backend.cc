@@ -63,6 +63,10 @@ std::unique_ptr<Backend> Backend::CreateInstance(Context& context, Config& confi
     LOG(FATAL) << "'" << backend << "' is not a valid backend.";
 }
 
+bool Backend::CanAbortJobs() const {
+    return false;
+}
+
 Backend::Backend(Context& context, Config& config) : 
     context_(context),
     config_(config) 
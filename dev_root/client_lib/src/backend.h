@@ -52,7 +52,7 @@ class Backend {
      */
     static std::unique_ptr<Backend> CreateInstance(Context& context, Config& config);
 
-    ~Backend() = default;
+    virtual ~Backend() = default;
     
     Backend(Backend const&) = delete;
     void operator=(Backend const&) = delete;
@@ -71,6 +71,16 @@ class Backend {
      * @see SetupWorker()
      */
     virtual void CleanupWorker() = 0;
+
+    /**
+     * @brief Whether the worker threads can drop the job slices of cancelled or timed out jobs (See Job::Cancel()).
+     * 
+     * Backends that reduce through the switch cannot since the other workers' packets are aggregated in the same
+     * switch slots and they would wait forever for the dropped packets.
+     * 
+     * @return false by default.
+     */
+    virtual bool CanAbortJobs() const;
   
   protected:
     /**
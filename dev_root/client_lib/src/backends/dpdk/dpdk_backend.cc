@@ -32,8 +32,11 @@
 
 namespace switchml {
 
+std::atomic<bool> DpdkBackend::setup_in_process_(false);
+
 DpdkBackend::DpdkBackend(Context& context, Config& config)
     : Backend(context, config),
+    switch_pool_partitions_(config.general_.num_worker_threads, SwitchPoolPartition{0, 0}),
     grpc_client_(config)
 {
     // Do nothing
@@ -50,6 +53,9 @@ void DpdkBackend::SetupWorker() {
 
     VLOG(0) << "Setting up worker.";
 
+    LOG_IF(FATAL, DpdkBackend::setup_in_process_.exchange(true)) << "The dpdk backend can only be used by a single context per process "
+        << "since DPDK's EAL can only be initialized once. Use the rdma backend to have multiple contexts in the same process.";
+
     // Parse worker addresses from config
 
     // The mac address cannot be retrieved until rte_eth_dev_configure() is called in the master thread.
@@ -156,4 +162,8 @@ std::vector<DpdkWorkerThread>& DpdkBackend::GetWorkerThreads() {
     return this->worker_threads_;
 }
 
+std::vector<DpdkBackend::SwitchPoolPartition>& DpdkBackend::GetSwitchPoolPartitions() {
+    return this->switch_pool_partitions_;
+}
+
 } // namespace switchml
\ No newline at end of file
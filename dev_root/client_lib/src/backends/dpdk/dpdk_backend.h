@@ -28,6 +28,7 @@
 #endif
 
 #include <memory>
+#include <atomic>
 
 #include <rte_ethdev.h>
 
@@ -99,6 +100,20 @@ class DpdkBackend : public switchml::Backend {
       uint16_t port;
     };
 
+    /**
+     * @brief The state of a worker thread's partition of the switch pool that must persist across job slices.
+     * 
+     * Each partition is statically owned by a worker thread (same index) along with the thread's RX/TX queues and UDP port.
+     * A worker thread that processes a stolen job slice uses the partition of the slice's owner instead of its own.
+     * The scheduler never gives job slices of the same partition to two worker threads at the same time.
+     */
+    struct SwitchPoolPartition {
+        /** Where the last job slice on this partition finished in the partition's pool indices. */
+        uint32_t switch_pool_index_shift;
+        /** The number of non empty job slices processed on this partition. Its 8 LSBs are used as the short_job_id. */
+        uint64_t job_slice_counter;
+    };
+
     /**
      * @brief Call the super class constructor.
      * 
@@ -164,6 +179,12 @@ class DpdkBackend : public switchml::Backend {
      * @return std::vector<DpdkWorkerThread> 
      */
     std::vector<DpdkWorkerThread>& GetWorkerThreads();
+
+    /**
+     * @brief Get the switch pool partitions indexed by the id of the worker thread that owns them.
+     * @return std::vector<SwitchPoolPartition>& 
+     */
+    std::vector<SwitchPoolPartition>& GetSwitchPoolPartitions();
   
   private:
 
@@ -173,6 +194,9 @@ class DpdkBackend : public switchml::Backend {
     /** Stores all of the dpdk worker threads */
     std::vector<DpdkWorkerThread> worker_threads_;
 
+    /** The switch pool partitions indexed by the id of the worker thread that owns them. */
+    std::vector<SwitchPoolPartition> switch_pool_partitions_;
+
     /** The switch end to end address in bytes with network endianness (Big endian) */
     struct E2eAddress switch_e2e_addr_be_;
 
@@ -187,6 +211,12 @@ class DpdkBackend : public switchml::Backend {
      * to create a UDP session on the switch
      */
     GrpcClient grpc_client_;
+
+    /**
+     * Whether a dpdk backend was already setup in this process.
+     * DPDK's EAL can only be initialized once per process so only one context can use the dpdk backend.
+     */
+    static std::atomic<bool> setup_in_process_;
 };
 
 } // namespace switchml
@@ -117,13 +117,13 @@ void DpdkMasterThread::operator()() {
     wts.reserve(num_cores);
     int i = 0;
     RTE_LCORE_FOREACH_SLAVE(lcore_id) {
-        wts.push_back(DpdkWorkerThread(this->context_, this->backend_, this->config_));
+        wts.push_back(DpdkWorkerThread(this->context_, this->backend_, this->config_, i));
         ret = rte_eal_remote_launch(LaunchDpdkWorkerThread, &wts[i], lcore_id);
         LOG_IF(ERROR, ret != 0) << "Core " << lcore_id << " returned " << ret ;
         i++;
     }
     // Run the last worker thread on this master thread core
-    wts.push_back(DpdkWorkerThread(this->context_, this->backend_, this->config_));
+    wts.push_back(DpdkWorkerThread(this->context_, this->backend_, this->config_, i));
     wts[i](); 
 
     // Wait for worker threads
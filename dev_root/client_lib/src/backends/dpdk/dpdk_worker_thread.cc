@@ -38,16 +38,15 @@
 
 namespace switchml {
 
-WorkerTid DpdkWorkerThread::next_tid_ = 0;
-
-DpdkWorkerThread::DpdkWorkerThread(Context& context, DpdkBackend& backend, Config& config) :
-    tid_(DpdkWorkerThread::next_tid_++),
+DpdkWorkerThread::DpdkWorkerThread(Context& context, DpdkBackend& backend, Config& config, WorkerTid worker_thread_id) :
+    tid_(worker_thread_id),
     context_(context),
     backend_(backend),
     config_(config),
     worker_thread_e2e_addr_be_(backend.GetWorkerE2eAddr()),
+    owner_tid_(tid_),
     lcore_id_(0), // will be correctly set when the thread starts
-    ppp_()
+    ppps_()
 #ifdef TIMEOUTS
     ,timer_cycles_(0)
 #endif
@@ -63,11 +62,10 @@ DpdkWorkerThread::~DpdkWorkerThread(){
 void DpdkWorkerThread::operator()() {
     int ret;
 
-    // Each worker thread has its own udp source ports
-    this->worker_thread_e2e_addr_be_.port = rte_cpu_to_be_16(
-                                                rte_be_to_cpu_16(this->worker_thread_e2e_addr_be_.port)
-                                                + this->tid_
-                                            );
+    // Each worker thread has its own udp source ports.
+    // The port is changed to the owner's port when working on a stolen job slice.
+    const uint16_t base_port = rte_be_to_cpu_16(this->worker_thread_e2e_addr_be_.port);
+    this->worker_thread_e2e_addr_be_.port = rte_cpu_to_be_16(base_port + this->tid_);
     this->lcore_id_ = rte_lcore_id();
 
     VLOG(0) << "Worker thread '" << this->tid_ << "' starting on core '" << this->lcore_id_ << "'";
@@ -81,8 +79,11 @@ void DpdkWorkerThread::operator()() {
     // The maximum number of outstanding packets for this worker.
     const uint64_t max_outstanding_pkts = genconf.max_outstanding_packets/genconf.num_worker_threads;
 
-    this->ppp_ = PrePostProcessor::CreateInstance(this->config_,
-                 this->tid_, genconf.packet_numel * DPDK_SWITCH_ELEMENT_SIZE, max_outstanding_pkts);
+    // One prepostprocessor for each job slice that the worker thread can have in flight.
+    for (int i = 0; i < 2; i++) {
+        this->ppps_[i] = PrePostProcessor::CreateInstance(this->config_,
+                         this->tid_, genconf.packet_numel * DPDK_SWITCH_ELEMENT_SIZE, max_outstanding_pkts);
+    }
 
     // Explaining switch pool / slot:
     // The switch can be thought of as a pool of slots (array of slots). Slots holds/adds the contents of
@@ -90,14 +91,15 @@ void DpdkWorkerThread::operator()() {
     // from the switch side we need to keep a shadow copy of each slot so now our switch's pool has doubled
     // in size or you can think of it as we now have two pools. Furthermore, each worker thread will only work on a
     // subset of the pool defined as [switch_pool_index_start, switch_pool_index_start + max outstanding packets for the worker thread * 2]
+    // (Or the subset of the owner worker thread when working on a stolen job slice).
     uint32_t switch_pool_size = max_outstanding_pkts * 2;
     uint32_t switch_pool_index_start = switch_pool_size * this->tid_;
 
     // For the switch to function properly we must always use an incremental pool index.
     // we cannot suddenly stop and start from pool index 0. This is due to some implementation detail in 
-    // our P4 program that is out of our scope here. So this shift keeps track of where the last job finished so that
-    // the new job can pick up from the next pool index.
-    uint32_t switch_pool_index_shift = 0;
+    // our P4 program that is out of our scope here. So the partition's switch_pool_index_shift keeps track of where the last job finished so that
+    // the new job can pick up from the next pool index. It lives in the backend since other worker threads can steal job slices of this partition.
+    std::vector<DpdkBackend::SwitchPoolPartition>& switch_pool_partitions = bk.GetSwitchPoolPartitions();
 
     // Create a mempool from which we will allocate the mbufs to transmit.  (Think of an mbuf as DPDK's representation of a packet)
     std::string tx_mempool_name = "wt" + std::to_string(this->tid_) + "_tx";
@@ -107,11 +109,13 @@ void DpdkWorkerThread::operator()() {
 
     // Allocate an array of mbuf pointers to store pointers to the mbufs we will transmit
     // We use rte_malloc_socket to make sure that the memory we are using is closest to the core we are using.
-    struct rte_mbuf **pkts_tx_burst = (rte_mbuf **) rte_malloc_socket(NULL, max_outstanding_pkts * sizeof(struct rte_mbuf*), RTE_CACHE_LINE_SIZE, rte_socket_id());
+    // Each of the two job slices that can be in flight gets its own half so that the first batch of the next job slice
+    // never overwrites an mbuf of the current one.
+    struct rte_mbuf **pkts_tx_burst = (rte_mbuf **) rte_malloc_socket(NULL, 2 * max_outstanding_pkts * sizeof(struct rte_mbuf*), RTE_CACHE_LINE_SIZE, rte_socket_id());
     LOG_IF(FATAL, pkts_tx_burst == NULL) << "Worker thread '" << this->tid_ << "' Cannot allocate pkts tx burst";
 
     // Allocate the actual mbufs that we will transmit.
-    ret = rte_pktmbuf_alloc_bulk(tx_mempool, pkts_tx_burst, max_outstanding_pkts);
+    ret = rte_pktmbuf_alloc_bulk(tx_mempool, pkts_tx_burst, 2 * max_outstanding_pkts);
     LOG_IF(FATAL, ret < 0) << "Worker thread '" << this->tid_ << "' Cannot allocate mbuf tx burst";
 
     // The tx buffer is used to buffer packets and group them up before sending them
@@ -158,131 +162,261 @@ void DpdkWorkerThread::operator()() {
         rte_timer_init(&timers[i]);
         resend_pkt_cb_args[i].dwt = this;
         resend_pkt_cb_args[i].tx_mempool = tx_mempool;
-        resend_pkt_cb_args[i].ppp = this->ppp_;
+        resend_pkt_cb_args[i].ppp = this->ppps_[0];
     }
 #endif
 
-    // The job slice struct that will be filled with the next job slice to work on.
-    JobSlice job_slice;
-    // Main worker thread loop
-    // This is where optimization is very important
-    while(ctx.GetContextState() == Context::ContextState::RUNNING) {
-        // Get a job slice
-        bool got_job_slice = ctx.GetJobSlice(this->tid_, job_slice);
-        if(!got_job_slice) {
-            continue;
-        }
-        DVLOG(2) << "Worker thread '" << this->tid_ << "' received job slice with job id: " << job_slice.job->id_ << " with numel: " << job_slice.slice.numel << ".";
-        if(unlikely(job_slice.slice.numel <=0 || this->config_.general_.instant_job_completion)) {
-            if(ctx.GetContextState() == Context::ContextState::RUNNING) {
-                DVLOG(2) << "Worker thread '" << this->tid_ << "' notifying job slice completion with job id: " << job_slice.job->id_  << ".";
-                ctx.NotifyJobSliceCompletion(this->tid_, job_slice);
-            }
-            continue;
+    // The current job slice and the next one which overlaps with the tail of the current one.
+    JobSliceState job_slice_states[2];
+    for (int i = 0; i < 2; i++) {
+        job_slice_states[i].ppp = this->ppps_[i];
+        job_slice_states[i].first_batch_mbufs = &pkts_tx_burst[i * max_outstanding_pkts];
+        job_slice_states[i].total_num_pkts = 0;
+    }
+    JobSliceState* current = &job_slice_states[0];
+    JobSliceState* next = &job_slice_states[1];
+    bool has_next = false;
+    uint16_t queue_id = this->owner_tid_;
+
+    // Initialize statistic variables.
+    // We found that using local variables for the inner loops speeds things up.
+    // We then push those local variables to the context statistics object at the end of each job slice.
+    uint64_t stats_wrong_pkts_received = 0;
+    uint64_t stats_correct_pkts_received = 0;
+    uint64_t stats_total_pkts_sent = 0;
+    uint16_t nb_tx;
+
+    // Setup the prepostprocessor, the bitmap, and the switch pool index shift of a job slice.
+    auto setup_job_slice_state = [&](JobSliceState& state) {
+        DVLOG(2) << "Worker thread '" << this->tid_ << "' received job slice with job id: " << state.job_slice.job->id_ << " with numel: " << state.job_slice.slice.numel << ".";
+        state.num_pkts_sent = 0;
+        state.num_received_pkts = 0;
+        state.progressive = state.job_slice.job->IsProgressive();
+        state.deferred_pkts.clear();
+        if(unlikely(state.job_slice.slice.numel <= 0 || this->config_.general_.instant_job_completion)) {
+            state.total_num_pkts = 0;
+            state.batch_num_pkts = 0;
+            return;
         }
+        DpdkBackend::SwitchPoolPartition& partition = switch_pool_partitions[this->owner_tid_];
+
+        // The 8 LSBs of the partition's job slice counter are used as the short_job_id in the packets' headers
+        // rather than the job id because the same partition can process consecutive slices of the same job
+        // (Ex. when using the chunked scheduler). All workers see the same sequence of job slices on each partition so the counters match.
+        state.short_job_id = partition.job_slice_counter++;
 
         // Setup the prepostprocessor and get the number of main packets that we will need to send.
-        uint64_t total_num_pkts = this->ppp_->SetupJobSlice(&job_slice);
+        state.total_num_pkts = state.ppp->SetupJobSlice(&state.job_slice);
 
         // We can logically divide all of the packets that we will send into 'max_outstanding_pkts' sized groups
         // (Or less in case the total number of packets was less than max_outsanding_pkts).
         // We call each of these groups a batch. So if max_outstanding_pkts=10 and we wanted to send 70 packets then we have 7 batches.
-        const uint64_t batch_num_pkts = std::min(max_outstanding_pkts, total_num_pkts);
+        state.batch_num_pkts = std::min(max_outstanding_pkts, state.total_num_pkts);
 
-        if(this->ppp_->NeedsExtraBatch()) {
-            total_num_pkts += batch_num_pkts;
+        if(state.ppp->NeedsExtraBatch()) {
+            state.total_num_pkts += state.batch_num_pkts;
         }
 
-        DVLOG(3) << "Worker thread '" << this->tid_ << "' will send a total of '" << total_num_pkts << "' packets";
+        // The job slice picks up the switch pool index where the previous one on this partition left off.
+        state.switch_pool_index_shift = partition.switch_pool_index_shift;
+        partition.switch_pool_index_shift = (partition.switch_pool_index_shift + state.total_num_pkts) % (2 * max_outstanding_pkts);
+
+        DVLOG(3) << "Worker thread '" << this->tid_ << "' will send a total of '" << state.total_num_pkts << "' packets";
 
         // Allocate a bitmap which will keep track of which packets have been received
-        uint32_t bitmap_size = rte_bitmap_get_memory_footprint(total_num_pkts);
+        uint32_t bitmap_size = rte_bitmap_get_memory_footprint(state.total_num_pkts);
         LOG_IF(FATAL,  unlikely(bitmap_size == 0)) << "Worker thread '" << this->tid_ << "' Could not get the memory footprint of the bitmap";
-        void* bitmap_mem = rte_zmalloc_socket("bitmap", bitmap_size, RTE_CACHE_LINE_SIZE, rte_socket_id());
-        LOG_IF(FATAL, unlikely(bitmap_mem == NULL)) << "Worker thread '" << this->tid_ << "' Failed to allocate bitmap.";
-        struct rte_bitmap* bitmap = rte_bitmap_init(total_num_pkts, static_cast<uint8_t*>(bitmap_mem), bitmap_size);
-        LOG_IF(FATAL, unlikely(bitmap == NULL)) << "Worker thread '" << this->tid_ << "' Failed to init bitmap.";
-        rte_bitmap_reset(bitmap);
+        state.bitmap_mem = rte_zmalloc_socket("bitmap", bitmap_size, RTE_CACHE_LINE_SIZE, rte_socket_id());
+        LOG_IF(FATAL, unlikely(state.bitmap_mem == NULL)) << "Worker thread '" << this->tid_ << "' Failed to allocate bitmap.";
+        state.bitmap = rte_bitmap_init(state.total_num_pkts, static_cast<uint8_t*>(state.bitmap_mem), bitmap_size);
+        LOG_IF(FATAL, unlikely(state.bitmap == NULL)) << "Worker thread '" << this->tid_ << "' Failed to init bitmap.";
+        rte_bitmap_reset(state.bitmap);
+    };
 
+#ifdef TIMEOUTS
+    // Start (or restart) the timer of an outstanding packet.
+    // Each outstanding packet is associated with the timer of the switch slot that it uses. Since a slot is never reused before
+    // the packet that used it last was received, no two outstanding packets share a timer even across job slices.
+    auto start_timer = [&](JobSliceState& state, uint32_t pkt_id, uint16_t switch_pool_index, uint64_t timer_cycles) {
+        uint32_t outstanding_pkt_index = (pkt_id + state.switch_pool_index_shift) % max_outstanding_pkts;
+
+        // Update the callback arguments for this packet
+        resend_pkt_cb_args[outstanding_pkt_index].job_id = state.short_job_id;
+        resend_pkt_cb_args[outstanding_pkt_index].switch_pool_index = switch_pool_index;
+        resend_pkt_cb_args[outstanding_pkt_index].pkt_id = pkt_id;
+        if (unlikely(resend_pkt_cb_args[outstanding_pkt_index].ppp != state.ppp)) {
+            resend_pkt_cb_args[outstanding_pkt_index].ppp = state.ppp;
+        }
 
-        // Initialize statistic variables.
-        // We found that using local variables for the inner loops speeds things up.
-        // We then push those local variables to the context statistics object at the end of each job.
-        uint64_t stats_wrong_pkts_received = 0;
-        uint64_t stats_correct_pkts_received = 0;
-        uint64_t stats_total_pkts_sent = 0;
+        // This call is responsible for the vast majority of the TIMEOUTS performance drop
+        // trying the async version did not help. The drop is consistent even with 0 timeouts.
+        rte_timer_reset_sync(&timers[outstanding_pkt_index], timer_cycles, PERIODICAL, this->lcore_id_, ResendPacketCallback,
+                &resend_pkt_cb_args[outstanding_pkt_index]);
+    };
+#endif
 
+    // Build one of the first batch packets of a job slice (Or reuse a received mbuf for a later packet) and add it to the tx buffer.
+    // The packet is deferred instead if its input is not ready yet.
+    auto send_pkt = [&](JobSliceState& state, uint32_t pkt_id, struct rte_mbuf* reused_mbuf) {
+        if(unlikely(state.progressive && !state.ppp->IsReady(pkt_id))) {
+            DVLOG(3) << "Worker thread '" << this->tid_ << "' Deferring packet short_job_id=" << (int) state.short_job_id << " pkt_id=" << pkt_id;
+            state.deferred_pkts.emplace_back(pkt_id, reused_mbuf);
+            return;
+        }
+        uint16_t switch_pool_index = PktId2PoolIndex(pkt_id,
+            switch_pool_index_start, state.switch_pool_index_shift, max_outstanding_pkts);
+        struct rte_mbuf* mbuf = reused_mbuf;
+        if(mbuf == NULL) {
+            mbuf = state.first_batch_mbufs[pkt_id];
+            rte_mbuf_refcnt_update(mbuf,1);
+            BuildPacket(mbuf, state.short_job_id, pkt_id, switch_pool_index, genconf.packet_numel,
+                        bk.GetSwitchE2eAddr(), this->worker_thread_e2e_addr_be_, state.ppp);
+        } else {
+            ReusePacket(mbuf, pkt_id, genconf.packet_numel, switch_pool_index, bk.GetSwitchE2eAddr(),
+                        this->worker_thread_e2e_addr_be_, state.ppp);
+        }
+        state.num_pkts_sent++;
+        nb_tx = rte_eth_tx_buffer(dpdkconf.port_id, queue_id, tx_buffer, mbuf);
+        stats_total_pkts_sent += nb_tx;
 #ifdef TIMEOUTS
-        this->timer_cycles_ = initial_timer_cycles; // cycles for 1 ms
+        start_timer(state, pkt_id, switch_pool_index, this->timer_cycles_);
 #endif
+    };
+
+    // Send the deferred packets of a job slice whose input became ready.
+    auto send_deferred_pkts = [&](JobSliceState& state) {
+        std::vector<std::pair<uint32_t, struct rte_mbuf*>> deferred_pkts;
+        std::swap(deferred_pkts, state.deferred_pkts);
+        for(const std::pair<uint32_t, struct rte_mbuf*>& deferred_pkt : deferred_pkts) {
+            send_pkt(state, deferred_pkt.first, deferred_pkt.second);
+        }
+    };
+
+    // Release the bitmap and the prepostprocessor, push the stats, and notify the ctx that the worker thread finished a job slice.
+    // If the context exited then the notify call will simply fail and set the job to failed.
+    auto finish_job_slice = [&](JobSliceState& state) {
+        // The job slice can only have deferred packets left if the context exited.
+        for(const std::pair<uint32_t, struct rte_mbuf*>& deferred_pkt : state.deferred_pkts) {
+            if(deferred_pkt.second != NULL) {
+                rte_pktmbuf_free(deferred_pkt.second);
+            }
+        }
+        state.deferred_pkts.clear();
+        if(likely(state.total_num_pkts != 0)) {
+            rte_bitmap_free(state.bitmap);
+            rte_free(state.bitmap_mem);
+            state.ppp->CleanupJobSlice();
+        }
 
-        // Create first batch of packets
-        DVLOG(3) << "Worker thread '" << this->tid_ << "' creating first batch";
-        uint64_t pkt_id = 0;
-        for (uint64_t j = 0; j < batch_num_pkts; j++) {
-            struct rte_mbuf* mbuf = pkts_tx_burst[j];
+        // Add the local stats to the context stats object.
+        ctx.GetStats().AddCorrectPktsReceived(this->tid_, stats_correct_pkts_received);
+        ctx.GetStats().AddTotalPktsSent(this->tid_, stats_total_pkts_sent);
+        ctx.GetStats().AddWrongPktsReceived(this->tid_, stats_wrong_pkts_received);
+        stats_wrong_pkts_received = 0;
+        stats_correct_pkts_received = 0;
+        stats_total_pkts_sent = 0;
 
-            // By default, when an mbuf is sent it is deallocated. However to avoid allocating
-            // mbufs everytime a new job slice is received, we increase the refcnt of the mbuf.
-            // now the mbuf will remain allocated even after it is sent and we can reuse it for
-            // the next first batch in the next job slice.
-            rte_mbuf_refcnt_update(mbuf,1);
+        // Finally notify the ctx that the worker thread finished this job slice.
+        DVLOG_IF(2, state.num_received_pkts == state.total_num_pkts) << "Worker thread '" << this->tid_ << "' notifying job slice completion with job id: " << state.job_slice.job->id_  << ".";
+        ctx.NotifyJobSliceCompletion(this->tid_, state.job_slice);
+    };
+
+    // Main worker thread loop
+    // This is where optimization is very important
+    while(ctx.GetContextState() == Context::ContextState::RUNNING) {
+        if(has_next) {
+            // The next job slice already started while the previous one was finishing.
+            std::swap(current, next);
+            has_next = false;
+        } else {
+            // Get a job slice
+            bool got_job_slice = ctx.GetJobSlice(this->tid_, current->job_slice);
+            if(!got_job_slice) {
+                continue;
+            }
 
-            uint16_t switch_pool_index = PktId2PoolIndex(pkt_id,
-                switch_pool_index_start, switch_pool_index_shift, max_outstanding_pkts);
+            // Switch to the owner's switch pool partition, queues, and port.
+            if(unlikely(current->job_slice.owner_tid != this->owner_tid_)) {
+                this->owner_tid_ = current->job_slice.owner_tid;
+                switch_pool_index_start = switch_pool_size * this->owner_tid_;
+                this->worker_thread_e2e_addr_be_.port = rte_cpu_to_be_16(base_port + this->owner_tid_);
+                queue_id = this->owner_tid_;
+            }
 
-            BuildPacket(mbuf, job_slice.job->id_, pkt_id, switch_pool_index, genconf.packet_numel,
-                        bk.GetSwitchE2eAddr(), this->worker_thread_e2e_addr_be_, this->ppp_);
-            pkt_id++;
+            setup_job_slice_state(*current);
 
 #ifdef TIMEOUTS
-            // The outstanding_pkt_index is just a way to associate each outstanding packet with a particular timer slot.
-            // For example: suppose that max_outstanding_pkts was 10 (that means we have 10 timers) and we want to send 50 packets.
-            // Then packet ids 0,10,20,30,40 will all use timer 0. But that is fine because we will not send packet 10 until packet 0 was recieved
-            // and we will not send packet 20 until packet 10 has been received and so on.
-            uint16_t outstanding_pkt_index = pkt_id % max_outstanding_pkts;
-
-            // Update the callback arguments for this packet
-            resend_pkt_cb_args[outstanding_pkt_index].job_id = job_slice.job->id_;
-            resend_pkt_cb_args[outstanding_pkt_index].switch_pool_index = switch_pool_index;
-            resend_pkt_cb_args[outstanding_pkt_index].pkt_id = pkt_id;
-
-            // We start the timout with some extra time because creating and sending the first batch will take some time
-            // We use the normal timer_cycles value later on.
-            rte_timer_reset_sync(&timers[outstanding_pkt_index], this->timer_cycles_ * max_outstanding_pkts, PERIODICAL, this->lcore_id_,
-                ResendPacketCallback, &resend_pkt_cb_args[outstanding_pkt_index]);
+            this->timer_cycles_ = initial_timer_cycles; // cycles for 1 ms
 #endif
-        }
 
-        // Send first batch
-        DVLOG(3) << "Worker thread '" << this->tid_ << "' sending first batch";
-        uint16_t nb_tx;
-        uint16_t num_sent_pkts = 0;
-        do {
-            nb_tx = rte_eth_tx_burst(dpdkconf.port_id, this->tid_, &pkts_tx_burst[num_sent_pkts], batch_num_pkts - num_sent_pkts);
-            num_sent_pkts += nb_tx;
-            DVLOG(3) << "Worker thread '" << this->tid_ << "' First batch sent " << nb_tx << "/" << batch_num_pkts << ".";
-        } while (num_sent_pkts < batch_num_pkts);
+            if(unlikely(current->progressive)) {
+                // The first batch packets of a job with progressive input are sent one by one as their input becomes ready.
+                for (uint32_t pkt_id = 0; pkt_id < current->batch_num_pkts; pkt_id++) {
+                    send_pkt(*current, pkt_id, NULL);
+                }
+            } else {
+                // Create first batch of packets
+                DVLOG(3) << "Worker thread '" << this->tid_ << "' creating first batch";
+                for (uint32_t pkt_id = 0; pkt_id < current->batch_num_pkts; pkt_id++) {
+                    struct rte_mbuf* mbuf = current->first_batch_mbufs[pkt_id];
+
+                    // By default, when an mbuf is sent it is deallocated. However to avoid allocating
+                    // mbufs everytime a new job slice is received, we increase the refcnt of the mbuf.
+                    // now the mbuf will remain allocated even after it is sent and we can reuse it for
+                    // the next first batch in the next job slice.
+                    rte_mbuf_refcnt_update(mbuf,1);
+
+                    uint16_t switch_pool_index = PktId2PoolIndex(pkt_id,
+                        switch_pool_index_start, current->switch_pool_index_shift, max_outstanding_pkts);
 
-        stats_total_pkts_sent += num_sent_pkts;
+                    BuildPacket(mbuf, current->short_job_id, pkt_id, switch_pool_index, genconf.packet_numel,
+                                bk.GetSwitchE2eAddr(), this->worker_thread_e2e_addr_be_, current->ppp);
 
-        // loop until all packets have been sent and received.
+#ifdef TIMEOUTS
+                    // We start the timout with some extra time because creating and sending the first batch will take some time
+                    // We use the normal timer_cycles value later on.
+                    start_timer(*current, pkt_id, switch_pool_index, this->timer_cycles_ * max_outstanding_pkts);
+#endif
+                }
+                current->num_pkts_sent = current->batch_num_pkts;
+
+                // Send first batch
+                DVLOG(3) << "Worker thread '" << this->tid_ << "' sending first batch";
+                uint16_t num_sent_pkts = 0;
+                while (num_sent_pkts < current->batch_num_pkts) {
+                    nb_tx = rte_eth_tx_burst(dpdkconf.port_id, queue_id, &current->first_batch_mbufs[num_sent_pkts], current->batch_num_pkts - num_sent_pkts);
+                    num_sent_pkts += nb_tx;
+                    DVLOG(3) << "Worker thread '" << this->tid_ << "' First batch sent " << nb_tx << "/" << current->batch_num_pkts << ".";
+                }
+
+                stats_total_pkts_sent += num_sent_pkts;
+            }
+        }
+
+        // loop until all packets of the current job slice have been sent and received.
         // This is where optimization is MOST important.
-        volatile uint32_t num_received_pkts = 0;
         uint16_t nb_rx;
         DVLOG(3) << "Worker thread '" << this->tid_ << "' entering receive send loop";
-        while (likely(num_received_pkts < total_num_pkts && ctx.GetContextState() == Context::ContextState::RUNNING)) {
+        while (likely(current->num_received_pkts < current->total_num_pkts && ctx.GetContextState() == Context::ContextState::RUNNING)) {
             // Read packet(s) from RX ring
-            nb_rx = rte_eth_rx_burst(dpdkconf.port_id, this->tid_, pkts_rx_burst, dpdkconf.burst_rx);
+            nb_rx = rte_eth_rx_burst(dpdkconf.port_id, queue_id, pkts_rx_burst, dpdkconf.burst_rx);
 
-            // Check if we should flush the tx buffer or retransmit anything.
+            // Check if we should send deferred packets, flush the tx buffer, or retransmit anything.
             // We only do that if we haven't received any packets in this iteration
             // so that we give strict priority to processing received packets over
             // sending new ones.
             if (unlikely(nb_rx == 0)) {
+                // Send the deferred packets whose input became ready.
+                if(unlikely(!current->deferred_pkts.empty() || (has_next && !next->deferred_pkts.empty()))) {
+                    send_deferred_pkts(*current);
+                    if(has_next) {
+                        send_deferred_pkts(*next);
+                    }
+                }
+
                 cur_tsc = rte_get_timer_cycles(); 
                 if(unlikely(cur_tsc - prev_tsc > drain_tsc)) {
-                    nb_tx = rte_eth_tx_buffer_flush(dpdkconf.port_id, this->tid_, tx_buffer);
+                    nb_tx = rte_eth_tx_buffer_flush(dpdkconf.port_id, queue_id, tx_buffer);
                     prev_tsc = cur_tsc;
                     stats_total_pkts_sent += nb_tx;
                 }
@@ -312,18 +446,23 @@ void DpdkWorkerThread::operator()() {
 
                 uint32_t pkt_id = switchml_hdr->pkt_id;
 
-                // Have we received this packet before ?
-                if(unlikely(rte_bitmap_get(bitmap, pkt_id) == 1)) {
-                    DVLOG(3) << "Worker thread '" << this->tid_ << "' Discarded duplicate packet short_job_id=" << (int) switchml_hdr->short_job_id
+                // Is this packet for the current job slice or for the next one ?
+                JobSliceState* state;
+                if(likely(switchml_hdr->short_job_id == (uint8_t) current->short_job_id)) {
+                    state = current;
+                } else if(has_next && next->total_num_pkts != 0 && switchml_hdr->short_job_id == (uint8_t) next->short_job_id) {
+                    state = next;
+                } else {
+                    DVLOG(3) << "Worker thread '" << this->tid_ << "' Discarded packet from wrong job. short_job_id=" << (int) switchml_hdr->short_job_id
                         << " pkt_id=" << pkt_id;
                     rte_pktmbuf_free(mbuf);
                     stats_wrong_pkts_received++;
                     continue;
                 }
 
-                // Is this packet for the current running job ?
-                if(unlikely(switchml_hdr->short_job_id != (uint8_t) job_slice.job->id_)) {
-                    DVLOG(3) << "Worker thread '" << this->tid_ << "' Discarded packet from wrong job. short_job_id=" << (int) switchml_hdr->short_job_id
+                // Have we received this packet before ?
+                if(unlikely(rte_bitmap_get(state->bitmap, pkt_id) == 1)) {
+                    DVLOG(3) << "Worker thread '" << this->tid_ << "' Discarded duplicate packet short_job_id=" << (int) switchml_hdr->short_job_id
                         << " pkt_id=" << pkt_id;
                     rte_pktmbuf_free(mbuf);
                     stats_wrong_pkts_received++;
@@ -335,82 +474,95 @@ void DpdkWorkerThread::operator()() {
 
                 int16_t* extra_info_ptr = reinterpret_cast<int16_t*>(switchml_hdr+1);
                 DpdkBackend::DpdkPacketElement* entries_ptr = reinterpret_cast<DpdkBackend::DpdkPacketElement*>(extra_info_ptr+1);
-                this->ppp_->PostprocessSingle(pkt_id, entries_ptr, extra_info_ptr);
+                state->ppp->PostprocessSingle(pkt_id, entries_ptr, extra_info_ptr);
 
-                num_received_pkts++;
+                state->num_received_pkts++;
 
-                rte_bitmap_set(bitmap, pkt_id); // Mark this packet as received in the bitmap
+                rte_bitmap_set(state->bitmap, pkt_id); // Mark this packet as received in the bitmap
 
                 stats_correct_pkts_received++;
 
-                // The next packet id of this mbuf (Or the packet that will use the same slot)
-                pkt_id += batch_num_pkts;
-
 #ifdef TIMEOUTS
-                uint32_t outstanding_pkt_index = pkt_id % max_outstanding_pkts;
-                rte_timer_stop_sync(&timers[outstanding_pkt_index]);
+                rte_timer_stop_sync(&timers[(pkt_id + state->switch_pool_index_shift) % max_outstanding_pkts]);
 #endif
 
+                // Packet 'pkt_id + max_outstanding_pkts - total_num_pkts' of the next job slice uses the switch slot that this packet just freed.
+                if (unlikely(has_next && state == current && pkt_id + max_outstanding_pkts >= current->total_num_pkts)) {
+                    uint32_t next_pkt_id = pkt_id + max_outstanding_pkts - current->total_num_pkts;
+                    if (next_pkt_id < next->batch_num_pkts) {
+                        send_pkt(*next, next_pkt_id, NULL);
+                    }
+                }
+
+                // The next packet id of this mbuf (Or the packet that will use the same slot)
+                pkt_id += state->batch_num_pkts;
+
                 // Free the mbuf and continue if there is no need to reuse it to send the next packet.
-                if (unlikely(pkt_id >= total_num_pkts)) {
+                if (unlikely(pkt_id >= state->total_num_pkts)) {
                     rte_pktmbuf_free(mbuf);
                     continue;
                 }
 
+                // Keep the mbuf until the input of the next packet is ready.
+                if (unlikely(state->progressive && !state->ppp->IsReady(pkt_id))) {
+                    send_pkt(*state, pkt_id, mbuf);
+                    continue;
+                }
+
                 // Reuse the mbuf for the next packet
                 DVLOG(3) << "Worker thread '" << this->tid_ << "' Reusing mbuf to send packet short_job_id=" << (int) switchml_hdr->short_job_id << " pkt_id=" << pkt_id;
 
-                uint16_t switch_pool_index = PktId2PoolIndex(pkt_id, switch_pool_index_start, switch_pool_index_shift, max_outstanding_pkts);
+                uint16_t switch_pool_index = PktId2PoolIndex(pkt_id, switch_pool_index_start, state->switch_pool_index_shift, max_outstanding_pkts);
                 ReusePacket(mbuf, pkt_id, genconf.packet_numel, switch_pool_index, bk.GetSwitchE2eAddr(),
-                            this->worker_thread_e2e_addr_be_, this->ppp_);
+                            this->worker_thread_e2e_addr_be_, state->ppp);
+                state->num_pkts_sent++;
 
                 // Send the packet
-                nb_tx = rte_eth_tx_buffer(dpdkconf.port_id, this->tid_, tx_buffer, mbuf);
+                nb_tx = rte_eth_tx_buffer(dpdkconf.port_id, queue_id, tx_buffer, mbuf);
                 if (nb_tx) {
                     stats_total_pkts_sent += nb_tx;
                     prev_tsc = cur_tsc;
                 }
 #ifdef TIMEOUTS
-                // Update resend packet callback args
-                resend_pkt_cb_args[outstanding_pkt_index].job_id = job_slice.job->id_;
-                resend_pkt_cb_args[outstanding_pkt_index].switch_pool_index = switch_pool_index;
-                resend_pkt_cb_args[outstanding_pkt_index].pkt_id = pkt_id;
-
                 // Start timer for this reused packet
-                // This call is responsible for the vast majority of the TIMEOUTS performance drop
-                // trying the async version did not help. The drop is consistent even with 0 timeouts.
-                rte_timer_reset_sync(&timers[outstanding_pkt_index], this->timer_cycles_, PERIODICAL, this->lcore_id_, ResendPacketCallback,
-                        &resend_pkt_cb_args[outstanding_pkt_index]);
+                start_timer(*state, pkt_id, switch_pool_index, this->timer_cycles_);
 #endif
             } // for (uint16_t j = 0; j < nb_rx; j++)
 
-            DVLOG(3) << "Worker thread '" << this->tid_ << "' received " << nb_rx << " packets. " << num_received_pkts << "/" << total_num_pkts << ".";
-
-        } // while (num_received_pkts < total_num_pkts && ctx.GetContextState() == Context::ContextState::RUNNING)
+            // Once all packets of the current job slice have been sent, start the next job slice if there is one
+            // so that it uses the switch slots that the tail of the current one frees up.
+            // The scheduler only gives a non blocking call a job slice with the same owner.
+            if (unlikely(!has_next && current->num_pkts_sent == current->total_num_pkts)
+                && ctx.GetJobSlice(this->tid_, next->job_slice, false)) {
+                DCHECK(next->job_slice.owner_tid == this->owner_tid_) << "Worker thread '" << this->tid_ << "' got a job slice of another owner to overlap with.";
+                has_next = true;
+                setup_job_slice_state(*next);
+                // Send the packets whose switch slots were never used or have already been freed by the current job slice.
+                for (uint32_t next_pkt_id = 0; next_pkt_id < next->batch_num_pkts; next_pkt_id++) {
+                    uint64_t slot_pkt_id = current->total_num_pkts + next_pkt_id;
+                    if (slot_pkt_id < max_outstanding_pkts || rte_bitmap_get(current->bitmap, slot_pkt_id - max_outstanding_pkts)) {
+                        send_pkt(*next, next_pkt_id, NULL);
+                    }
+                }
+            }
 
-        // Update switch shift for next job
-        switch_pool_index_shift = (switch_pool_index_shift + total_num_pkts) % (2 * max_outstanding_pkts);
+            DVLOG(3) << "Worker thread '" << this->tid_ << "' received " << nb_rx << " packets. " << current->num_received_pkts << "/" << current->total_num_pkts << ".";
 
-        rte_bitmap_free(bitmap);
-        rte_free(bitmap_mem);
+        } // while (current->num_received_pkts < current->total_num_pkts && ctx.GetContextState() == Context::ContextState::RUNNING)
 
-        this->ppp_->CleanupJobSlice();
+        finish_job_slice(*current);
 
-        // Add the local stats to the context stats object.
-        ctx.GetStats().AddCorrectPktsReceived(this->tid_, stats_correct_pkts_received);
-        ctx.GetStats().AddTotalPktsSent(this->tid_, stats_total_pkts_sent);
-        ctx.GetStats().AddWrongPktsReceived(this->tid_, stats_wrong_pkts_received);
-
-        // Finally notify the ctx that the worker thread finished this job slice.
-        // If the context exited then the notify call will simply fail and set the job to failed.
-        DVLOG_IF(2, num_received_pkts == total_num_pkts) << "Worker thread '" << this->tid_ << "' notifying job slice completion with job id: " << job_slice.job->id_  << ".";
-        ctx.NotifyJobSliceCompletion(this->tid_, job_slice);
+        // The next job slice will never get a chance to run if the context exited.
+        if(unlikely(has_next && ctx.GetContextState() != Context::ContextState::RUNNING)) {
+            finish_job_slice(*next);
+            has_next = false;
+        }
 
     } // while(ctx.GetContextState() == Context::ContextState::RUNNING)
 
     // Cleanup
     rte_free(pkts_rx_burst);
-    rte_pktmbuf_free_bulk(pkts_tx_burst, max_outstanding_pkts);
+    rte_pktmbuf_free_bulk(pkts_tx_burst, 2 * max_outstanding_pkts);
     rte_free(pkts_tx_burst);
     rte_free(tx_buffer);
     VLOG(0) << "Worker thread '" << this->tid_ << "' exiting.";
@@ -25,6 +25,9 @@
 
 #include <thread>
 #include <memory>
+#include <vector>
+#include <rte_mbuf.h>
+#include <rte_bitmap.h>
 
 #include "dpdk_backend.h"
 #include "common.h"
@@ -56,8 +59,9 @@ class DpdkWorkerThread{
      * @param [in] context a reference to the switchml context.
      * @param [in] backend a reference to the created dpdk backend.
      * @param [in] config a reference to the context configuration.
+     * @param [in] worker_thread_id the id of the worker thread within its context.
      */
-    DpdkWorkerThread(Context& context, DpdkBackend& backend, Config& config);
+    DpdkWorkerThread(Context& context, DpdkBackend& backend, Config& config, WorkerTid worker_thread_id);
 
     ~DpdkWorkerThread(); 
 
@@ -83,8 +87,6 @@ class DpdkWorkerThread{
      */
     friend void TxBufferCallback(struct rte_mbuf **pkts, uint16_t unsent, void *userdata);
 
-    /** Monotonically increasing counter to give unique IDs for each new worker thread **/
-    static WorkerTid next_tid_;
     /** A reference to the context */
     Context& context_;
     /** A reference to the context backend */
@@ -95,11 +97,56 @@ class DpdkWorkerThread{
     /** What this worker thread will use as the source address for packets. (Big endian) */
     DpdkBackend::E2eAddress worker_thread_e2e_addr_be_;
 
+    /**
+     * The worker thread that owns the job slice currently being worked on.
+     * Its switch pool partition, RX/TX queues, and UDP port are used for the job slice.
+     * This is the same as tid_ unless the job slice was stolen from another worker thread.
+     */
+    WorkerTid owner_tid_;
+
     /** Worker thread core id */
     uint16_t lcore_id_;
 
-    /** The prepostprocessor used by the worker thread */
-    std::shared_ptr<PrePostProcessor> ppp_;
+    /** The prepostprocessors used by the worker thread. One for each job slice that it can have in flight. */
+    std::shared_ptr<PrePostProcessor> ppps_[2];
+
+    /**
+     * @brief The state of a job slice that the worker thread is working on.
+     * 
+     * A worker thread can have two job slices in flight: the current one and the next one
+     * which it starts as soon as the tail of the current one frees up switch slots.
+     */
+    struct JobSliceState {
+        /** The job slice itself */
+        JobSlice job_slice;
+        /** The prepostprocessor used for this job slice */
+        std::shared_ptr<PrePostProcessor> ppp;
+        /** The preallocated mbufs used to send the first batch of this job slice */
+        struct rte_mbuf** first_batch_mbufs;
+        /** The memory of the bitmap */
+        void* bitmap_mem;
+        /** A bitmap which keeps track of which packets have been received */
+        struct rte_bitmap* bitmap;
+        /** The short job id used in the packets' headers */
+        JobId short_job_id;
+        /** The switch pool index shift of the first packet of this job slice */
+        uint32_t switch_pool_index_shift;
+        /** The total number of packets to send including the extra batch if any. 0 if there is nothing to send. */
+        uint64_t total_num_pkts;
+        /** The number of packets in the first batch */
+        uint64_t batch_num_pkts;
+        /** The number of packets sent so far excluding retransmissions */
+        uint64_t num_pkts_sent;
+        /** The number of packets received so far */
+        uint32_t num_received_pkts;
+        /** Whether the job has progressive input so packets must wait for their input to be ready (See Job::MarkReady()) */
+        bool progressive;
+        /**
+         * The packets that are waiting for their input to be ready.
+         * Each one holds the packet id and the received mbuf to reuse for it or NULL for a packet of the first batch.
+         */
+        std::vector<std::pair<uint32_t, struct rte_mbuf*>> deferred_pkts;
+    };
 
 #ifdef TIMEOUTS
     friend void ResendPacketCallback(struct rte_timer *timer, void *arg);
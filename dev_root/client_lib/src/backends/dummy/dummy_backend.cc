@@ -25,6 +25,7 @@
 #include <stdlib.h>
 
 #include <thread>
+#include <algorithm>
 
 #include "common_cc.h"
 #include "dummy_worker_thread.h"
@@ -49,7 +50,7 @@ DummyBackend::~DummyBackend() {
 void DummyBackend::SetupWorker() {
     VLOG(0) << "Setting up worker.";
     for(int i = 0; i < this->config_.general_.num_worker_threads; i++) {
-        this->worker_threads_.push_back(DummyWorkerThread(this->context_,*this, this->config_));
+        this->worker_threads_.push_back(DummyWorkerThread(this->context_,*this, this->config_, i));
         this->worker_threads_[i].Start();
     }
 }
@@ -61,6 +62,10 @@ void DummyBackend::CleanupWorker() {
     }
 }
 
+bool DummyBackend::CanAbortJobs() const {
+    return true;
+}
+
 void DummyBackend::SetupWorkerThread(WorkerTid worker_thread_id) {
     VLOG(0) << "Setting up worker thread '" << worker_thread_id << "'.";
 }
@@ -94,6 +99,16 @@ void DummyBackend::SendBurst(WorkerTid worker_thread_id, const std::vector<Dummy
     }
 }
 
+uint64_t DummyBackend::DropPackets(WorkerTid worker_thread_id, uint8_t short_job_id) {
+    std::vector<DummyPacket>& worker_thread_pending_packet = this->pending_packets_[worker_thread_id];
+    size_t num_pending_packets = worker_thread_pending_packet.size();
+    worker_thread_pending_packet.erase(std::remove_if(worker_thread_pending_packet.begin(), worker_thread_pending_packet.end(),
+        [short_job_id](const DummyPacket& pkt) { return pkt.short_job_id == short_job_id; }), worker_thread_pending_packet.end());
+    DVLOG(3) << "Worker thread '" << worker_thread_id << "' dropped '" << num_pending_packets - worker_thread_pending_packet.size()
+        << "' pending packets of short job id '" << (int) short_job_id << "'.";
+    return num_pending_packets - worker_thread_pending_packet.size();
+}
+
 void DummyBackend::ReceiveBurst(WorkerTid worker_thread_id, std::vector<DummyPacket>& packets_received) {
     std::vector<DummyPacket>& worker_thread_pending_packet = this->pending_packets_[worker_thread_id];
     CHECK(worker_thread_pending_packet.size() > 0) << "Worker thread '" << worker_thread_id
@@ -66,6 +66,12 @@ class DummyBackend : public switchml::Backend {
       uint64_t pkt_id;
       /** The identifier of the job from which this message came from */
       JobId job_id;
+      /** 
+       * A per worker thread job slice counter.
+       * Used to tell apart the packets of the two job slices that a worker thread can have in flight
+       * (They can belong to the same job).
+       */
+      uint8_t short_job_id;
       /** The number of elements in the packet */
       Numel numel;
       /** The data type of the elements */
@@ -101,6 +107,13 @@ class DummyBackend : public switchml::Backend {
      */
     void SetupWorker() override;
 
+    /**
+     * @brief The dummy backend does not use a switch so its worker threads can drop the job slices of any job.
+     * 
+     * @return true always.
+     */
+    bool CanAbortJobs() const override;
+
     /**
      * @brief Stops worker threads
      * @see SetupWorker()
@@ -145,6 +158,17 @@ class DummyBackend : public switchml::Backend {
      * @see SendBurst()
      */
     void ReceiveBurst(WorkerTid worker_thread_id, std::vector<DummyPacket>& packets_received);
+
+    /**
+     * @brief Drops the pending packets of a job slice specific to a worker thread.
+     * 
+     * Used when a job slice is abandoned so that its outstanding packets are never received.
+     * 
+     * @param [in] worker_thread_id The id of the calling worker thread.
+     * @param [in] short_job_id The short job id of the job slice whose packets should be dropped.
+     * @return uint64_t The number of dropped packets.
+     */
+    uint64_t DropPackets(WorkerTid worker_thread_id, uint8_t short_job_id);
   
   private:
     void ProcessPacket(DummyPacket& msg);
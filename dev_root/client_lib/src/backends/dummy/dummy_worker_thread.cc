@@ -34,15 +34,13 @@
 
 namespace switchml {
 
-WorkerTid DummyWorkerThread::next_tid_ = 0;
-
-DummyWorkerThread::DummyWorkerThread(Context& context, DummyBackend& backend, Config& config) :
-    tid_(DummyWorkerThread::next_tid_++),
+DummyWorkerThread::DummyWorkerThread(Context& context, DummyBackend& backend, Config& config, WorkerTid worker_thread_id) :
+    tid_(worker_thread_id),
     context_(context),
     backend_(backend),
     config_(config),
     thread_(nullptr),
-    ppp_()
+    ppps_()
 {
     // Do nothing
 }
@@ -59,71 +57,176 @@ void DummyWorkerThread::operator()() {
     const GeneralConfig& genconf = this->config_.general_;
     // The maximum number of outstanding packets for this worker.
     const uint64_t max_outstanding_pkts = genconf.max_outstanding_packets/genconf.num_worker_threads;
-    this->ppp_ = PrePostProcessor::CreateInstance(this->config_, this->tid_, genconf.packet_numel*DUMMY_ELEMENT_SIZE, max_outstanding_pkts);
+    // Whether the job slices of cancelled or timed out jobs can be dropped.
+    const bool can_abort_jobs = backend.CanAbortJobs();
     
     backend.SetupWorkerThread(this->tid_);
 
-    // Buffers to hold the data that's supposed to be outstanding.
-    void* outstanding_entries = malloc(max_outstanding_pkts*genconf.packet_numel*DUMMY_ELEMENT_SIZE);
-    void* outstanding_extra_info = malloc(max_outstanding_pkts*2); // 2 bytes extra info for each packet
-
-    // The job slice struct that will be filled with the next job slice to work on.
-    JobSlice job_slice;
-    // Main worker thread loop
-    while(ctx.GetContextState() == Context::ContextState::RUNNING) {
-        // Get a job slice
-        bool got_job_slice = ctx.GetJobSlice(this->tid_, job_slice);
-        if(!got_job_slice) {
-            continue;
+    // The current job slice and the next one which overlaps with the tail of the current one.
+    JobSliceState job_slice_states[2];
+    for(int i = 0; i < 2; i++) {
+        this->ppps_[i] = PrePostProcessor::CreateInstance(this->config_, this->tid_, genconf.packet_numel*DUMMY_ELEMENT_SIZE, max_outstanding_pkts);
+        job_slice_states[i].ppp = this->ppps_[i];
+        // Buffers to hold the data that's supposed to be outstanding.
+        job_slice_states[i].outstanding_entries = malloc(max_outstanding_pkts*genconf.packet_numel*DUMMY_ELEMENT_SIZE);
+        job_slice_states[i].outstanding_extra_info = malloc(max_outstanding_pkts*2); // 2 bytes extra info for each packet
+    }
+    JobSliceState* current = &job_slice_states[0];
+    JobSliceState* next = &job_slice_states[1];
+    bool has_next = false;
+    uint8_t job_slice_counter = 0;
+
+    // Setup the prepostprocessor and compute the number of packets that we will need to send for a job slice.
+    auto setup_job_slice_state = [&](JobSliceState& state) {
+        DVLOG(2) << "Worker thread '" << this->tid_ << "' received job slice with job id: " << state.job_slice.job->id_ << " with numel: " << state.job_slice.slice.numel << ".";
+        state.short_job_id = job_slice_counter++;
+        state.num_pkts_sent = 0;
+        state.num_pkts_received = 0;
+        state.progressive = state.job_slice.job->IsProgressive();
+        state.deferred_pkts.clear();
+        // The slices of cancelled or timed out jobs are skipped without sending anything.
+        if(state.job_slice.slice.numel <= 0 || this->config_.general_.instant_job_completion || (can_abort_jobs && state.job_slice.job->CheckAborted())) {
+            state.total_num_pkts = 0;
+            state.batch_num_pkts = 0;
+            return;
         }
-        DVLOG(2) << "Worker thread '" << this->tid_ << "' received job slice with job id: " << job_slice.job->id_ << " with numel: " << job_slice.slice.numel << ".";
-
-        if(job_slice.slice.numel <=0 || this->config_.general_.instant_job_completion) {
-            if(ctx.GetContextState() == Context::ContextState::RUNNING) {
-                DVLOG(2) << "Worker thread '" << this->tid_ << "' notifying job slice completion with job id: " << job_slice.job->id_  << ".";
-                ctx.NotifyJobSliceCompletion(this->tid_, job_slice);
-            }
-            continue;
-        }
-
-        // Setup the prepostprocessor and get the number of main packets that we will need to send.
-        uint64_t total_num_pkts = this->ppp_->SetupJobSlice(&job_slice);
+        state.total_num_pkts = state.ppp->SetupJobSlice(&state.job_slice);
 
         // We can logically divide all of the packets that we will send into 'max_outstanding_pkts' sized groups
         // (Or less in case the total number of packets was less than max_outsanding_pkts).
         // We call each of these groups a batch. So if max_outstanding_pkts=10 and we wanted to send 70 packets then we have 7 batches.
-        uint64_t batch_num_pkts = std::min(max_outstanding_pkts, total_num_pkts);
+        state.batch_num_pkts = std::min(max_outstanding_pkts, state.total_num_pkts);
 
-        if(this->ppp_->NeedsExtraBatch()) {
-            total_num_pkts += batch_num_pkts;
+        if(state.ppp->NeedsExtraBatch()) {
+            state.total_num_pkts += state.batch_num_pkts;
+        }
+        state.received_pkts.assign(state.total_num_pkts, false);
+
+        DVLOG(3) << "Worker thread '" << this->tid_ << "' will send a total of '" << state.total_num_pkts << "' packets each having '" << genconf.packet_numel << " elements.";
+    };
+
+    // Create a packet of a job slice and add it to the packets to send.
+    // The packet is deferred instead if its input is not ready yet.
+    auto create_packet = [&](JobSliceState& state, uint64_t pkt_id, std::vector<DummyBackend::DummyPacket>& packets_to_send) {
+        if(state.progressive && !state.ppp->IsReady(pkt_id)) {
+            DVLOG(3) << "Worker thread '" << this->tid_ << "' deferring packet '" << pkt_id << "' of job id: " << state.job_slice.job->id_ << ".";
+            state.deferred_pkts.push_back(pkt_id);
+            return;
+        }
+        DVLOG(3) << "Worker thread '" << this->tid_ << "' creating packet '" << pkt_id << "' of job id: " << state.job_slice.job->id_ << ".";
+        struct DummyBackend::DummyPacket pkt;
+        pkt.pkt_id = pkt_id;
+        pkt.job_id = state.job_slice.job->id_;
+        pkt.short_job_id = state.short_job_id;
+        pkt.numel = genconf.packet_numel;
+        pkt.data_type = state.job_slice.slice.data_type;
+        // Compute pointers to the entries and extra info outstanding buffers
+        pkt.entries_ptr = (void*) (((uintptr_t) state.outstanding_entries) + (pkt.pkt_id % state.batch_num_pkts) * DataTypeSize(pkt.data_type) * genconf.packet_numel);
+        pkt.extra_info_ptr = (void*) (((uintptr_t) state.outstanding_extra_info) + (pkt.pkt_id % state.batch_num_pkts) * 2);
+        state.ppp->PreprocessSingle(pkt.pkt_id, pkt.entries_ptr , pkt.extra_info_ptr);
+        state.num_pkts_sent++;
+        packets_to_send.push_back(pkt);
+    };
+
+    // Send a group of packets.
+    auto send_packets = [&](const std::vector<DummyBackend::DummyPacket>& packets_to_send) {
+        if(packets_to_send.size() == 0) {
+            return;
+        }
+        DVLOG(3) << "Worker thread '" << this->tid_ << "' sending '" << packets_to_send.size() << "' packets.";
+        backend.SendBurst(this->tid_, packets_to_send);
+        ctx.GetStats().AddTotalPktsSent(this->tid_, packets_to_send.size());
+    };
+
+    // Create the deferred packets of a job slice whose input became ready.
+    auto create_deferred_packets = [&](JobSliceState& state, std::vector<DummyBackend::DummyPacket>& packets_to_send) {
+        std::vector<uint64_t> deferred_pkts;
+        std::swap(deferred_pkts, state.deferred_pkts);
+        for(uint64_t pkt_id : deferred_pkts) {
+            create_packet(state, pkt_id, packets_to_send);
         }
+    };
+
+    // Drop the outstanding packets of the current job slice once its job was cancelled or timed out.
+    // The next job slice then gets the outstanding packets that it was waiting for.
+    auto abandon_job_slice = [&]() {
+        DVLOG(2) << "Worker thread '" << this->tid_ << "' abandoning job slice with job id: " << current->job_slice.job->id_ << ".";
+        backend.DropPackets(this->tid_, current->short_job_id);
+        current->deferred_pkts.clear();
+        if(has_next) {
+            std::vector<DummyBackend::DummyPacket> packets_to_send;
+            for(uint64_t next_pkt_id = 0; next_pkt_id < next->batch_num_pkts; next_pkt_id++) {
+                uint64_t slot_pkt_id = current->total_num_pkts + next_pkt_id;
+                if(slot_pkt_id >= max_outstanding_pkts && !current->received_pkts[slot_pkt_id - max_outstanding_pkts]) {
+                    create_packet(*next, next_pkt_id, packets_to_send);
+                }
+            }
+            send_packets(packets_to_send);
+        }
+    };
 
-        DVLOG(3) << "Worker thread '" << this->tid_ << "' will send a total of '" << total_num_pkts << "' packets each having '" << genconf.packet_numel << " elements.";
+    // Release the prepostprocessor and notify the ctx that the worker thread finished a job slice.
+    // If the context exited then the notify call will simply fail and set the job to failed.
+    auto finish_job_slice = [&](JobSliceState& state) {
+        if(state.total_num_pkts != 0) {
+            state.ppp->CleanupJobSlice();
+        }
+        DVLOG_IF(2, state.num_pkts_received == state.total_num_pkts) << "Worker thread '" << this->tid_ << "' notifying job slice completion with job id: " << state.job_slice.job->id_  << ".";
+        ctx.NotifyJobSliceCompletion(this->tid_, state.job_slice);
+    };
 
-        // Create first batch of packets
+    // Main worker thread loop
+    while(ctx.GetContextState() == Context::ContextState::RUNNING) {
         std::vector<DummyBackend::DummyPacket> first_batch_pkts;
-        first_batch_pkts.reserve(batch_num_pkts);
-        for(uint64_t i = 0, elements_finished = 0; i < batch_num_pkts; i++, elements_finished += genconf.packet_numel) {
-            struct DummyBackend::DummyPacket pkt;
-            pkt.pkt_id = i;
-            pkt.job_id = job_slice.job->id_;
-            pkt.numel = genconf.packet_numel;
-            pkt.data_type = job_slice.slice.data_type;
-            pkt.entries_ptr = (void*) (((uintptr_t) outstanding_entries) + (pkt.pkt_id % batch_num_pkts) * DataTypeSize(pkt.data_type) * genconf.packet_numel);
-            pkt.extra_info_ptr = (void*) (((uintptr_t) outstanding_extra_info) + (pkt.pkt_id % batch_num_pkts) * 2);
-            this->ppp_->PreprocessSingle(pkt.pkt_id, pkt.entries_ptr , pkt.extra_info_ptr);
-            first_batch_pkts.push_back(pkt);
-        }
+        if(has_next) {
+            // The next job slice already sent its first batch while the previous one was finishing.
+            std::swap(current, next);
+            has_next = false;
+        } else {
+            // Get a job slice
+            bool got_job_slice = ctx.GetJobSlice(this->tid_, current->job_slice);
+            if(!got_job_slice) {
+                continue;
+            }
+            setup_job_slice_state(*current);
 
-        // Send first batch
-        DVLOG(3) << "Worker thread '" << this->tid_ << "' will send the first '" << first_batch_pkts.size() << "' packets";
-        backend.SendBurst(this->tid_, first_batch_pkts);
-        ctx.GetStats().AddTotalPktsSent(this->tid_, first_batch_pkts.size());
+            // Create and send first batch of packets
+            first_batch_pkts.reserve(current->batch_num_pkts);
+            for(uint64_t i = 0; i < current->batch_num_pkts; i++) {
+                create_packet(*current, i, first_batch_pkts);
+            }
+            DVLOG(3) << "Worker thread '" << this->tid_ << "' will send the first '" << first_batch_pkts.size() << "' packets";
+            send_packets(first_batch_pkts);
+        }
 
-        // loop until all packets have been sent and received.
+        // loop until all packets of the current job slice have been sent and received.
         DVLOG(3) << "Worker thread '" << this->tid_ << "' is starting the receive and send loop";
-        uint64_t num_packets_received = 0; 
-        while(num_packets_received != total_num_pkts && ctx.GetContextState() == Context::ContextState::RUNNING) {
+        while(current->num_pkts_received != current->total_num_pkts && ctx.GetContextState() == Context::ContextState::RUNNING) {
+            if(can_abort_jobs && current->job_slice.job->CheckAborted()) {
+                abandon_job_slice();
+                break;
+            }
+
+            // Send the deferred packets whose input became ready.
+            if(!current->deferred_pkts.empty() || (has_next && !next->deferred_pkts.empty())) {
+                std::vector<DummyBackend::DummyPacket> ready_packets;
+                create_deferred_packets(*current, ready_packets);
+                if(has_next) {
+                    create_deferred_packets(*next, ready_packets);
+                }
+                send_packets(ready_packets);
+            }
+
+            // There is nothing to receive while all of the remaining packets wait for their input.
+            uint64_t num_outstanding_pkts = current->num_pkts_sent - current->num_pkts_received;
+            if(has_next) {
+                num_outstanding_pkts += next->num_pkts_sent - next->num_pkts_received;
+            }
+            if(num_outstanding_pkts == 0) {
+                std::this_thread::yield();
+                continue;
+            }
+
             // Receive group of packets
             std::vector<DummyBackend::DummyPacket> received_packets;
             backend.ReceiveBurst(this->tid_, received_packets);
@@ -133,9 +236,6 @@ void DummyWorkerThread::operator()() {
                 continue;
             }
             ctx.GetStats().AddCorrectPktsReceived(this->tid_, received_packets.size());
-            num_packets_received += received_packets.size();
-            DVLOG(3) << "Worker thread '" << this->tid_ << "' received '" << received_packets.size()
-                << "' packets. Total received '" << num_packets_received << "/" << total_num_pkts << "'.";
 
             // Create next group of packets to send including retransmissions.
             std::vector<DummyBackend::DummyPacket> packets_to_send;
@@ -143,51 +243,68 @@ void DummyWorkerThread::operator()() {
             // Add new packets corresponding to received packets
             for(uint64_t i = 0; i < received_packets.size(); i++) {
                 struct DummyBackend::DummyPacket pkt = received_packets.at(i);
-                DVLOG(3) << "Worker thread '" << this->tid_ << "' retrieved packet '" << pkt.pkt_id << "'.";
-
-                this->ppp_->PostprocessSingle(pkt.pkt_id, pkt.entries_ptr, pkt.extra_info_ptr);
+                JobSliceState& state = pkt.short_job_id == current->short_job_id ? *current : *next;
+                DVLOG(3) << "Worker thread '" << this->tid_ << "' retrieved packet '" << pkt.pkt_id << "' of job id: " << pkt.job_id << ".";
+
+                state.ppp->PostprocessSingle(pkt.pkt_id, pkt.entries_ptr, pkt.extra_info_ptr);
+                state.received_pkts[pkt.pkt_id] = true;
+                state.num_pkts_received++;
+
+                // Packet 'pkt_id + max_outstanding_pkts - total' of the next job slice uses the slot that this packet just freed.
+                if(has_next && &state == current && pkt.pkt_id + max_outstanding_pkts >= current->total_num_pkts) {
+                    uint64_t next_pkt_id = pkt.pkt_id + max_outstanding_pkts - current->total_num_pkts;
+                    if(next_pkt_id < next->batch_num_pkts) {
+                        create_packet(*next, next_pkt_id, packets_to_send);
+                    }
+                }
 
                 // What's the next pkt id if we were to reuse this packet?
-                pkt.pkt_id += batch_num_pkts;
+                pkt.pkt_id += state.batch_num_pkts;
 
                 // Do we need to reuse the packet?
-                if(pkt.pkt_id >= total_num_pkts) {
+                if(pkt.pkt_id >= state.total_num_pkts) {
                     continue;
                 }
-                DVLOG(3) << "Worker thread '" << this->tid_ << "' creating packet '" << pkt.pkt_id << "'.";
-
-                // Compute pointers to the entries and extra info outstanding buffers
-                pkt.entries_ptr = (void*) (((uintptr_t) outstanding_entries) + (pkt.pkt_id % batch_num_pkts) * DataTypeSize(pkt.data_type) * genconf.packet_numel);
-                pkt.extra_info_ptr = (void*) (((uintptr_t) outstanding_extra_info) + (pkt.pkt_id % batch_num_pkts) * 2);
-
-                this->ppp_->PreprocessSingle(pkt.pkt_id, pkt.entries_ptr , pkt.extra_info_ptr);
-
-                packets_to_send.push_back(pkt);
+                create_packet(state, pkt.pkt_id, packets_to_send);
             }
 
-            if(packets_to_send.size() == 0) {
-                continue;
+            // Once all packets of the current job slice have been sent, start the next job slice if there is one
+            // so that it uses the outstanding packets that the tail of the current one frees up.
+            if(!has_next && current->num_pkts_sent == current->total_num_pkts && ctx.GetJobSlice(this->tid_, next->job_slice, false)) {
+                has_next = true;
+                setup_job_slice_state(*next);
+                // Send the packets whose slots were never used or have already been freed by the current job slice.
+                for(uint64_t next_pkt_id = 0; next_pkt_id < next->batch_num_pkts; next_pkt_id++) {
+                    uint64_t slot_pkt_id = current->total_num_pkts + next_pkt_id;
+                    if(slot_pkt_id < max_outstanding_pkts || current->received_pkts[slot_pkt_id - max_outstanding_pkts]) {
+                        create_packet(*next, next_pkt_id, packets_to_send);
+                    }
+                }
             }
 
+            DVLOG(3) << "Worker thread '" << this->tid_ << "' received '" << received_packets.size()
+                << "' packets. Total received '" << current->num_pkts_received << "/" << current->total_num_pkts << "'.";
+
             // Send the next group of packets
-            DVLOG(3) << "Worker thread '" << this->tid_ << "' sending '" << packets_to_send.size() << "' packets.";
-            backend.SendBurst(this->tid_, packets_to_send);
-            ctx.GetStats().AddTotalPktsSent(this->tid_, packets_to_send.size());
+            send_packets(packets_to_send);
 
-        } // while (num_packets_received != total_num_pkts && ctx.GetContextState() == Context::ContextState::RUNNING)
+        } // while (current->num_pkts_received != current->total_num_pkts && ctx.GetContextState() == Context::ContextState::RUNNING)
 
-        this->ppp_->CleanupJobSlice();
-        
-        // Notify the ctx that the worker thread finished this job slice.
-        // If the context exited then the notify call will simply fail and set the job to failed.
-        DVLOG_IF(2, num_packets_received == total_num_pkts) << "Worker thread '" << this->tid_ << "' notifying job slice completion with job id: " << job_slice.job->id_  << ".";
-        ctx.NotifyJobSliceCompletion(this->tid_, job_slice);
+        finish_job_slice(*current);
+
+        // The next job slice will never get a chance to run if the context exited.
+        if(has_next && ctx.GetContextState() != Context::ContextState::RUNNING) {
+            finish_job_slice(*next);
+            has_next = false;
+        }
 
     } // while(ctx.GetContextState() == Context::ContextState::RUNNING)
 
     VLOG(0) << "Worker thread '" << this->tid_ << "' exiting.";
-    free(outstanding_entries);
-    free(outstanding_extra_info);
+    for(int i = 0; i < 2; i++) {
+        free(job_slice_states[i].outstanding_entries);
+        free(job_slice_states[i].outstanding_extra_info);
+    }
     backend.CleanupWorkerThread(this->tid_);
 }
 
@@ -24,6 +24,7 @@
 #define SWITCHML_DUMMY_WORKER_THREAD_H_
 
 #include <thread>
+#include <vector>
 
 #include "common.h"
 #include "config.h"
@@ -48,8 +49,9 @@ class DummyWorkerThread{
      * @param [in] context a reference to the switchml context.
      * @param [in] backend a reference to the created dummy backend.
      * @param [in] config a reference to the context configuration.
+     * @param [in] worker_thread_id the id of the worker thread within its context.
      */
-    DummyWorkerThread(Context& context, DummyBackend& backend, Config& config);
+    DummyWorkerThread(Context& context, DummyBackend& backend, Config& config, WorkerTid worker_thread_id);
 
     ~DummyWorkerThread();
 
@@ -77,9 +79,6 @@ class DummyWorkerThread{
     /** Worker thread id */
     const WorkerTid tid_;
   private:
-    /** Monotonically increasing counter to give unique IDs for each new worker thread **/
-    static WorkerTid next_tid_;
-
     /** A reference to the context */
     Context& context_;
     /** A reference to the context backend */
@@ -87,11 +86,44 @@ class DummyWorkerThread{
     /** A reference to the context configuration */
     Config& config_;
 
+    /**
+     * @brief The state of a job slice that the worker thread is working on.
+     * 
+     * A worker thread can have two job slices in flight: the current one and the next one
+     * which it starts as soon as the tail of the current one frees up outstanding packets.
+     */
+    struct JobSliceState {
+        /** The job slice itself */
+        JobSlice job_slice;
+        /** The prepostprocessor used for this job slice */
+        std::shared_ptr<PrePostProcessor> ppp;
+        /** Buffer to hold the entries that are supposed to be outstanding. */
+        void* outstanding_entries;
+        /** Buffer to hold the extra info that is supposed to be outstanding. */
+        void* outstanding_extra_info;
+        /** The job slice counter value used to tell apart the packets of this job slice */
+        uint8_t short_job_id;
+        /** The total number of packets to send including the extra batch if any. 0 if there is nothing to send. */
+        uint64_t total_num_pkts;
+        /** The number of packets in the first batch */
+        uint64_t batch_num_pkts;
+        /** The number of packets sent so far excluding retransmissions */
+        uint64_t num_pkts_sent;
+        /** The number of packets received so far */
+        uint64_t num_pkts_received;
+        /** Which packets have been received so far */
+        std::vector<bool> received_pkts;
+        /** Whether the job has progressive input so packets must wait for their input to be ready (See Job::MarkReady()) */
+        bool progressive;
+        /** The ids of the packets that are waiting for their input to be ready */
+        std::vector<uint64_t> deferred_pkts;
+    };
+
     /** A pointer to the actual system thread object */
     std::thread* thread_;
 
-    /** The prepostprocessor used by the worker thread */
-    std::shared_ptr<PrePostProcessor> ppp_;
+    /** The prepostprocessors used by the worker thread. One for each job slice that it can have in flight. */
+    std::shared_ptr<PrePostProcessor> ppps_[2];
 };
 
 } // namespace switchml
@@ -27,6 +27,8 @@
 
 namespace switchml {
 
+std::atomic<bool> RdmaBackend::in_use_in_process_(false);
+
 RdmaBackend::RdmaBackend(Context& context, Config& config)
     : Backend(context, config)
     , worker_threads_()
@@ -41,13 +43,16 @@ RdmaBackend::~RdmaBackend() {
 void RdmaBackend::SetupWorker() {
     VLOG(0) << "Setting up worker.";
 
+    LOG_IF(FATAL, RdmaBackend::in_use_in_process_.exchange(true)) << "The rdma backend can only be used by a single context at a time "
+        << "since the switch only keeps a single session. Stop the other context first or use the dummy backend.";
+
     // Create RDMA connection
     this->connection_ = std::make_unique<RdmaConnection>(this->config_);
     this->connection_->Connect();
 
     // Start worker threads
     for(int i = 0; i < this->config_.general_.num_worker_threads; i++) {
-        this->worker_threads_.push_back(RdmaWorkerThread(this->context_,*this, this->config_));
+        this->worker_threads_.push_back(RdmaWorkerThread(this->context_,*this, this->config_, i));
         this->worker_threads_[i].Start();
     }
 }
@@ -59,6 +64,7 @@ void RdmaBackend::CleanupWorker() {
     for(int i = 0; i < this->config_.general_.num_worker_threads; i++) {
         this->worker_threads_[i].Join();
     }
+    RdmaBackend::in_use_in_process_ = false;
 }
 
 std::unique_ptr<RdmaConnection>& RdmaBackend::GetConnection() {
@@ -28,6 +28,7 @@
 #endif
 
 #include <memory>
+#include <atomic>
 
 #include "common.h"
 #include "backend.h"
@@ -64,11 +65,14 @@ class RdmaBackend : public switchml::Backend {
 
     /**
      * @brief Establish the RDMA connection, setup the switch, and start the worker threads.
+     * 
+     * Only one context per process can use the rdma backend at a time since setting up the switch clears
+     * the switch state of any other session.
      */
     void SetupWorker() override;
 
     /**
-     * @brief Wait for all worker threads to exit.
+     * @brief Wait for all worker threads to exit then let another context use the rdma backend.
      */
     void CleanupWorker() override;
 
@@ -85,6 +89,12 @@ class RdmaBackend : public switchml::Backend {
 
     /** The RDMA connection that the worker threads will use to send and receive */
     std::unique_ptr<RdmaConnection> connection_;
+
+    /**
+     * Whether a context of this process is currently using the rdma backend.
+     * The controller only keeps a single session so a second context would wipe the switch state of the first one.
+     */
+    static std::atomic<bool> in_use_in_process_;
 };
 
 } // namespace switchml
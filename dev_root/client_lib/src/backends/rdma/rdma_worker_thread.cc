@@ -30,21 +30,20 @@
 
 namespace switchml {
 
-WorkerTid RdmaWorkerThread::next_tid_ = 0;
-
-RdmaWorkerThread::RdmaWorkerThread(Context& context, RdmaBackend& backend, Config& config) :
-    tid_(RdmaWorkerThread::next_tid_++),
+RdmaWorkerThread::RdmaWorkerThread(Context& context, RdmaBackend& backend, Config& config, WorkerTid worker_thread_id) :
+    tid_(worker_thread_id),
     context_(context),
     backend_(backend),
     config_(config),
     thread_(nullptr),
-    ppp_(),
+    ppps_(),
     completion_queue_(backend_.GetConnection()->GetWorkerThreadCompletionQueue(this->tid_)),
     queue_pairs_(backend_.GetConnection()->GetWorkerThreadQueuePairs(this->tid_)),
     send_sges_(this->queue_pairs_.size()),
     send_wrs_(this->queue_pairs_.size()),
     recv_wrs_(this->queue_pairs_.size()),
     msg_ids_(this->queue_pairs_.size(), 0),
+    qp_job_slice_states_(this->queue_pairs_.size(), nullptr),
     registered_buffer_ptr_(backend_.GetConnection()->GetWorkerThreadMemoryRegion(this->tid_).first),
     write_posted_count_per_qp_(this->queue_pairs_.size())
 #ifdef TIMEOUTS
@@ -85,7 +84,10 @@ void RdmaWorkerThread::operator()() {
     // Size of a message in bytes.
     uint32_t msg_size = rdmaconf.msg_numel * RDMA_SWITCH_ELEMENT_SIZE;
 
-    this->ppp_ = PrePostProcessor::CreateInstance(this->config_, this->tid_, msg_size, max_outstanding_msgs);
+    // One prepostprocessor for each job slice that the worker thread can have in flight.
+    for (int i = 0; i < 2; i++) {
+        this->ppps_[i] = PrePostProcessor::CreateInstance(this->config_, this->tid_, msg_size, max_outstanding_msgs);
+    }
 
     // Initialize work requests
     for (uint16_t qpn = 0; qpn < this->queue_pairs_.size(); qpn++) {
@@ -133,69 +135,111 @@ void RdmaWorkerThread::operator()() {
 
     // Initialization complete
 
-    // The job slice struct that will be filled with the next job slice to work on.
-    JobSlice job_slice;
+    // The current job slice and the next one which overlaps with the tail of the current one.
+    JobSliceState job_slice_states[2];
+    for (int i = 0; i < 2; i++) {
+        job_slice_states[i].ppp = this->ppps_[i];
+        job_slice_states[i].total_num_msgs = 0;
+    }
+    JobSliceState* current = &job_slice_states[0];
+    JobSliceState* next = &job_slice_states[1];
+    bool has_next = false;
+
+    // Initialize statistic variables.
+    // We found that using local variables for the inner loops speeds things up.
+    // We then push those local variables to the context statistics object at the end of each job slice.
+    uint64_t stats_wrong_pkts_received = 0;
+    uint64_t stats_correct_pkts_received = 0;
+    uint64_t stats_total_pkts_sent = 0;
+#ifdef TIMEOUTS
+    uint64_t stats_timeouts = 0;
+#endif
 
-    // Main worker thread loop
-    // This is where optimization is very important
-    while(ctx.GetContextState() == Context::ContextState::RUNNING) {
-        // Get a job slice
-        bool got_job_slice = ctx.GetJobSlice(this->tid_, job_slice);
-        if(!got_job_slice) {
-            continue;
+    // Setup the prepostprocessor and compute the number of messages needed for a job slice.
+    auto setup_job_slice_state = [&](JobSliceState& state) {
+        DVLOG(2) << "Worker thread '" << this->tid_ << "' received job slice with job id: " << state.job_slice.job->id_ << " with numel: " << state.job_slice.slice.numel << ".";
+        state.num_sent_msgs = 0;
+        state.num_received_msgs = 0;
+        if(state.job_slice.slice.numel <= 0 || this->config_.general_.instant_job_completion) {
+            state.total_num_msgs = 0;
+            state.batch_num_msgs = 0;
+            return;
         }
-        DVLOG(2) << "Worker thread '" << this->tid_ << "' received job slice with job id: " << job_slice.job->id_ << " with numel: " << job_slice.slice.numel << ".";
-        if(job_slice.slice.numel <=0 || this->config_.general_.instant_job_completion) {
-            if(ctx.GetContextState() == Context::ContextState::RUNNING) {
-                DVLOG(2) << "Worker thread '" << this->tid_ << "' notifying job slice completion with job id: " << job_slice.job->id_  << ".";
-                ctx.NotifyJobSliceCompletion(this->tid_, job_slice);
-            }
-            continue;
-        }
-
-        // Compute number of messages needed for this job
-        uint64_t total_num_msgs = this->ppp_->SetupJobSlice(&job_slice);
+        state.total_num_msgs = state.ppp->SetupJobSlice(&state.job_slice);
 
         // We can logically divide all of the messages that we will send into 'max_outstanding_msgs' sized groups
         // (Or less in case the total number of messages was less than max_outsanding_msgs).
         // We call each of these groups a batch. So if max_outstanding_msgs=10 and we wanted to send 70 messages then we have 7 batches.
-        uint64_t batch_num_msgs = std::min(max_outstanding_msgs, total_num_msgs);
+        state.batch_num_msgs = std::min(max_outstanding_msgs, state.total_num_msgs);
 
-        if(this->ppp_->NeedsExtraBatch()) {
-            total_num_msgs += batch_num_msgs;
+        if(state.ppp->NeedsExtraBatch()) {
+            state.total_num_msgs += state.batch_num_msgs;
         }
 
-        // Initialize msg_ids for the qps that we will use.
-        for(size_t qpn = 0; qpn < batch_num_msgs; qpn++) {
-            this->msg_ids_[qpn] = qpn;
+        DVLOG(3) << "Worker thread '" << this->tid_ << "' will send a total of '" << state.total_num_msgs << "' messages each having '" << rdmaconf.msg_numel << " elements.";
+    };
+
+    // Start a job slice on a queue pair.
+    // Each queue pair is a switch slot that carries messages qpn, qpn + batch_num_msgs, qpn + 2 * batch_num_msgs, ... of the job slice.
+    auto start_job_slice_on_qp = [&](JobSliceState& state, uint16_t qpn) {
+        this->qp_job_slice_states_[qpn] = &state;
+        this->msg_ids_[qpn] = qpn;
+        // Post recv work request
+        this->PostRecvWr(qpn);
+        // Post send work request
+        this->PostSendWr(qpn);
+        state.num_sent_msgs++;
+        stats_total_pkts_sent += num_pkts_per_msg;
+    };
+
+    // Release the prepostprocessor, push the stats, and notify the ctx that the worker thread finished a job slice.
+    // If the context exited then the notify call will simply fail and set the job to failed.
+    auto finish_job_slice = [&](JobSliceState& state) {
+        if(state.total_num_msgs != 0) {
+            state.ppp->CleanupJobSlice();
         }
 
-        // Initialize statistic variables.
-        // We found that using local variables for the inner loops speeds things up.
-        // We then push those local variables to the context statistics object at the end of each job.
-        uint64_t stats_wrong_pkts_received = 0;
-        uint64_t stats_correct_pkts_received = 0;
-        uint64_t stats_total_pkts_sent = 0;
+        // Add the local stats to the context stats object.
+        ctx.GetStats().AddCorrectPktsReceived(this->tid_, stats_correct_pkts_received);
+        ctx.GetStats().AddTotalPktsSent(this->tid_, stats_total_pkts_sent);
+        ctx.GetStats().AddWrongPktsReceived(this->tid_, stats_wrong_pkts_received);
+        stats_wrong_pkts_received = 0;
+        stats_correct_pkts_received = 0;
+        stats_total_pkts_sent = 0;
 #ifdef TIMEOUTS
-        uint64_t stats_timeouts = 0;
+        ctx.GetStats().AddTimeouts(this->tid_, stats_timeouts);
+        stats_timeouts = 0;
 #endif
+        // Finally notify the ctx that the worker thread finished this job slice.
+        DVLOG_IF(2, state.num_received_msgs == state.total_num_msgs) << "Worker thread '" << this->tid_ << "' notifying job slice completion with job id: " << state.job_slice.job->id_  << ".";
+        ctx.NotifyJobSliceCompletion(this->tid_, state.job_slice);
+    };
 
-        DVLOG(3) << "Worker thread '" << this->tid_ << "' will send a total of '" << total_num_msgs << "' messages each having '" << rdmaconf.msg_numel << " elements.";
+    // Main worker thread loop
+    // This is where optimization is very important
+    while(ctx.GetContextState() == Context::ContextState::RUNNING) {
+        if(has_next) {
+            // The next job slice already started while the previous one was finishing.
+            std::swap(current, next);
+            has_next = false;
+        } else {
+            // Get a job slice
+            bool got_job_slice = ctx.GetJobSlice(this->tid_, current->job_slice);
+            if(!got_job_slice) {
+                continue;
+            }
+            setup_job_slice_state(*current);
 
-        // Send first batch
-        DVLOG(3) << "Worker thread '" << this->tid_ << "' will send the first '" << batch_num_msgs << "' messages";
-        for (uint16_t qpn = 0; qpn < batch_num_msgs; qpn++) {
-            // Post recv work request
-            this->PostRecvWr(qpn);
-            // Post send work request
-            this->PostSendWr(qpn);
+            // Send first batch
+            DVLOG(3) << "Worker thread '" << this->tid_ << "' will send the first '" << current->batch_num_msgs << "' messages";
+            for (uint16_t qpn = 0; qpn < current->batch_num_msgs; qpn++) {
+                start_job_slice_on_qp(*current, qpn);
+            }
         }
-        stats_total_pkts_sent += num_pkts_per_msg*batch_num_msgs; 
 
-        // loop until all messages have been sent and received.
+        // loop until all messages of the current job slice have been sent and received.
         DVLOG(3) << "Worker thread '" << this->tid_ << "' is starting the receive and send loop";
-        uint64_t num_received_msgs = 0;
-        while (num_received_msgs < total_num_msgs && ctx.GetContextState() == Context::ContextState::RUNNING) {
+        while (current->num_received_msgs < current->total_num_msgs && ctx.GetContextState() == Context::ContextState::RUNNING) {
             // Check for completions indicating received messages
             int cnum = ibv_poll_cq(this->completion_queue_, this->queue_pairs_.size(), &completions[0]);
 
@@ -219,13 +263,14 @@ void RdmaWorkerThread::operator()() {
                     // Select the first two bytes of the work request id which constitute the qpn
                     // relative to this worker thread.
                     uint16_t qpn = completions[i].wr_id & 0xFFFF;
+                    JobSliceState& state = *this->qp_job_slice_states_[qpn];
 
                     uint16_t received_short_msg_id = completions[i].imm_data & 0xFFFF;
                     uint16_t expected_short_msg_id = msg_ids_[qpn] & 0xFFFF;
 
                     // Is this the message that we are expecting from this qpn?
                     if(received_short_msg_id != expected_short_msg_id) {
-                        if(received_short_msg_id < expected_short_msg_id && received_short_msg_id % batch_num_msgs == expected_short_msg_id % batch_num_msgs) {
+                        if(received_short_msg_id < expected_short_msg_id && received_short_msg_id % state.batch_num_msgs == expected_short_msg_id % state.batch_num_msgs) {
                             DVLOG(3) << "Worker thread '" << this->tid_ << "' received duplicate message"
                                 << " for qpn=" << qpn << ". Expected " << expected_short_msg_id << " But received " << received_short_msg_id;
                         } else {
@@ -241,22 +286,27 @@ void RdmaWorkerThread::operator()() {
                     void* message_start = static_cast<uint8_t*>(this->registered_buffer_ptr_) + qpn * msg_size;
                     uint8_t* imm_data = static_cast<uint8_t*>((void*)&completions[i].imm_data);
                     uint8_t* extra_info_ptr = imm_data + 2;
-                    this->ppp_->PostprocessSingle(msg_ids_[qpn], message_start, extra_info_ptr);
+                    state.ppp->PostprocessSingle(msg_ids_[qpn], message_start, extra_info_ptr);
 
                     // Increment message id
-                    this->msg_ids_[qpn] += batch_num_msgs;
+                    this->msg_ids_[qpn] += state.batch_num_msgs;
 #ifdef TIMEOUTS
                     // The message for this qpn was received correctly, remove its timer.
                     this->timeouts_queue_.Remove(qpn);
 #endif
+                    state.num_received_msgs++;
                     iteration_num_received_msgs++;
                     // Post next send for this slot if needed
-                    if (this->msg_ids_[qpn] < total_num_msgs) {
+                    if (this->msg_ids_[qpn] < state.total_num_msgs) {
                         // Post recv work request
                         PostRecvWr(qpn);
                         // Post send work request
                         PostSendWr(qpn);
+                        state.num_sent_msgs++;
                         stats_total_pkts_sent += num_pkts_per_msg; 
+                    } else if (has_next && &state == current && qpn < next->batch_num_msgs) {
+                        // The queue pair is done with the current job slice so hand it over to the next one.
+                        start_job_slice_on_qp(*next, qpn);
                     }
                 }  else if (completions[i].opcode == IBV_WC_RDMA_WRITE) {
                     // This completion indicates a successfully transmitted message
@@ -275,10 +325,22 @@ void RdmaWorkerThread::operator()() {
                 }
             }
 
-            num_received_msgs += iteration_num_received_msgs;
             stats_correct_pkts_received += num_pkts_per_msg * iteration_num_received_msgs;
             DVLOG_IF(3, iteration_num_received_msgs > 0) << "Worker thread '" << this->tid_ << "' received " 
-                << iteration_num_received_msgs << " messages " << num_received_msgs << "/" << total_num_msgs << ".";
+                << iteration_num_received_msgs << " messages " << current->num_received_msgs << "/" << current->total_num_msgs << ".";
+
+            // Once all messages of the current job slice have been sent, start the next job slice if there is one
+            // on the queue pairs that the current one no longer needs. The other queue pairs are handed over as they finish.
+            if (iteration_num_received_msgs > 0 && !has_next && current->num_sent_msgs == current->total_num_msgs
+                && ctx.GetJobSlice(this->tid_, next->job_slice, false)) {
+                has_next = true;
+                setup_job_slice_state(*next);
+                for (uint16_t qpn = 0; qpn < next->batch_num_msgs; qpn++) {
+                    if (qpn >= current->batch_num_msgs || this->msg_ids_[qpn] >= current->total_num_msgs) {
+                        start_job_slice_on_qp(*next, qpn);
+                    }
+                }
+            }
 
 #ifdef TIMEOUTS
             // Check for timeouts
@@ -291,22 +353,15 @@ void RdmaWorkerThread::operator()() {
                 stats_total_pkts_sent += num_pkts_per_msg; 
             }
 #endif
-        } // while (num_received_msgs < total_num_msgs && ctx.GetContextState() == Context::ContextState::RUNNING)
+        } // while (current->num_received_msgs < current->total_num_msgs && ctx.GetContextState() == Context::ContextState::RUNNING)
 
-        this->ppp_->CleanupJobSlice();
+        finish_job_slice(*current);
 
-        // Add the local stats to the context stats object.
-        ctx.GetStats().AddCorrectPktsReceived(this->tid_, stats_correct_pkts_received);
-        ctx.GetStats().AddTotalPktsSent(this->tid_, stats_total_pkts_sent);
-        ctx.GetStats().AddWrongPktsReceived(this->tid_, stats_wrong_pkts_received);
-#ifdef TIMEOUTS
-        ctx.GetStats().AddTimeouts(this->tid_, stats_timeouts);
-#endif
-        // Finally notify the ctx that the worker thread finished this job slice.
-        // Notify the ctx that the worker thread finished this job slice.
-        // If the context exited then the notify call will simply fail and set the job to failed.
-        DVLOG_IF(2, num_received_msgs == total_num_msgs) << "Worker thread '" << this->tid_ << "' notifying job slice completion with job id: " << job_slice.job->id_  << ".";
-        ctx.NotifyJobSliceCompletion(this->tid_, job_slice);
+        // The next job slice will never get a chance to run if the context exited.
+        if(has_next && ctx.GetContextState() != Context::ContextState::RUNNING) {
+            finish_job_slice(*next);
+            has_next = false;
+        }
 
     } // while(ctx.GetContextState() == Context::ContextState::RUNNING)
 }
@@ -353,7 +408,7 @@ void RdmaWorkerThread::PostSendWr(uint16_t qpn, bool is_retransmission) {
         // There is room in the immediate data to preprocess half the message at a time allowing for more
         // controlled quantization. But we don't need to do that unless we measure losses in accuracy upon
         // quantizing at the whole message scale.
-        this->ppp_->PreprocessSingle(this->msg_ids_[qpn], message_start, extra_info_ptr);
+        this->qp_job_slice_states_[qpn]->ppp->PreprocessSingle(this->msg_ids_[qpn], message_start, extra_info_ptr);
 
         DVLOG(3) << "Worker thread '" << this->tid_ << "' QP " << qpn << ":0x" << std::hex
                 << this->queue_pairs_[qpn]->qp_num << std::dec << " posting write from "
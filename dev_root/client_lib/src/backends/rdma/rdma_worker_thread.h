@@ -53,8 +53,9 @@ class RdmaWorkerThread {
      * @param [in] context a reference to the switchml context.
      * @param [in] backend a reference to the created rdma backend.
      * @param [in] config a reference to the context configuration.
+     * @param [in] worker_thread_id the id of the worker thread within its context.
      */
-    RdmaWorkerThread(Context& context, RdmaBackend& backend, Config& config);
+    RdmaWorkerThread(Context& context, RdmaBackend& backend, Config& config, WorkerTid worker_thread_id);
 
     ~RdmaWorkerThread();
 
@@ -82,6 +83,27 @@ class RdmaWorkerThread {
     /** Worker thread id */
     const WorkerTid tid_;
   private:
+    /**
+     * @brief The state of a job slice that the worker thread is working on.
+     * 
+     * A worker thread can have two job slices in flight: the current one and the next one
+     * which starts on each queue pair as soon as that queue pair sent and received its last message of the current one.
+     */
+    struct JobSliceState {
+        /** The job slice itself */
+        JobSlice job_slice;
+        /** The prepostprocessor used for this job slice */
+        std::shared_ptr<PrePostProcessor> ppp;
+        /** The total number of messages to send including the extra batch if any. 0 if there is nothing to send. */
+        uint64_t total_num_msgs;
+        /** The number of messages in the first batch (The number of queue pairs that the job slice uses) */
+        uint64_t batch_num_msgs;
+        /** The number of messages sent so far excluding retransmissions */
+        uint64_t num_sent_msgs;
+        /** The number of messages received so far */
+        uint64_t num_received_msgs;
+    };
+
     /**
      * @brief Use the backend connection to post a receive work request.
      * 
@@ -93,6 +115,8 @@ class RdmaWorkerThread {
      * @brief Setup the next message for the given queue pair to be ready for sending, then use
      * the backend connection to post the send work request so that the message is sent.
      * 
+     * The message is preprocessed by the prepostprocessor of the job slice that the queue pair is working on.
+     * 
      * This also pushes a timeout entry into the timeout queue for this queue pair or 
      * this outstanding message.
      * 
@@ -102,9 +126,6 @@ class RdmaWorkerThread {
      */
     void PostSendWr(uint16_t qpn, bool is_retransmission=false);
 
-    /** Monotonically increasing counter to give unique IDs for each new worker thread **/
-    static WorkerTid next_tid_;
-
     /** A reference to the context */
     Context& context_;
     /** A reference to the context backend */
@@ -115,8 +136,8 @@ class RdmaWorkerThread {
     /** A pointer to the actual system thread object */
     std::thread* thread_;
 
-    /** The prepostprocessor used by the worker thread */
-    std::shared_ptr<PrePostProcessor> ppp_;
+    /** The prepostprocessors used by the worker thread. One for each job slice that it can have in flight. */
+    std::shared_ptr<PrePostProcessor> ppps_[2];
 
     // Connection
     /** 
@@ -153,6 +174,9 @@ class RdmaWorkerThread {
      */
     std::vector<uint64_t> msg_ids_;
 
+    /** The job slice that each queue pair is working on. */
+    std::vector<JobSliceState*> qp_job_slice_states_;
+
     /** A pointer to the registered buffer that we copy data to before sending and from after receiving */
     void* registered_buffer_ptr_;
 
@@ -31,6 +31,9 @@
 #include <glog/logging.h>
 #include "glog_fix.h"
 
+/** The size in bytes of a cache line. */
+#define SWITCHML_CACHE_LINE_SIZE 64
+
 namespace switchml {
 
     // Lets give primitives names to make sure we use the same type for
@@ -38,8 +41,12 @@ namespace switchml {
 
     /** Type used to represent all job ids. */
     typedef uint64_t JobId;
+    /** Type used to represent job priorities. Jobs with higher values are more urgent. */
+    typedef int32_t JobPriority;
     /** Type used to represent all worker thread ids. */
     typedef int16_t WorkerTid;
+    /** Type used to represent communication stream ids. These are indices into general.streams. */
+    typedef uint16_t StreamId;
     /** Type used to represent the number of elements in all tensors */
     typedef uint64_t Numel;
     /** The clock type used in all time measurements for switchml. **/
@@ -53,6 +60,16 @@ namespace switchml {
         INT32 /**< Represents a standard 32 bit signed integer */
     };
 
+    /**
+     * @brief How a thread waits for submitted jobs to complete.
+     */
+    enum WaitPolicy {
+        DEFAULT_WAIT,    /**< Use the policy chosen in general.wait_policy */
+        BLOCK,           /**< Block on a condition variable right away */
+        SPIN_THEN_BLOCK, /**< Spin for up to general.wait_spin_us microseconds then block */
+        BUSY_POLL        /**< Spin until the jobs complete without ever blocking */
+    };
+
     /**
      * @brief Returns the size of an element of the given DataType
      * 
@@ -88,31 +105,34 @@ namespace switchml {
         /**
          * @brief A convenience function that offsets the tensor pointers by number of elements.
          * 
-         * It casts the ptrs to the data_type then increments the pointers by numel argument.
+         * It increments the pointers by numel elements of the data_type.
          * The member numel is untouched.
          * 
          * @param [in] numel Number of **elements** to offset.
          */
         inline void OffsetPtrs(Numel numel) {
             // SUGGESTION: Cleaner to move this function to utils ?
-            if(this->data_type == FLOAT32){
-                float* ptr = static_cast<float*>(this->in_ptr);
-                ptr += numel;
-                this->in_ptr = ptr;
-                ptr = static_cast<float*>(this->out_ptr);
-                ptr += numel;
-                this->out_ptr = ptr;
-            } else if (this->data_type == INT32){
-                int32_t* ptr = static_cast<int32_t*>(this->in_ptr);
-                ptr += numel;
-                this->in_ptr = ptr;
-                ptr = static_cast<int32_t*>(this->out_ptr);
-                ptr += numel;
-                this->out_ptr = ptr;
-            } else {
-                LOG(FATAL) << "'" << this->data_type << "' is not a valid tensor data type";
-            }
+            // The pointers are offset as integers so that the null pointers of segmented tensors (See Job::segments_)
+            // simply end up holding the offset of the slice.
+            const uintptr_t offset = numel * DataTypeSize(this->data_type);
+            this->in_ptr = reinterpret_cast<void*>(reinterpret_cast<uintptr_t>(this->in_ptr) + offset);
+            this->out_ptr = reinterpret_cast<void*>(reinterpret_cast<uintptr_t>(this->out_ptr) + offset);
         }
     };
+
+    /**
+     * @brief A contiguous piece of a tensor that is scattered in memory.
+     * 
+     * A list of segments describes a tensor made of the concatenation of the segments' elements
+     * (Ex. a bucket of gradients or a non contiguous view) which can be reduced without first being copied into a flat buffer.
+     */
+    struct TensorSegment {
+        /** Pointer to the input memory of the segment. */
+        void* in_ptr;
+        /** Pointer to the output memory of the segment. */
+        void* out_ptr;
+        /** Number of **elements** in the segment. (Not the size) */
+        Numel numel;
+    };
 } // namespace switchml
 #endif // SWITCHML_COMMON_H_
\ No newline at end of file
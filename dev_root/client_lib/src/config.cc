@@ -26,6 +26,8 @@
 #include <limits.h>
 
 #include <fstream>
+#include <sstream>
+#include <numeric>
 #include <boost/program_options.hpp>
 
 #include "common_cc.h"
@@ -51,6 +53,14 @@ bool Config::LoadFromFile(std::string path) {
         ("general.packet_numel", po::value<uint64_t>(&this->general_.packet_numel)->default_value(1024))
         ("general.backend", po::value<std::string>(&this->general_.backend)->default_value("dummy"))
         ("general.scheduler", po::value<std::string>(&this->general_.scheduler)->default_value("fifo"))
+        ("general.streams", po::value<std::string>(&this->general_.streams_str)->default_value(""))
+        ("general.small_job_numel", po::value<uint64_t>(&this->general_.small_job_numel)->default_value(1024))
+        ("general.chunk_numel", po::value<uint64_t>(&this->general_.chunk_numel)->default_value(1048576))
+        ("general.fusion_threshold_numel", po::value<uint64_t>(&this->general_.fusion_threshold_numel)->default_value(65536))
+        ("general.range_numel", po::value<uint64_t>(&this->general_.range_numel)->default_value(65536))
+        ("general.wait_policy", po::value<std::string>(&this->general_.wait_policy_str)->default_value("block"))
+        ("general.wait_spin_us", po::value<uint32_t>(&this->general_.wait_spin_us)->default_value(50))
+        ("general.job_timeout_ms", po::value<uint32_t>(&this->general_.job_timeout_ms)->default_value(0))
         ("general.prepostprocessor", po::value<std::string>(&this->general_.prepostprocessor)->default_value("cpu_exponent_quantizer"))
         ("general.instant_job_completion", po::value<bool>(&this->general_.instant_job_completion)->default_value(false))
         ("general.controller_ip", po::value<std::string>(&this->general_.controller_ip_str)->default_value("127.0.0.1"))
@@ -171,6 +181,51 @@ void Config::Validate() {
         this->general_.max_outstanding_packets = new_mop;
     }
 
+    LOG_IF(FATAL, this->general_.job_timeout_ms != 0 && this->general_.backend != "dummy")
+        << "general.job_timeout_ms is only supported by the dummy backend. The '" << this->general_.backend
+        << "' backend must finish every job slice to keep the switch slots in sync with the other workers.";
+
+    this->general_.streams.clear();
+    if(this->general_.streams_str.empty()) {
+        this->general_.streams.push_back(StreamConfig{"default", this->general_.num_worker_threads});
+    } else {
+        std::stringstream ss(this->general_.streams_str);
+        std::string token;
+        uint32_t streams_num_worker_threads = 0;
+        while(getline(ss, token, ',')) {
+            size_t separator = token.find(':');
+            LOG_IF(FATAL, separator == std::string::npos || separator == 0 || separator == token.size() - 1) 
+                << "general.streams entry '" << token << "' is not of the form name:num_worker_threads.";
+            std::string num_worker_threads_str = token.substr(separator + 1);
+            // Only digits and at most 5 of them so that std::stoul can neither throw nor overflow.
+            LOG_IF(FATAL, num_worker_threads_str.find_first_not_of("0123456789") != std::string::npos || num_worker_threads_str.size() > 5)
+                << "general.streams entry '" << token << "' does not have a valid number of worker threads.";
+            uint64_t num_worker_threads = std::stoul(num_worker_threads_str);
+            LOG_IF(FATAL, num_worker_threads > UINT16_MAX)
+                << "Stream '" << token.substr(0, separator) << "' cannot have more than " << UINT16_MAX << " worker threads.";
+            StreamConfig stream{token.substr(0, separator), (uint16_t) num_worker_threads};
+            LOG_IF(FATAL, stream.num_worker_threads == 0) << "Stream '" << stream.name << "' must have at least 1 worker thread.";
+            for(const StreamConfig& other : this->general_.streams) {
+                LOG_IF(FATAL, other.name == stream.name) << "Stream '" << stream.name << "' is defined more than once in general.streams.";
+            }
+            streams_num_worker_threads += stream.num_worker_threads;
+            this->general_.streams.push_back(stream);
+        }
+        LOG_IF(FATAL, streams_num_worker_threads != this->general_.num_worker_threads) 
+            << "The streams in general.streams have '" << streams_num_worker_threads << "' worker threads in total but general.num_worker_threads is '"
+            << this->general_.num_worker_threads << "'.";
+    }
+
+    if(this->general_.wait_policy_str == "block") {
+        this->general_.wait_policy = WaitPolicy::BLOCK;
+    } else if(this->general_.wait_policy_str == "spin_then_block") {
+        this->general_.wait_policy = WaitPolicy::SPIN_THEN_BLOCK;
+    } else if(this->general_.wait_policy_str == "busy_poll") {
+        this->general_.wait_policy = WaitPolicy::BUSY_POLL;
+    } else {
+        LOG(FATAL) << "'" << this->general_.wait_policy_str << "' is not a valid wait policy. Choose from ['block', 'spin_then_block', 'busy_poll'].";
+    }
+
 #ifdef DPDK
     if(this->general_.backend == "dpdk") {
         LOG_IF(FATAL, this->general_.packet_numel != 256 && this->general_.packet_numel != 64) 
@@ -210,6 +265,40 @@ void Config::Validate() {
         }
     }
 #endif
+
+    if(this->general_.scheduler == "chunked" || this->general_.scheduler == "deadline") {
+        // Each stream slices the chunks among its own worker threads so every stream's thread count must divide the chunk.
+        uint64_t streams_lcm = 1;
+        for(const StreamConfig& stream : this->general_.streams) {
+            streams_lcm = std::lcm(streams_lcm, (uint64_t) stream.num_worker_threads);
+        }
+        uint64_t chunk_granularity = this->general_.packet_numel * streams_lcm;
+#ifdef RDMA
+        if(this->general_.backend == "rdma") {
+            chunk_granularity = this->backend_.rdma.msg_numel * streams_lcm;
+        }
+#endif
+        uint64_t new_chunk_numel = std::max(1UL, (this->general_.chunk_numel + chunk_granularity / 2) / chunk_granularity) * chunk_granularity;
+        if(new_chunk_numel != this->general_.chunk_numel) {
+            LOG(WARNING) << "general.chunk_numel '" << this->general_.chunk_numel << "' is not a multiple of '" << chunk_granularity
+                << "' (elements per packet * least common multiple of the streams' numbers of worker threads).\n"
+                << "Setting it to '" << new_chunk_numel << "'."
+            ;
+            this->general_.chunk_numel = new_chunk_numel;
+        }
+    }
+
+    if(this->general_.scheduler == "work_stealing") {
+        LOG_IF(FATAL, this->general_.backend == "rdma") 
+            << "The work_stealing scheduler is not supported by the RDMA backend since a worker thread's switch slots are bound to its own queue pairs.";
+        uint64_t new_range_numel = std::max(1UL, (this->general_.range_numel + this->general_.packet_numel / 2) / this->general_.packet_numel) * this->general_.packet_numel;
+        if(new_range_numel != this->general_.range_numel) {
+            LOG(WARNING) << "general.range_numel '" << this->general_.range_numel << "' is not a multiple of general.packet_numel '" << this->general_.packet_numel << "'.\n"
+                << "Setting it to '" << new_range_numel << "'."
+            ;
+            this->general_.range_numel = new_range_numel;
+        }
+    }
 }
 
 void Config::PrintConfig() {
@@ -224,6 +313,14 @@ void Config::PrintConfig() {
         << "\n    packet_numel = " << this->general_.packet_numel
         << "\n    backend = " << this->general_.backend
         << "\n    scheduler = " << this->general_.scheduler
+        << "\n    streams = " << this->general_.streams_str
+        << "\n    small_job_numel = " << this->general_.small_job_numel
+        << "\n    chunk_numel = " << this->general_.chunk_numel
+        << "\n    fusion_threshold_numel = " << this->general_.fusion_threshold_numel
+        << "\n    range_numel = " << this->general_.range_numel
+        << "\n    wait_policy = " << this->general_.wait_policy_str
+        << "\n    wait_spin_us = " << this->general_.wait_spin_us
+        << "\n    job_timeout_ms = " << this->general_.job_timeout_ms
         << "\n    prepostprocessor = " << this->general_.prepostprocessor
         << "\n    instant_job_completion = " << this->general_.instant_job_completion
         << "\n    controller_ip_str = " << this->general_.controller_ip_str
@@ -282,4 +379,4 @@ void Config::PrintConfig() {
 #endif
 }
 
-} // namespace switchml
\ No newline at end of file
+} // namespace switchml
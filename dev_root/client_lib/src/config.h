@@ -24,11 +24,23 @@
 #define SWITCHML_CONFIG_H_
 
 #include <string>
+#include <vector>
 
 #include "common.h"
 
 namespace switchml {
 
+/**
+ * @brief Struct that describes a single communication stream. Parsed from general.streams.
+ */
+struct StreamConfig {
+    /** The name that clients use to look up the stream */
+    std::string name;
+
+    /** How many of the node's worker threads (And thus how much of its outstanding packets window) belong to the stream */
+    uint16_t num_worker_threads;
+};
+
 /**
  * @brief Struct that groups general configuration options that must always be configured.
  */
@@ -65,9 +77,81 @@ struct GeneralConfig {
      */ 
     std::string backend;
 
-    /** Which scheduler should we use to dispatch jobs to worker threads?. Choose from ['fifo']. */
+    /** Which scheduler should we use to dispatch jobs to worker threads?. Choose from ['fifo', 'priority', 'chunked', 'fusion', 'work_stealing', 'deadline']. */
     std::string scheduler;
 
+    /**
+     * The communication streams to create and how many worker threads each one of them gets.
+     * 
+     * The format is a comma separated list of name:num_worker_threads pairs (Ex. 'bulk:3,metrics:1').
+     * Each stream has its own scheduler (And queues) and its own worker threads, so streams make progress
+     * independently of each other and each one of them gets the outstanding packets of its worker threads.
+     * The number of worker threads of all streams must add up to num_worker_threads.
+     * The first stream is the default stream. If this is left empty then a single stream named 'default' gets all worker threads.
+     */
+    std::string streams_str;
+
+    /** The parsed form of streams_str. This is filled by Config::Validate(). */
+    std::vector<StreamConfig> streams;
+
+    /**
+     * Jobs with at most this many elements are not sliced across worker threads.
+     * 
+     * Such jobs only fill one or a few packets so each of them is given whole to a single worker thread instead
+     * (Small jobs are spread across worker threads in round robin order). Set it to 0 to slice all jobs.
+     */
+    uint64_t small_job_numel;
+
+    /**
+     * The number of elements in a chunk when using the chunked or deadline schedulers.
+     * 
+     * Jobs are split into chunks of this size and the chunks of the jobs of a batch (See Context::BeginBatch()) are interleaved.
+     * Smaller chunks let small (Or urgent) jobs of a batch overtake large ones sooner at the cost of more per chunk overhead.
+     * This is rounded to a multiple of packet_numel times the least common multiple of the streams' numbers of worker threads
+     * (Just num_worker_threads with a single stream) so that each worker thread of every stream gets whole packets.
+     */
+    uint64_t chunk_numel;
+
+    /**
+     * The size in elements of the fusion buffer when using the fusion scheduler.
+     * 
+     * Consecutive jobs that have at most this many elements are copied into a fusion buffer and reduced as a single job.
+     * The fused job is dispatched once the buffer is full, at the end of a batch, or when Context::Flush() or Context::WaitForAllJobs() is called.
+     */
+    uint64_t fusion_threshold_numel;
+
+    /**
+     * The number of elements in a range when using the work stealing scheduler.
+     * 
+     * Each worker thread's slice of a job is divided into ranges of this size. Ranges are the unit that idle worker threads steal.
+     * This is rounded to a multiple of packet_numel.
+     */
+    uint64_t range_numel;
+
+    /**
+     * How should threads wait for jobs to complete by default?. Choose from ['block', 'spin_then_block', 'busy_poll'].
+     * 
+     * Spinning avoids the cost of being put to sleep and woken up which matters for small latency bound jobs
+     * but it keeps the waiting thread's core busy. The policy can also be chosen for each wait call.
+     */
+    std::string wait_policy_str;
+
+    /** The parsed form of wait_policy_str. This is filled by Config::Validate(). */
+    WaitPolicy wait_policy;
+
+    /** How long in microseconds should a thread spin before blocking when using the spin_then_block wait policy. */
+    uint32_t wait_spin_us;
+
+    /**
+     * How long in milliseconds can a job take before it is failed. 0 means that jobs never time out.
+     * 
+     * Worker threads drop the slices of a timed out job. Only the dummy backend supports timeouts since the dpdk and rdma backends
+     * must finish every job slice to keep the switch slots in sync with the other workers (See Job::EnableAborts()).
+     * Jobs whose post reduction kernel updates y in place (AXPY and SGD) never time out since that would leave y partly updated.
+     * The timeout of a single job can be changed through Job::SetTimeout().
+     */
+    uint32_t job_timeout_ms;
+
     /** Which prepostprocessor should we use to load and unload the data into and from the network. Choose from ['bypass', 'cpu_exponent_quantizer'] */
     std::string prepostprocessor;
 
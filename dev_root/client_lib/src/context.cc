@@ -22,8 +22,14 @@
 
 #include "context.h"
 
+#include <algorithm>
+#include <cstring>
+#include <unistd.h>
+#include <sys/eventfd.h>
+
 #include "common_cc.h"
 #include "config.h"
+#include "utils.h"
 #include "fifo_scheduler.h"
 #include "backend.h"
 
@@ -39,7 +45,8 @@ Context& Context::GetInstance() {
 }
 
 Context::Context()
-    : scheduler_()
+    : streams_()
+    , worker_thread_streams_()
     , backend_()
     , config_()
     , stats_()
@@ -53,6 +60,18 @@ Context::Context()
     VLOG(0) << "Version info: " << VERSION_INFO;
 }
 
+Context::Stream::Stream(std::unique_ptr<Scheduler> scheduler, WorkerTid first_worker_thread_id)
+    : scheduler(std::move(scheduler))
+    , first_worker_thread_id(first_worker_thread_id)
+    , number_of_current_jobs(0)
+    , event_fd(-1)
+    , batch_open(false)
+    , batch()
+    , submitting(false)
+{
+    // Do nothing
+}
+
 Context::~Context() {
     if(this->context_state_ == ContextState::RUNNING) {
         LOG(WARNING) << "The context stop method was not called explicitly. Calling it now in the context destructor.";
@@ -86,8 +105,13 @@ bool Context::Start(Config* config){
 
     // Initialize stats
     this->stats_.InitStats(this->config_.general_.num_worker_threads);
-    // Create scheduler
-    this->scheduler_ = Scheduler::CreateInstance(this->config_);
+    // Create a scheduler for each stream and assign worker threads to streams
+    WorkerTid first_worker_thread_id = 0;
+    for(const StreamConfig& stream_config : this->config_.general_.streams) {
+        this->streams_.emplace_back(Scheduler::CreateInstance(this->config_, stream_config.num_worker_threads), first_worker_thread_id);
+        this->worker_thread_streams_.insert(this->worker_thread_streams_.end(), stream_config.num_worker_threads, this->streams_.size() - 1);
+        first_worker_thread_id += stream_config.num_worker_threads;
+    }
     // Create backend
     this->backend_ = Backend::CreateInstance(*this, this->config_);
 
@@ -107,18 +131,34 @@ void Context::Stop() {
     CHECK(this->context_state_ == ContextState::RUNNING) << "You cannot stop the context except when its in the running state";
     this->context_state_ = ContextState::STOPPING;
 
-    // Stop the scheduler (This wakes any waiting threads)
-    this->scheduler_->Stop();
-    this->number_of_current_jobs_ = 0; // The scheduler was already stopped and all jobs have been dropped.
+    // Stop the schedulers (This wakes any waiting threads)
+    for(Stream& stream : this->streams_) {
+        stream.scheduler->Stop();
+        // Jobs of a batch that was never ended were not given to the scheduler.
+        for(std::shared_ptr<Job>& job : stream.batch) {
+            job->SetJobStatus(JobStatus::FAILED);
+        }
+        stream.batch.clear();
+        stream.number_of_current_jobs = 0; // The scheduler was already stopped and all jobs have been dropped.
+    }
+    this->number_of_current_jobs_ = 0;
 
-    // Cleanup backend
+    // Cleanup backend. Worker threads that are finishing a job need the lock so release it while waiting for them to exit.
+    lock.unlock();
     this->backend_->CleanupWorker();
+    lock.lock();
 
     // Log stats
     this->stats_.LogStats();
 
     // Cleanup dynamically allocated state
-    this->scheduler_ = 0; // This removes the scheduler's reference from the context therefore deallocating the object.
+    for(Stream& stream : this->streams_) {
+        if(stream.event_fd >= 0) {
+            close(stream.event_fd);
+        }
+    }
+    this->streams_.clear(); // This removes the schedulers' references from the context therefore deallocating the objects.
+    this->worker_thread_streams_.clear();
     this->backend_ = 0; // This removes the backend's reference from the context therefore deallocating the object.
 
     this->context_state_ = ContextState::STOPPED;
@@ -130,9 +170,11 @@ void Context::Stop() {
     VLOG(0) << "Stopped switchml context";
 }
 
-std::shared_ptr<Job> Context::AllReduceAsync(void* in_ptr, void* out_ptr, uint64_t numel, DataType data_type, AllReduceOperation all_reduce_operation) {
+std::shared_ptr<Job> Context::AllReduceAsync(void* in_ptr, void* out_ptr, uint64_t numel, DataType data_type, AllReduceOperation all_reduce_operation,
+                                             JobPriority priority, StreamId stream, clock::duration deadline) {
     LOG_IF(FATAL, this->context_state_ != ContextState::RUNNING) 
         << "You cannot submit a job to the context unless it is in the running state. Current context state: " << this->context_state_ << ".";
+    LOG_IF(FATAL, stream >= this->streams_.size()) << "There is no stream with id '" << stream << "'.";
 
     Tensor tensor;
     tensor.in_ptr = in_ptr;
@@ -141,55 +183,526 @@ std::shared_ptr<Job> Context::AllReduceAsync(void* in_ptr, void* out_ptr, uint64
     tensor.data_type = data_type;
     union ExtraJobInfo extras;
     extras.allreduce_operation = all_reduce_operation;
-    std::shared_ptr<Job> job = std::make_shared<Job>(tensor, JobType::ALLREDUCE, extras);
-    {
-        std::unique_lock<std::mutex> lock(this->access_mutex_);
-        this->number_of_current_jobs_++;
+    std::shared_ptr<Job> job = std::allocate_shared<Job>(PoolAllocator<Job>(), tensor, JobType::ALLREDUCE, extras, priority, deadline);
+    this->SubmitJob(job, stream);
+    return job;
+}
+
+std::shared_ptr<Job> Context::AllReduce(void* in_ptr, void* out_ptr, uint64_t numel, DataType data_type, AllReduceOperation all_reduce_operation,
+                                        JobPriority priority, StreamId stream, clock::duration deadline) {
+    LOG_IF(FATAL, this->context_state_ != ContextState::RUNNING) 
+        << "You cannot submit a job to the context unless it is in the running state. Current context state: " << this->context_state_ << ".";
+
+    std::shared_ptr<Job> job = this->AllReduceAsync(in_ptr, out_ptr, numel, data_type, all_reduce_operation, priority, stream, deadline);
+    LOG_IF(FATAL, this->streams_[stream].batch_open) << "You cannot wait for a job of stream '" << stream << "' while a batch is open on it since the batch is only submitted by EndBatch().";
+    this->Flush(stream);
+    job->WaitToComplete();
+    return job;
+}
+
+std::shared_ptr<Job> Context::AllReduceProgressiveAsync(void* in_ptr, void* out_ptr, uint64_t numel, DataType data_type, AllReduceOperation all_reduce_operation,
+                                                        JobPriority priority, StreamId stream, clock::duration deadline) {
+    LOG_IF(FATAL, this->context_state_ != ContextState::RUNNING) 
+        << "You cannot submit a job to the context unless it is in the running state. Current context state: " << this->context_state_ << ".";
+    LOG_IF(FATAL, stream >= this->streams_.size()) << "There is no stream with id '" << stream << "'.";
+    LOG_IF(FATAL, this->config_.general_.backend == "rdma") << "Progressive input is not supported by the rdma backend.";
+
+    Tensor tensor;
+    tensor.in_ptr = in_ptr;
+    tensor.out_ptr = out_ptr;
+    tensor.numel = numel;
+    tensor.data_type = data_type;
+    union ExtraJobInfo extras;
+    extras.allreduce_operation = all_reduce_operation;
+    std::shared_ptr<Job> job = std::allocate_shared<Job>(PoolAllocator<Job>(), tensor, JobType::ALLREDUCE, extras, priority, deadline);
+    job->EnableProgressiveInput(this->config_.general_.packet_numel);
+    this->SubmitJob(job, stream);
+    return job;
+}
+
+std::shared_ptr<Job> Context::AllReduceWithChunksAsync(void* in_ptr, void* out_ptr, uint64_t numel, DataType data_type, AllReduceOperation all_reduce_operation,
+                                                       Numel chunk_numel, std::function<void(Job&, Numel, Numel)> chunk_callback,
+                                                       JobPriority priority, StreamId stream, clock::duration deadline) {
+    LOG_IF(FATAL, this->context_state_ != ContextState::RUNNING) 
+        << "You cannot submit a job to the context unless it is in the running state. Current context state: " << this->context_state_ << ".";
+    LOG_IF(FATAL, stream >= this->streams_.size()) << "There is no stream with id '" << stream << "'.";
+    LOG_IF(FATAL, this->config_.general_.prepostprocessor == "bypass") << "Chunks are counted by the prepostprocessor as it unloads the data so they cannot be tracked with the bypass prepostprocessor.";
+
+    Tensor tensor;
+    tensor.in_ptr = in_ptr;
+    tensor.out_ptr = out_ptr;
+    tensor.numel = numel;
+    tensor.data_type = data_type;
+    union ExtraJobInfo extras;
+    extras.allreduce_operation = all_reduce_operation;
+    std::shared_ptr<Job> job = std::allocate_shared<Job>(PoolAllocator<Job>(), tensor, JobType::ALLREDUCE, extras, priority, deadline);
+    job->EnableChunkCompletion(chunk_numel, std::move(chunk_callback));
+    this->SubmitJob(job, stream);
+    return job;
+}
+
+std::shared_ptr<Job> Context::AllReduceWithPostReductionAsync(void* in_ptr, void* out_ptr, uint64_t numel, DataType data_type, AllReduceOperation all_reduce_operation,
+                                                              const PostReduction& post_reduction, JobPriority priority, StreamId stream, clock::duration deadline) {
+    LOG_IF(FATAL, this->context_state_ != ContextState::RUNNING) 
+        << "You cannot submit a job to the context unless it is in the running state. Current context state: " << this->context_state_ << ".";
+    LOG_IF(FATAL, stream >= this->streams_.size()) << "There is no stream with id '" << stream << "'.";
+    LOG_IF(FATAL, this->config_.general_.prepostprocessor == "bypass") << "Post reduction kernels are applied by the prepostprocessor so they cannot be used with the bypass prepostprocessor.";
+
+    Tensor tensor;
+    tensor.in_ptr = in_ptr;
+    tensor.out_ptr = out_ptr;
+    tensor.numel = numel;
+    tensor.data_type = data_type;
+    union ExtraJobInfo extras;
+    extras.allreduce_operation = all_reduce_operation;
+    std::shared_ptr<Job> job = std::allocate_shared<Job>(PoolAllocator<Job>(), tensor, JobType::ALLREDUCE, extras, priority, deadline);
+    job->SetPostReduction(post_reduction);
+    this->SubmitJob(job, stream);
+    return job;
+}
+
+std::shared_ptr<Job> Context::AllReduceAsync(const std::vector<TensorSegment>& segments, DataType data_type, AllReduceOperation all_reduce_operation,
+                                             JobPriority priority, StreamId stream, clock::duration deadline) {
+    LOG_IF(FATAL, this->context_state_ != ContextState::RUNNING) 
+        << "You cannot submit a job to the context unless it is in the running state. Current context state: " << this->context_state_ << ".";
+    LOG_IF(FATAL, stream >= this->streams_.size()) << "There is no stream with id '" << stream << "'.";
+
+    // The tensor's pointers are null so that its slices only hold their offsets.
+    Tensor tensor;
+    tensor.in_ptr = nullptr;
+    tensor.out_ptr = nullptr;
+    tensor.numel = 0;
+    tensor.data_type = data_type;
+    for(const TensorSegment& segment : segments) {
+        tensor.numel += segment.numel;
     }
-    this->scheduler_->EnqueueJob(job);
+    union ExtraJobInfo extras;
+    extras.allreduce_operation = all_reduce_operation;
+    std::shared_ptr<Job> job = std::allocate_shared<Job>(PoolAllocator<Job>(), tensor, JobType::ALLREDUCE, extras, priority, deadline, segments);
+    this->SubmitJob(job, stream);
+    return job;
+}
 
-    this->stats_.IncJobsSubmittedNum();
-    this->stats_.AppendJobSubmittedNumel(numel);
+std::shared_ptr<Job> Context::AllReduce(const std::vector<TensorSegment>& segments, DataType data_type, AllReduceOperation all_reduce_operation,
+                                        JobPriority priority, StreamId stream, clock::duration deadline) {
+    LOG_IF(FATAL, this->context_state_ != ContextState::RUNNING) 
+        << "You cannot submit a job to the context unless it is in the running state. Current context state: " << this->context_state_ << ".";
+
+    std::shared_ptr<Job> job = this->AllReduceAsync(segments, data_type, all_reduce_operation, priority, stream, deadline);
+    LOG_IF(FATAL, this->streams_[stream].batch_open) << "You cannot wait for a job of stream '" << stream << "' while a batch is open on it since the batch is only submitted by EndBatch().";
+    job->WaitToComplete();
+    return job;
+}
+
+std::vector<TensorSegment> Context::SegmentsFromStrides(void* in_ptr, void* out_ptr, DataType data_type,
+                                                        const std::vector<Numel>& shape, const std::vector<Numel>& strides) {
+    LOG_IF(FATAL, shape.size() != strides.size()) << "The shape has '" << shape.size() << "' dimensions but the strides have '" << strides.size() << "'.";
+    std::vector<TensorSegment> segments;
+    for(Numel dim_numel : shape) {
+        if(dim_numel == 0) {
+            return segments;
+        }
+    }
+
+    // Merge the trailing dimensions that are contiguous in memory into the segments.
+    size_t num_outer_dims = shape.size();
+    Numel segment_numel = 1;
+    while(num_outer_dims > 0 && strides[num_outer_dims - 1] == segment_numel) {
+        num_outer_dims--;
+        segment_numel *= shape[num_outer_dims];
+    }
+
+    // Walk over the remaining outer dimensions in row major order.
+    const uint16_t element_size = DataTypeSize(data_type);
+    std::vector<Numel> index(num_outer_dims, 0);
+    while(true) {
+        Numel offset = 0;
+        for(size_t d = 0; d < num_outer_dims; d++) {
+            offset += index[d] * strides[d];
+        }
+        TensorSegment segment;
+        segment.in_ptr = static_cast<char*>(in_ptr) + offset * element_size;
+        segment.out_ptr = static_cast<char*>(out_ptr) + offset * element_size;
+        segment.numel = segment_numel;
+        segments.push_back(segment);
+
+        // Increment the index like an odometer.
+        size_t d = num_outer_dims;
+        while(d > 0 && ++index[d - 1] == shape[d - 1]) {
+            index[d - 1] = 0;
+            d--;
+        }
+        if(d == 0) {
+            return segments;
+        }
+    }
+}
+
+std::shared_ptr<JobGroup> Context::AllReduceGroupAsync(const std::vector<Tensor>& tensors, AllReduceOperation all_reduce_operation,
+                                                       JobPriority priority, StreamId stream, clock::duration deadline) {
+    LOG_IF(FATAL, this->context_state_ != ContextState::RUNNING) 
+        << "You cannot submit a job to the context unless it is in the running state. Current context state: " << this->context_state_ << ".";
+    LOG_IF(FATAL, stream >= this->streams_.size()) << "There is no stream with id '" << stream << "'.";
+
+    union ExtraJobInfo extras;
+    extras.allreduce_operation = all_reduce_operation;
+    std::vector<std::shared_ptr<Job>> jobs;
+    jobs.reserve(tensors.size());
+    for(const Tensor& tensor : tensors) {
+        jobs.push_back(std::allocate_shared<Job>(PoolAllocator<Job>(), tensor, JobType::ALLREDUCE, extras, priority, deadline));
+    }
+    this->SubmitJobs(jobs, stream);
+    return std::make_shared<JobGroup>(std::move(jobs));
+}
+
+std::shared_ptr<JobGroup> Context::AllReduceGroup(const std::vector<Tensor>& tensors, AllReduceOperation all_reduce_operation,
+                                                  JobPriority priority, StreamId stream, clock::duration deadline) {
+    LOG_IF(FATAL, this->context_state_ != ContextState::RUNNING) 
+        << "You cannot submit a job to the context unless it is in the running state. Current context state: " << this->context_state_ << ".";
+
+    std::shared_ptr<JobGroup> job_group = this->AllReduceGroupAsync(tensors, all_reduce_operation, priority, stream, deadline);
+    LOG_IF(FATAL, this->streams_[stream].batch_open) << "You cannot wait for a job of stream '" << stream << "' while a batch is open on it since the batch is only submitted by EndBatch().";
+    job_group->WaitToComplete();
+    return job_group;
+}
+
+std::shared_ptr<Job> Context::ReduceScatterAsync(void* in_ptr, void* out_ptr, uint64_t numel, DataType data_type, AllReduceOperation all_reduce_operation,
+                                                 JobPriority priority, StreamId stream, clock::duration deadline) {
+    LOG_IF(FATAL, this->context_state_ != ContextState::RUNNING) 
+        << "You cannot submit a job to the context unless it is in the running state. Current context state: " << this->context_state_ << ".";
+    LOG_IF(FATAL, stream >= this->streams_.size()) << "There is no stream with id '" << stream << "'.";
 
+    Tensor tensor;
+    tensor.in_ptr = in_ptr;
+    tensor.out_ptr = out_ptr;
+    tensor.numel = numel;
+    tensor.data_type = data_type;
+    union ExtraJobInfo extras;
+    extras.reduce_scatter.operation = all_reduce_operation;
+    extras.reduce_scatter.shard = this->GetShard(numel);
+    std::shared_ptr<Job> job = std::allocate_shared<Job>(PoolAllocator<Job>(), tensor, JobType::REDUCE_SCATTER, extras, priority, deadline);
+    this->SubmitJob(job, stream);
     return job;
 }
 
-std::shared_ptr<Job> Context::AllReduce(void* in_ptr, void* out_ptr, uint64_t numel, DataType data_type, AllReduceOperation all_reduce_operation) {
+std::shared_ptr<Job> Context::ReduceScatter(void* in_ptr, void* out_ptr, uint64_t numel, DataType data_type, AllReduceOperation all_reduce_operation,
+                                            JobPriority priority, StreamId stream, clock::duration deadline) {
     LOG_IF(FATAL, this->context_state_ != ContextState::RUNNING) 
         << "You cannot submit a job to the context unless it is in the running state. Current context state: " << this->context_state_ << ".";
 
-    std::shared_ptr<Job> job = this->AllReduceAsync(in_ptr, out_ptr, numel, data_type, all_reduce_operation);
+    std::shared_ptr<Job> job = this->ReduceScatterAsync(in_ptr, out_ptr, numel, data_type, all_reduce_operation, priority, stream, deadline);
+    LOG_IF(FATAL, this->streams_[stream].batch_open) << "You cannot wait for a job of stream '" << stream << "' while a batch is open on it since the batch is only submitted by EndBatch().";
     job->WaitToComplete();
     return job;
 }
 
-void Context::WaitForAllJobs() {
+std::shared_ptr<Job> Context::AllGatherAsync(void* in_ptr, void* out_ptr, uint64_t numel, DataType data_type,
+                                             JobPriority priority, StreamId stream, clock::duration deadline) {
+    LOG_IF(FATAL, this->context_state_ != ContextState::RUNNING) 
+        << "You cannot submit a job to the context unless it is in the running state. Current context state: " << this->context_state_ << ".";
+    LOG_IF(FATAL, stream >= this->streams_.size()) << "There is no stream with id '" << stream << "'.";
+
+    Tensor tensor;
+    tensor.in_ptr = in_ptr;
+    tensor.out_ptr = out_ptr;
+    tensor.numel = numel;
+    tensor.data_type = data_type;
+    union ExtraJobInfo extras;
+    extras.all_gather.shard = this->GetShard(numel);
+    std::shared_ptr<Job> job = std::allocate_shared<Job>(PoolAllocator<Job>(), tensor, JobType::ALL_GATHER, extras, priority, deadline);
+    this->SubmitJob(job, stream);
+    return job;
+}
+
+std::shared_ptr<Job> Context::AllGather(void* in_ptr, void* out_ptr, uint64_t numel, DataType data_type,
+                                        JobPriority priority, StreamId stream, clock::duration deadline) {
+    LOG_IF(FATAL, this->context_state_ != ContextState::RUNNING) 
+        << "You cannot submit a job to the context unless it is in the running state. Current context state: " << this->context_state_ << ".";
+
+    std::shared_ptr<Job> job = this->AllGatherAsync(in_ptr, out_ptr, numel, data_type, priority, stream, deadline);
+    LOG_IF(FATAL, this->streams_[stream].batch_open) << "You cannot wait for a job of stream '" << stream << "' while a batch is open on it since the batch is only submitted by EndBatch().";
+    job->WaitToComplete();
+    return job;
+}
+
+std::shared_ptr<Job> Context::BroadcastAsync(void* ptr, uint64_t numel, DataType data_type, int root_rank,
+                                             JobPriority priority, StreamId stream, clock::duration deadline) {
+    LOG_IF(FATAL, this->context_state_ != ContextState::RUNNING) 
+        << "You cannot submit a job to the context unless it is in the running state. Current context state: " << this->context_state_ << ".";
+    LOG_IF(FATAL, stream >= this->streams_.size()) << "There is no stream with id '" << stream << "'.";
+    LOG_IF(FATAL, root_rank < 0 || root_rank >= this->config_.general_.num_workers) << "There is no worker with rank '" << root_rank << "'.";
+
+    Tensor tensor;
+    tensor.in_ptr = ptr;
+    tensor.out_ptr = ptr;
+    tensor.numel = numel;
+    tensor.data_type = data_type;
+    union ExtraJobInfo extras;
+    extras.broadcast_root_rank = root_rank;
+    std::shared_ptr<Job> job = std::allocate_shared<Job>(PoolAllocator<Job>(), tensor, JobType::BROADCAST, extras, priority, deadline);
+    this->SubmitJob(job, stream);
+    return job;
+}
+
+std::shared_ptr<Job> Context::Broadcast(void* ptr, uint64_t numel, DataType data_type, int root_rank,
+                                        JobPriority priority, StreamId stream, clock::duration deadline) {
+    LOG_IF(FATAL, this->context_state_ != ContextState::RUNNING) 
+        << "You cannot submit a job to the context unless it is in the running state. Current context state: " << this->context_state_ << ".";
+
+    std::shared_ptr<Job> job = this->BroadcastAsync(ptr, numel, data_type, root_rank, priority, stream, deadline);
+    LOG_IF(FATAL, this->streams_[stream].batch_open) << "You cannot wait for a job of stream '" << stream << "' while a batch is open on it since the batch is only submitted by EndBatch().";
+    job->WaitToComplete();
+    return job;
+}
+
+Shard Context::GetShard(uint64_t numel, int rank) {
+    const uint16_t num_workers = this->config_.general_.num_workers;
+    if(rank < 0) {
+        rank = this->config_.general_.rank;
+    }
+    LOG_IF(FATAL, rank >= num_workers) << "There is no worker with rank '" << rank << "'.";
+
+    const Numel max_shard_numel = (numel + num_workers - 1) / num_workers; // Roundup division
+    Shard shard;
+    shard.offset = std::min<Numel>(rank * max_shard_numel, numel);
+    shard.numel = std::min<Numel>(max_shard_numel, numel - shard.offset);
+    return shard;
+}
+
+std::shared_ptr<Plan> Context::CreatePlan(void* in_ptr, void* out_ptr, uint64_t numel, DataType data_type, AllReduceOperation all_reduce_operation,
+                                          JobPriority priority, StreamId stream) {
+    LOG_IF(FATAL, this->context_state_ != ContextState::RUNNING) 
+        << "You cannot create a plan unless the context is in the running state. Current context state: " << this->context_state_ << ".";
+    LOG_IF(FATAL, stream >= this->streams_.size()) << "There is no stream with id '" << stream << "'.";
+
+    Tensor tensor;
+    tensor.in_ptr = in_ptr;
+    tensor.out_ptr = out_ptr;
+    tensor.numel = numel;
+    tensor.data_type = data_type;
+    union ExtraJobInfo extras;
+    extras.allreduce_operation = all_reduce_operation;
+    return std::make_shared<Plan>(tensor, JobType::ALLREDUCE, extras, priority, stream);
+}
+
+std::shared_ptr<Job> Context::StartPlan(Plan& plan, clock::duration deadline) {
+    LOG_IF(FATAL, this->context_state_ != ContextState::RUNNING) 
+        << "You cannot submit a job to the context unless it is in the running state. Current context state: " << this->context_state_ << ".";
+    // The plan could have been created by another context with more streams.
+    LOG_IF(FATAL, plan.stream_ >= this->streams_.size()) << "There is no stream with id '" << plan.stream_ << "'.";
+    if(plan.last_job_) {
+        JobStatus last_job_status = plan.last_job_->GetJobStatus();
+        LOG_IF(FATAL, last_job_status != JobStatus::FINISHED && last_job_status != JobStatus::FAILED)
+            << "You cannot start a plan while its last job with id '" << plan.last_job_->id_ << "' is still running.";
+    }
+
+    plan.last_job_ = std::allocate_shared<Job>(PoolAllocator<Job>(), plan.tensor_, plan.job_type_, plan.extra_job_info_, plan.priority_, deadline);
+    this->SubmitJob(plan.last_job_, plan.stream_);
+    return plan.last_job_;
+}
+
+void Context::WaitForAllJobs(WaitPolicy wait_policy) {
     LOG_IF(FATAL, this->context_state_ != ContextState::RUNNING) 
         << "You cannot wait for all jobs unless the context is in the running state. Current context state: " << this->context_state_ << ".";
 
+    for(StreamId stream = 0; stream < this->streams_.size(); stream++) {
+        LOG_IF(FATAL, this->streams_[stream].batch_open) << "You cannot wait for all jobs while a batch is open on stream '" << stream << "' since the batch is only submitted by EndBatch().";
+        this->streams_[stream].scheduler->Flush();
+    }
+    if(wait_policy == WaitPolicy::DEFAULT_WAIT) {
+        wait_policy = this->config_.general_.wait_policy;
+    }
+    if(SpinWait(wait_policy, std::chrono::microseconds(this->config_.general_.wait_spin_us), [this] {
+        return !this->number_of_current_jobs_;
+    })) {
+        return;
+    }
+
     std::unique_lock<std::mutex> lock(this->access_mutex_);
     this->all_jobs_finished_event_.wait(lock, [this] {return !this->number_of_current_jobs_;});
 }
 
-bool Context::GetJobSlice(WorkerTid worker_thread_id, JobSlice& job_slice) {
+void Context::WaitForAllJobs(StreamId stream, WaitPolicy wait_policy) {
+    LOG_IF(FATAL, this->context_state_ != ContextState::RUNNING) 
+        << "You cannot wait for all jobs unless the context is in the running state. Current context state: " << this->context_state_ << ".";
+    LOG_IF(FATAL, stream >= this->streams_.size()) << "There is no stream with id '" << stream << "'.";
+    LOG_IF(FATAL, this->streams_[stream].batch_open) << "You cannot wait for all jobs of stream '" << stream << "' while a batch is open on it since the batch is only submitted by EndBatch().";
+
+    this->streams_[stream].scheduler->Flush();
+    if(wait_policy == WaitPolicy::DEFAULT_WAIT) {
+        wait_policy = this->config_.general_.wait_policy;
+    }
+    if(SpinWait(wait_policy, std::chrono::microseconds(this->config_.general_.wait_spin_us), [this, stream] {
+        return this->context_state_ != ContextState::RUNNING || !this->streams_[stream].number_of_current_jobs;
+    })) {
+        return;
+    }
+
+    std::unique_lock<std::mutex> lock(this->access_mutex_);
+    this->all_jobs_finished_event_.wait(lock, [this, stream] {
+        return this->context_state_ != ContextState::RUNNING || !this->streams_[stream].number_of_current_jobs;
+    });
+}
+
+void Context::Flush(StreamId stream) {
+    LOG_IF(FATAL, this->context_state_ != ContextState::RUNNING) 
+        << "You cannot flush a stream unless the context is in the running state. Current context state: " << this->context_state_ << ".";
+    LOG_IF(FATAL, stream >= this->streams_.size()) << "There is no stream with id '" << stream << "'.";
+    this->streams_[stream].scheduler->Flush();
+}
+
+void Context::BeginBatch(StreamId stream) {
+    LOG_IF(FATAL, this->context_state_ != ContextState::RUNNING) 
+        << "You cannot begin a batch unless the context is in the running state. Current context state: " << this->context_state_ << ".";
+    LOG_IF(FATAL, stream >= this->streams_.size()) << "There is no stream with id '" << stream << "'.";
+    LOG_IF(FATAL, this->streams_[stream].batch_open) << "A batch was already started on stream '" << stream << "'.";
+    this->streams_[stream].batch_open = true;
+}
+
+void Context::EndBatch(StreamId stream) {
+    LOG_IF(FATAL, this->context_state_ != ContextState::RUNNING) 
+        << "You cannot end a batch unless the context is in the running state. Current context state: " << this->context_state_ << ".";
+    LOG_IF(FATAL, stream >= this->streams_.size()) << "There is no stream with id '" << stream << "'.";
+    LOG_IF(FATAL, !this->streams_[stream].batch_open) << "No batch was started on stream '" << stream << "'.";
+    this->BeginSubmission(stream);
+    this->streams_[stream].batch_open = false;
+    if(!this->streams_[stream].batch.empty()) {
+        this->streams_[stream].scheduler->EnqueueJobs(this->streams_[stream].batch);
+        this->streams_[stream].batch.clear();
+    }
+    this->EndSubmission(stream);
+}
+
+StreamId Context::GetStreamId(const std::string& name) {
+    const std::vector<StreamConfig>& streams = this->config_.general_.streams;
+    for(StreamId stream = 0; stream < streams.size(); stream++) {
+        if(streams[stream].name == name) {
+            return stream;
+        }
+    }
+    LOG(FATAL) << "There is no stream named '" << name << "'.";
+}
+
+int Context::GetStreamEventFd(StreamId stream) {
+    LOG_IF(FATAL, this->context_state_ != ContextState::RUNNING) 
+        << "You cannot get a stream's eventfd unless the context is in the running state. Current context state: " << this->context_state_ << ".";
+    LOG_IF(FATAL, stream >= this->streams_.size()) << "There is no stream with id '" << stream << "'.";
+
+    std::unique_lock<std::mutex> lock(this->access_mutex_);
+    int& event_fd = this->streams_[stream].event_fd;
+    if(event_fd < 0) {
+        event_fd = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+        LOG_IF(FATAL, event_fd < 0) << "Could not create an eventfd for stream '" << stream << "'. " << strerror(errno);
+    }
+    return event_fd;
+}
+
+void Context::PrepareJob(const std::shared_ptr<Job>& job) {
+    job->SetDefaultWaitPolicy(this->config_.general_.wait_policy, std::chrono::microseconds(this->config_.general_.wait_spin_us));
+    if(this->backend_->CanAbortJobs()) {
+        job->EnableAborts();
+    }
+    // A timeout would leave the y tensor of the AXPY and SGD kernels partly updated.
+    if(this->config_.general_.job_timeout_ms != 0 && !job->UpdatesY()) {
+        job->SetTimeout(std::chrono::milliseconds(this->config_.general_.job_timeout_ms));
+    }
+}
+
+void Context::SubmitJob(const std::shared_ptr<Job>& job, StreamId stream) {
+    this->PrepareJob(job);
+    // No lock is needed to submit a job. The counters must be incremented before the job can finish.
+    this->number_of_current_jobs_++;
+    this->streams_[stream].number_of_current_jobs++;
+    this->BeginSubmission(stream);
+    if(this->streams_[stream].batch_open) {
+        this->streams_[stream].batch.push_back(job);
+    } else {
+        this->streams_[stream].scheduler->EnqueueJob(job);
+    }
+    this->EndSubmission(stream);
+
+    this->stats_.IncJobsSubmittedNum();
+    this->stats_.AppendJobSubmittedNumel(job->tensor_.numel);
+}
+
+void Context::SubmitJobs(const std::vector<std::shared_ptr<Job>>& jobs, StreamId stream) {
+    if(jobs.empty()) {
+        return;
+    }
+    for(const std::shared_ptr<Job>& job : jobs) {
+        this->PrepareJob(job);
+    }
+    this->number_of_current_jobs_ += jobs.size();
+    this->streams_[stream].number_of_current_jobs += jobs.size();
+    this->BeginSubmission(stream);
+    if(this->streams_[stream].batch_open) {
+        this->streams_[stream].batch.insert(this->streams_[stream].batch.end(), jobs.begin(), jobs.end());
+    } else {
+        this->streams_[stream].scheduler->EnqueueJobs(jobs);
+    }
+    this->EndSubmission(stream);
+
+    for(const std::shared_ptr<Job>& job : jobs) {
+        this->stats_.IncJobsSubmittedNum();
+        this->stats_.AppendJobSubmittedNumel(job->tensor_.numel);
+    }
+}
+
+void Context::BeginSubmission(__attribute__((unused)) StreamId stream) {
+#if DCHECK_IS_ON()
+    LOG_IF(FATAL, this->streams_[stream].submitting.exchange(true, std::memory_order_acquire))
+        << "More than one thread is submitting jobs to stream '" << stream << "' at the same time. "
+        << "All workers must submit the same jobs in the same order to each stream so give each submitting thread its own stream "
+        << "or serialize the submissions in the application.";
+#endif
+}
+
+void Context::EndSubmission(__attribute__((unused)) StreamId stream) {
+#if DCHECK_IS_ON()
+    this->streams_[stream].submitting.store(false, std::memory_order_release);
+#endif
+}
+
+bool Context::GetJobSlice(WorkerTid worker_thread_id, JobSlice& job_slice, bool block) {
     if(this->context_state_ != ContextState::RUNNING) {
         return false;
     } else {
-        return this->scheduler_->GetJobSlice(worker_thread_id, job_slice);
+        // Schedulers only know about the worker threads of their stream so translate the ids.
+        Stream& stream = this->streams_[this->worker_thread_streams_[worker_thread_id]];
+        if(!stream.scheduler->GetJobSlice(worker_thread_id - stream.first_worker_thread_id, job_slice, block)) {
+            return false;
+        }
+        job_slice.owner_tid += stream.first_worker_thread_id;
+        return true;
     }
 }
 
 void Context::NotifyJobSliceCompletion(WorkerTid worker_thread_id, const JobSlice& job_slice) {
-    bool job_finished = this->scheduler_->NotifyJobSliceCompletion(worker_thread_id, job_slice);
+    Stream& stream = this->streams_[this->worker_thread_streams_[worker_thread_id]];
+    JobSlice stream_job_slice = job_slice;
+    stream_job_slice.owner_tid -= stream.first_worker_thread_id;
+    bool job_finished = stream.scheduler->NotifyJobSliceCompletion(worker_thread_id - stream.first_worker_thread_id, stream_job_slice);
     if(job_finished){
-        job_slice.job->SetJobStatus(JobStatus::FINISHED);
+        uint64_t num_finished_jobs = stream.scheduler->FinishJob(job_slice.job, [this](Job& job) {
+            // Jobs that failed (Ex. because they were cancelled) are not counted as deadline jobs that finished.
+            if(job.deadline_ != clock::duration::max() && job.GetJobStatus() == JobStatus::FINISHED) {
+                clock::duration lateness = clock::now() - job.deadline_point_;
+                std::unique_lock<std::mutex> lock(this->access_mutex_);
+                this->stats_.AddDeadlineJobFinished(lateness);
+            }
+        });
         std::unique_lock<std::mutex> lock(this->access_mutex_);
-        this->number_of_current_jobs_--;
-        this->stats_.IncJobsFinishedNum();
+        this->number_of_current_jobs_ -= num_finished_jobs;
+        stream.number_of_current_jobs -= num_finished_jobs;
+        if(stream.event_fd >= 0) {
+            LOG_IF(WARNING, write(stream.event_fd, &num_finished_jobs, sizeof(num_finished_jobs)) != sizeof(num_finished_jobs))
+                << "Could not signal the eventfd of stream '" << this->worker_thread_streams_[worker_thread_id] << "'.";
+        }
+        this->stats_.AddJobsFinishedNum(num_finished_jobs);
         DVLOG(2) << "Finished Job with id: " << job_slice.job->id_ << " status: " << job_slice.job->GetJobStatus()
             << ". Currently running jobs: " << this->number_of_current_jobs_ << ".";
-        // If current jobs = 0 wake up threads waiting for all jobs;
-        if(!this->number_of_current_jobs_) {
+        // If the current jobs of the stream = 0 wake up threads waiting for all jobs;
+        if(!stream.number_of_current_jobs) {
             lock.unlock();
             this->all_jobs_finished_event_.notify_all();
         }
@@ -26,6 +26,9 @@
 #define SWITCHML_CONTEXT_H_
 
 #include <mutex>
+#include <vector>
+#include <deque>
+#include <atomic>
 #include <condition_variable>
 
 #include "common.h"
@@ -38,10 +41,15 @@
 namespace switchml {
 
 /**
- * @brief Singleton class that represents the SwitchML API.
+ * @brief Class that represents the SwitchML API.
  * 
  * This is the starting point for all SwitchML operations.
  * Simply create a context, start the context, do your operations, stop the context.
+ * 
+ * Each context has its own configuration, backend resources, worker threads and schedulers. Most applications only need the
+ * default context returned by GetInstance(). The switch only keeps a single session, so only one context per process can use
+ * a switch backend at a time: the rdma backend fails if another context of the process is running with it and the dpdk backend
+ * can only be used by one context in the whole life of the process. Several contexts can only run concurrently with the dummy backend.
  */
 class Context {
   public:
@@ -63,9 +71,27 @@ class Context {
 
     Context(Context&&) = delete;
     Context& operator=(Context&&) = delete;
+
+    /**
+     * @brief Default initializes all members and puts the context in the CREATED state.
+     * 
+     * It also initializes the logging library (If it was not already initialized) and logs the client library's version info.
+     * 
+     * This does not start the context as the Start() function is responsible for that.
+     * Contexts that are created directly are independent of the default context returned by GetInstance().
+     * @see Start()
+     */
+    Context();
+
+    /**
+     * @brief Makes sure that the context is stopped if Stop() was not called explicitly.
+     * 
+     * @see Stop()
+     */
+    ~Context();
     
     /**
-     * @brief Gets a reference to the single Context object.
+     * @brief Gets a reference to the default Context object.
      * 
      * A new instance is created (Constructor is called) when you call this function for the first time.
      * Subsequent calls will retrieve the same context object.
@@ -107,31 +133,385 @@ class Context {
      * 
      * The reduced tensor will be stored inplace in the same buffer provided.
      * Consider calling WaitForCompletion or GetJobStatus on the returned Job object reference to make sure that it completed.
+     * Some schedulers (Ex. the 'fusion' scheduler) hold small jobs back until more jobs are submitted. Job::WaitToComplete() dispatches
+     * such a job but call Flush() before polling its status or waiting on its completion callbacks or event fd.
+     * 
+     * Submitting does not take the context's lock so application threads can submit to different streams concurrently.
+     * SwitchML does not order submissions though: keeping the order is the application's job. All workers must submit the same jobs
+     * in the same order to each stream, so a stream must only be submitted to by one thread at a time.
+     * The simplest way to achieve that is to give each submitting thread its own stream.
+     * Debug builds fail when two threads submit to the same stream at the same time. Release builds do not check it.
      * 
      * @param [in] in_ptr Pointer to the memory where to read data
      * @param [in] out_ptr Pointer to the memory where to write processed data (The results)
      * @param [in] numel Number of elements (Not size)
      * @param [in] data_type The type of the data (FLOAT32, INT32).
      * @param [in] all_reduce_operation what kind of all reduce operation do you want to perform?
+     * @param [in] priority How urgent the job is. Jobs with higher values are dispatched before the other jobs of their batch
+     * (See BeginBatch()) by schedulers that support priorities (Ex. the 'priority' scheduler). Other schedulers ignore it.
+     * @param [in] stream The id of the stream to submit the job to (See GetStreamId()). Jobs are only ordered with respect
+     * to other jobs of the same stream. The default stream is the first one in general.streams.
+     * @param [in] deadline How long after its submission the job should be finished. Jobs of a batch (See BeginBatch()) with shorter deadlines
+     * are dispatched first by schedulers that support deadlines (Ex. the 'deadline' scheduler). Deadlines are relative so that all workers
+     * order the jobs of a batch the same way regardless of their clocks. Jobs that finish after their deadline are counted in the Stats.
+     * By default the job has no deadline.
      * @return std::shared_ptr<Job> A shared pointer to the job that was submitted.
      * @see AllReduce()
      */
-    std::shared_ptr<Job> AllReduceAsync(void* in_ptr, void* out_ptr, uint64_t numel, DataType data_type, AllReduceOperation all_reduce_operation);
+    std::shared_ptr<Job> AllReduceAsync(void* in_ptr, void* out_ptr, uint64_t numel, DataType data_type, AllReduceOperation all_reduce_operation,
+                                        JobPriority priority = 0, StreamId stream = 0, clock::duration deadline = clock::duration::max());
 
     /**
      * @brief Convenience function equivelant to calling AllReduceAsync then waiting on the returned job reference.
      * @see AllReduceAsync()
      * @see Job::WaitToComplete()
      */
-    std::shared_ptr<Job> AllReduce(void* in_ptr, void* out_ptr, uint64_t numel, DataType data_type, AllReduceOperation all_reduce_operation);
+    std::shared_ptr<Job> AllReduce(void* in_ptr, void* out_ptr, uint64_t numel, DataType data_type, AllReduceOperation all_reduce_operation,
+                                   JobPriority priority = 0, StreamId stream = 0, clock::duration deadline = clock::duration::max());
 
     /**
-     * @brief Blocks the calling thread until SwitchML finishes all submited work.
+     * @brief The function will submit an all reduce Job whose input is still being produced then return immedietly.
+     * 
+     * The worker threads only load the elements that were marked ready through Job::MarkReady() so the
+     * reduction overlaps with producing the tensor (Ex. a gradient bucket that is filled during the backward pass).
+     * The job completes once all elements were marked ready and reduced. With the dummy backend, cancel the job
+     * (See Job::Cancel()) if the tensor will never be fully produced. Other backends cannot cancel jobs. The input must not depend on jobs submitted after this one to the same stream
+     * since the worker threads only move on to them once this job completes.
+     * Not supported by the rdma backend.
+     * 
+     * @param [in] in_ptr Pointer to the memory where to read data
+     * @param [in] out_ptr Pointer to the memory where to write processed data (The results)
+     * @param [in] numel Number of elements (Not size)
+     * @param [in] data_type The type of the data (FLOAT32, INT32).
+     * @param [in] all_reduce_operation what kind of all reduce operation do you want to perform?
+     * @param [in] priority How urgent the job is. See AllReduceAsync().
+     * @param [in] stream The id of the stream to submit the job to. See AllReduceAsync().
+     * @param [in] deadline How long after its submission the job should be finished. See AllReduceAsync().
+     * @return std::shared_ptr<Job> A shared pointer to the job that was submitted.
+     */
+    std::shared_ptr<Job> AllReduceProgressiveAsync(void* in_ptr, void* out_ptr, uint64_t numel, DataType data_type, AllReduceOperation all_reduce_operation,
+                                                   JobPriority priority = 0, StreamId stream = 0, clock::duration deadline = clock::duration::max());
+
+    /**
+     * @brief The function will submit an all reduce Job that reports each chunk of its output as soon as it is written then return immedietly.
+     * 
+     * The reduced elements are written chunk by chunk in no particular order while the job runs. Each chunk is reported
+     * through the chunk callback or can be polled through Job::IsDone() so a consumer (Ex. the optimizer step of a large embedding table)
+     * can process the reduced parts of the tensor while the rest is still in flight.
+     * Chunks are counted by the prepostprocessor as it unloads the data so this cannot be used with the bypass prepostprocessor.
+     * 
+     * @param [in] in_ptr Pointer to the memory where to read data
+     * @param [in] out_ptr Pointer to the memory where to write processed data (The results)
+     * @param [in] numel Number of elements (Not size)
+     * @param [in] data_type The type of the data (FLOAT32, INT32).
+     * @param [in] all_reduce_operation what kind of all reduce operation do you want to perform?
+     * @param [in] chunk_numel The number of elements in a chunk. The last chunk can be smaller.
+     * @param [in] chunk_callback The function to call once a chunk is done or an empty function to only poll. See Job::EnableChunkCompletion().
+     * @param [in] priority How urgent the job is. See AllReduceAsync().
+     * @param [in] stream The id of the stream to submit the job to. See AllReduceAsync().
+     * @param [in] deadline How long after its submission the job should be finished. See AllReduceAsync().
+     * @return std::shared_ptr<Job> A shared pointer to the job that was submitted.
+     */
+    std::shared_ptr<Job> AllReduceWithChunksAsync(void* in_ptr, void* out_ptr, uint64_t numel, DataType data_type, AllReduceOperation all_reduce_operation,
+                                                  Numel chunk_numel, std::function<void(Job&, Numel, Numel)> chunk_callback,
+                                                  JobPriority priority = 0, StreamId stream = 0, clock::duration deadline = clock::duration::max());
+
+    /**
+     * @brief The function will submit an all reduce Job for a tensor that is scattered in memory then return immedietly.
+     * 
+     * The tensor is the concatenation of the segments' elements (Ex. a bucket of gradients or a non contiguous view. See SegmentsFromStrides()).
+     * The prepostprocessor reads and writes the segments directly while loading and unloading each packet
+     * so the segments never have to be copied into a flat buffer first.
+     * 
+     * @param [in] segments The segments of the tensor. The reduced elements of each segment are stored in its out_ptr.
+     * @param [in] data_type The type of the data (FLOAT32, INT32).
+     * @param [in] all_reduce_operation what kind of all reduce operation do you want to perform?
+     * @param [in] priority How urgent the job is. See AllReduceAsync().
+     * @param [in] stream The id of the stream to submit the job to. See AllReduceAsync().
+     * @param [in] deadline How long after its submission the job should be finished. See AllReduceAsync().
+     * @return std::shared_ptr<Job> A shared pointer to the job that was submitted.
+     */
+    std::shared_ptr<Job> AllReduceAsync(const std::vector<TensorSegment>& segments, DataType data_type, AllReduceOperation all_reduce_operation,
+                                        JobPriority priority = 0, StreamId stream = 0, clock::duration deadline = clock::duration::max());
+
+    /**
+     * @brief Convenience function equivelant to calling the segmented AllReduceAsync then waiting on the returned job reference.
+     * @see AllReduceAsync()
+     * @see Job::WaitToComplete()
+     */
+    std::shared_ptr<Job> AllReduce(const std::vector<TensorSegment>& segments, DataType data_type, AllReduceOperation all_reduce_operation,
+                                   JobPriority priority = 0, StreamId stream = 0, clock::duration deadline = clock::duration::max());
+
+    /**
+     * @brief Describe a strided (Ex. non contiguous PyTorch view) tensor as a list of contiguous segments.
+     * 
+     * Trailing dimensions that are contiguous in memory are merged so each segment is as long as possible.
+     * The input and output tensors must have the same layout.
+     * 
+     * @param [in] in_ptr Pointer to the first element of the input tensor.
+     * @param [in] out_ptr Pointer to the first element of the output tensor.
+     * @param [in] data_type The type of the data (FLOAT32, INT32).
+     * @param [in] shape The number of elements in each dimension.
+     * @param [in] strides The distance in elements between consecutive elements of each dimension.
+     * @return std::vector<TensorSegment> The segments in the tensor's logical (row major) order.
+     */
+    static std::vector<TensorSegment> SegmentsFromStrides(void* in_ptr, void* out_ptr, DataType data_type,
+                                                          const std::vector<Numel>& shape, const std::vector<Numel>& strides);
+
+    /**
+     * @brief The function will submit a group of all reduce Jobs, one for each tensor, to the Context Scheduler then return immedietly.
+     * 
+     * The whole group is submitted at once which is much cheaper than calling AllReduceAsync for each tensor.
+     * The jobs are dispatched in the same order as the tensors and each reduced tensor is stored in its out_ptr.
+     * Consider calling WaitToComplete or GetJobStatus on the returned JobGroup object reference to make sure that all jobs completed.
+     * 
+     * @param [in] tensors The tensors to reduce.
+     * @param [in] all_reduce_operation what kind of all reduce operation do you want to perform?
+     * @param [in] priority How urgent the jobs are. See AllReduceAsync().
+     * @param [in] stream The id of the stream to submit the jobs to. See AllReduceAsync().
+     * @param [in] deadline How long after their submission the jobs should be finished. See AllReduceAsync().
+     * @return std::shared_ptr<JobGroup> A shared pointer to the group of jobs that was submitted.
+     * @see AllReduceGroup()
+     */
+    std::shared_ptr<JobGroup> AllReduceGroupAsync(const std::vector<Tensor>& tensors, AllReduceOperation all_reduce_operation,
+                                                  JobPriority priority = 0, StreamId stream = 0, clock::duration deadline = clock::duration::max());
+
+    /**
+     * @brief Convenience function equivelant to calling AllReduceGroupAsync then waiting on the returned job group reference.
+     * @see AllReduceGroupAsync()
+     * @see JobGroup::WaitToComplete()
+     */
+    std::shared_ptr<JobGroup> AllReduceGroup(const std::vector<Tensor>& tensors, AllReduceOperation all_reduce_operation,
+                                             JobPriority priority = 0, StreamId stream = 0, clock::duration deadline = clock::duration::max());
+
+    /**
+     * @brief The function will submit a reduce scatter Job to the Context Scheduler then return immedietly.
+     * 
+     * The tensor is reduced across all workers like AllReduceAsync() but each worker only receives its shard of the result
+     * (See GetShard()). The elements of out_ptr outside of this worker's shard are left untouched.
+     * The whole tensor is still sent but the elements outside of the shard are not dequantized nor written back to the client's buffers
+     * which is what sharded optimizers need while saving (num_workers-1)/num_workers of the postprocessing.
+     * 
+     * @param [in] in_ptr Pointer to the memory where to read data
+     * @param [in] out_ptr Pointer to the memory where to write the shard of the results. It must be as large as the whole tensor
+     * so that the shard is written at the same offset as in the input.
+     * @param [in] numel Number of elements of the whole tensor (Not size)
+     * @param [in] data_type The type of the data (FLOAT32, INT32).
+     * @param [in] all_reduce_operation what kind of reduction operation do you want to perform?
+     * @param [in] priority How urgent the job is. See AllReduceAsync().
+     * @param [in] stream The id of the stream to submit the job to. See AllReduceAsync().
+     * @param [in] deadline How long after its submission the job should be finished. See AllReduceAsync().
+     * @return std::shared_ptr<Job> A shared pointer to the job that was submitted.
+     * @see ReduceScatter()
+     */
+    std::shared_ptr<Job> ReduceScatterAsync(void* in_ptr, void* out_ptr, uint64_t numel, DataType data_type, AllReduceOperation all_reduce_operation,
+                                            JobPriority priority = 0, StreamId stream = 0, clock::duration deadline = clock::duration::max());
+
+    /**
+     * @brief Convenience function equivelant to calling ReduceScatterAsync then waiting on the returned job reference.
+     * @see ReduceScatterAsync()
+     * @see Job::WaitToComplete()
+     */
+    std::shared_ptr<Job> ReduceScatter(void* in_ptr, void* out_ptr, uint64_t numel, DataType data_type, AllReduceOperation all_reduce_operation,
+                                       JobPriority priority = 0, StreamId stream = 0, clock::duration deadline = clock::duration::max());
+
+    /**
+     * @brief The function will submit an all gather Job to the Context Scheduler then return immedietly.
+     * 
+     * Each worker contributes its shard of the tensor (See GetShard()) and receives the whole tensor.
+     * The gather is done as an all reduce where every worker sends zeros in place of the elements outside of its shard.
+     * The zeros are generated while loading the packets and the values are sent as raw 32 bit words without quantization
+     * so FLOAT32 values are gathered exactly.
+     * 
+     * @param [in] in_ptr Pointer to the memory where to read data. Only the elements of this worker's shard are read.
+     * It must be as large as the whole tensor so that the shard is read from the same offset as in the output.
+     * @param [in] out_ptr Pointer to the memory where to write the whole gathered tensor. It can be the same as in_ptr.
+     * @param [in] numel Number of elements of the whole tensor (Not size)
+     * @param [in] data_type The type of the data (FLOAT32, INT32).
+     * @param [in] priority How urgent the job is. See AllReduceAsync().
+     * @param [in] stream The id of the stream to submit the job to. See AllReduceAsync().
+     * @param [in] deadline How long after its submission the job should be finished. See AllReduceAsync().
+     * @return std::shared_ptr<Job> A shared pointer to the job that was submitted.
+     * @see AllGather()
+     */
+    std::shared_ptr<Job> AllGatherAsync(void* in_ptr, void* out_ptr, uint64_t numel, DataType data_type,
+                                        JobPriority priority = 0, StreamId stream = 0, clock::duration deadline = clock::duration::max());
+
+    /**
+     * @brief Convenience function equivelant to calling AllGatherAsync then waiting on the returned job reference.
+     * @see AllGatherAsync()
+     * @see Job::WaitToComplete()
+     */
+    std::shared_ptr<Job> AllGather(void* in_ptr, void* out_ptr, uint64_t numel, DataType data_type,
+                                   JobPriority priority = 0, StreamId stream = 0, clock::duration deadline = clock::duration::max());
+
+    /**
+     * @brief The function will submit a broadcast Job to the Context Scheduler then return immedietly.
+     * 
+     * The tensor of the root worker is copied to the same buffer of all other workers.
+     * The broadcast is done as an all reduce where every worker other than the root sends zeros without reading its buffer.
+     * The values are sent as raw 32 bit words without quantization so FLOAT32 values are copied exactly
+     * and the exponents' extra batch is skipped.
+     * 
+     * @param [in] ptr Pointer to the memory to send from on the root and to write the results to on all other workers.
+     * @param [in] numel Number of elements (Not size)
+     * @param [in] data_type The type of the data (FLOAT32, INT32).
+     * @param [in] root_rank The rank of the worker that is broadcasting.
+     * @param [in] priority How urgent the job is. See AllReduceAsync().
+     * @param [in] stream The id of the stream to submit the job to. See AllReduceAsync().
+     * @param [in] deadline How long after its submission the job should be finished. See AllReduceAsync().
+     * @return std::shared_ptr<Job> A shared pointer to the job that was submitted.
+     * @see Broadcast()
+     */
+    std::shared_ptr<Job> BroadcastAsync(void* ptr, uint64_t numel, DataType data_type, int root_rank,
+                                        JobPriority priority = 0, StreamId stream = 0, clock::duration deadline = clock::duration::max());
+
+    /**
+     * @brief Convenience function equivelant to calling BroadcastAsync then waiting on the returned job reference.
+     * @see BroadcastAsync()
+     * @see Job::WaitToComplete()
+     */
+    std::shared_ptr<Job> Broadcast(void* ptr, uint64_t numel, DataType data_type, int root_rank,
+                                   JobPriority priority = 0, StreamId stream = 0, clock::duration deadline = clock::duration::max());
+
+    /**
+     * @brief Get the shard of a tensor that a worker receives or contributes in sharded collectives (Ex. ReduceScatterAsync(), AllGatherAsync()).
+     * 
+     * The tensor is split into num_workers contiguous shards of ceil(numel/num_workers) elements ordered by rank.
+     * The last shards can be smaller or even empty.
+     * 
+     * @param [in] numel Number of elements of the whole tensor.
+     * @param [in] rank The rank of the worker. By default the rank of this worker.
+     * @return Shard The range of elements belonging to the worker.
+     */
+    Shard GetShard(uint64_t numel, int rank = -1);
+
+    /**
+     * @brief The function will submit an all reduce Job that applies a post reduction kernel to its output then return immedietly.
+     * 
+     * The kernel (Ex. averaging or an SGD update) is applied by the prepostprocessor to each packet's elements right after it
+     * unloads them while they are still in cache, which saves the extra pass over the output that would otherwise follow the reduction.
+     * The y tensor of the AXPY and SGD kernels is indexed like the job's tensor and must not be touched until the job completes.
+     * These kernels update y in place so their jobs never time out (general.job_timeout_ms does not apply to them) and cancelling
+     * them leaves y partly updated (See Job::Cancel()).
+     * Only FLOAT32 tensors are supported and the bypass prepostprocessor cannot be used.
+     * 
+     * @param [in] in_ptr Pointer to the memory where to read data
+     * @param [in] out_ptr Pointer to the memory where to write processed data (The results)
+     * @param [in] numel Number of elements (Not size)
+     * @param [in] data_type The type of the data (Must be FLOAT32).
+     * @param [in] all_reduce_operation what kind of all reduce operation do you want to perform?
+     * @param [in] post_reduction The kernel to apply and its arguments. See PostReductionKernel.
+     * @param [in] priority How urgent the job is. See AllReduceAsync().
+     * @param [in] stream The id of the stream to submit the job to. See AllReduceAsync().
+     * @param [in] deadline How long after its submission the job should be finished. See AllReduceAsync().
+     * @return std::shared_ptr<Job> A shared pointer to the job that was submitted.
+     */
+    std::shared_ptr<Job> AllReduceWithPostReductionAsync(void* in_ptr, void* out_ptr, uint64_t numel, DataType data_type, AllReduceOperation all_reduce_operation,
+                                                         const PostReduction& post_reduction,
+                                                         JobPriority priority = 0, StreamId stream = 0, clock::duration deadline = clock::duration::max());
+
+    /**
+     * @brief Create a plan to all reduce the same tensor many times.
+     * 
+     * This is meant for tensors that are reduced repeatedly with the same buffers and sizes (Ex. every training iteration).
+     * The arguments are validated once here and each StartPlan() call only submits a new job.
+     * The parameters are the same as AllReduceAsync(). The deadline is given to each StartPlan() call instead.
+     * 
+     * @return std::shared_ptr<Plan> A shared pointer to the plan which can then be started with StartPlan().
+     * @see StartPlan()
+     */
+    std::shared_ptr<Plan> CreatePlan(void* in_ptr, void* out_ptr, uint64_t numel, DataType data_type, AllReduceOperation all_reduce_operation,
+                                     JobPriority priority = 0, StreamId stream = 0);
+
+    /**
+     * @brief Submit a job described by a plan then return immedietly.
+     * 
+     * The plan cannot be started again until its last job completes or fails.
+     * 
+     * @param [in] plan The plan created by CreatePlan().
+     * @param [in] deadline How long after its submission the job should be finished. See AllReduceAsync().
+     * @return std::shared_ptr<Job> A shared pointer to the job that was submitted.
+     * @see CreatePlan()
+     */
+    std::shared_ptr<Job> StartPlan(Plan& plan, clock::duration deadline = clock::duration::max());
+
+    /**
+     * @brief Flushes all streams (See Flush()) then blocks the calling thread until SwitchML finishes all submited work.
      * 
      * Finishing includes failing and dropping the job. So the job status should be checked.
+     * 
+     * @param [in] wait_policy Whether to spin before blocking or to never block. By default use general.wait_policy.
      * @see Job::WaitToComplete()
      */
-    void WaitForAllJobs();
+    void WaitForAllJobs(WaitPolicy wait_policy = WaitPolicy::DEFAULT_WAIT);
+
+    /**
+     * @brief Flushes a single stream (See Flush()) then blocks the calling thread until SwitchML finishes all work submitted to it.
+     * 
+     * Jobs submitted to other streams are not waited for.
+     * 
+     * @param [in] stream The id of the stream to wait for.
+     * @param [in] wait_policy Whether to spin before blocking or to never block. By default use general.wait_policy.
+     * @see WaitForAllJobs()
+     */
+    void WaitForAllJobs(StreamId stream, WaitPolicy wait_policy = WaitPolicy::DEFAULT_WAIT);
+
+    /**
+     * @brief Dispatch the jobs that the stream's scheduler is holding back until more jobs are submitted.
+     * 
+     * The 'fusion' scheduler holds small jobs back until it can fuse them with the following jobs.
+     * So call this before polling the status of such a job or waiting on its completion callbacks or event fd.
+     * Job::WaitToComplete(), WaitForAllJobs() and the blocking convenience functions already do it.
+     * All workers must call it at the same point of their sequence of submissions.
+     * 
+     * @param [in] stream The id of the stream to flush.
+     */
+    void Flush(StreamId stream = 0);
+
+    /**
+     * @brief Start collecting the jobs submitted to a stream into a batch.
+     * 
+     * All workers must dispatch the same jobs in the same order so schedulers only reorder the jobs of a single batch
+     * (Ex. by priority or deadline). Jobs that are submitted outside of a batch are dispatched in the order in which they were submitted.
+     * The jobs of the batch are held back until EndBatch() is called so do not wait for them before ending the batch.
+     * Calling a blocking function (Ex. AllReduce()) or WaitForAllJobs() on the stream while its batch is open is a fatal error.
+     * 
+     * @param [in] stream The id of the stream whose jobs to collect.
+     * @see EndBatch()
+     */
+    void BeginBatch(StreamId stream = 0);
+
+    /**
+     * @brief Submit the jobs collected since BeginBatch() to the stream's scheduler as a single batch.
+     * 
+     * @param [in] stream The id of the stream that was given to BeginBatch().
+     * @see BeginBatch()
+     */
+    void EndBatch(StreamId stream = 0);
+
+    /**
+     * @brief Look up a stream by the name given to it in general.streams.
+     * 
+     * Do this once and keep the id rather than looking it up for each job submission.
+     * 
+     * @param [in] name The name of the stream.
+     * @return StreamId The id of the stream to pass to the submission functions.
+     */
+    StreamId GetStreamId(const std::string& name);
+
+    /**
+     * @brief Get an eventfd that counts the jobs of a stream that completed or failed.
+     * 
+     * The eventfd is created the first time that this function is called for the stream and is closed when the context stops.
+     * Each job of the stream that finishes from that point on adds 1 to the eventfd's counter. So an event loop can wait
+     * for many jobs on a single file descriptor then check the status of its jobs once it becomes readable.
+     * Use Job::GetEventFd() instead to wait for a single job.
+     * 
+     * @param [in] stream The id of the stream.
+     * @return int The eventfd file descriptor.
+     */
+    int GetStreamEventFd(StreamId stream);
 
     /**
      * @brief Get the current Context State.
@@ -156,21 +536,46 @@ class Context {
 
   private:
     /**
-     * @brief Default initializes all members and puts the context in the CREATED state.
+     * @brief Apply the context's per job settings (Default wait policy, aborts and general.job_timeout_ms) to a job before it is submitted.
      * 
-     * It also initializes the logging library and logs the client library's version info.
+     * @param [in] job The job that is about to be submitted.
+     */
+    void PrepareJob(const std::shared_ptr<Job>& job);
+
+    /**
+     * @brief Submit a job to the scheduler of a stream and record it in the context's counters and stats.
      * 
-     * This does not start the context as the Start() function is responsible for that.
-     * @see Start()
+     * @param [in] job The job to submit.
+     * @param [in] stream The id of the stream to submit the job to.
      */
-    Context();
+    void SubmitJob(const std::shared_ptr<Job>& job, StreamId stream);
 
     /**
-     * @brief Makes sure that the context is stopped if Stop() was not called explicitly.
+     * @brief Submit jobs to the scheduler of a stream as a single batch or add them to the stream's open batch.
      * 
-     * @see Stop()
+     * @param [in] jobs The jobs to submit in order.
+     * @param [in] stream The id of the stream to submit the jobs to.
      */
-    ~Context();
+    void SubmitJobs(const std::vector<std::shared_ptr<Job>>& jobs, StreamId stream);
+
+    /**
+     * @brief Mark the calling thread as the one submitting jobs to a stream.
+     * 
+     * In debug builds, this fails if another thread is submitting jobs to the same stream at the same time
+     * since the jobs could then reach the scheduler in a different order on each worker.
+     * It does nothing in release builds.
+     * 
+     * @param [in] stream The id of the stream that the calling thread is submitting to.
+     * @see EndSubmission()
+     */
+    void BeginSubmission(StreamId stream);
+
+    /**
+     * @brief Mark the end of a submission started with BeginSubmission().
+     * 
+     * @param [in] stream The id of the stream that was given to BeginSubmission().
+     */
+    void EndSubmission(StreamId stream);
 
     /**
      * @brief Wrapper for the scheduler's GetJobSlice.
@@ -179,8 +584,9 @@ class Context {
      * 
      * @param [in] worker_thread_id The id of the worker thread that wants a job slice.
      * @param [out] job_slice A reference to a job slice variable. 
+     * @param [in] block Whether to wait for a job slice if none is available right away.
      */
-    bool GetJobSlice(WorkerTid worker_thread_id, JobSlice& job_slice);
+    bool GetJobSlice(WorkerTid worker_thread_id, JobSlice& job_slice, bool block = true);
 
     /**
      * @brief Wrapper for the scheduler's NotfiyJobSliceCompletion. 
@@ -202,8 +608,50 @@ class Context {
     friend class RdmaWorkerThread;
 #endif
 
-    /** The scheduler that will be used to dispatch job slices to worker threads. */
-    std::unique_ptr<Scheduler> scheduler_;
+    /**
+     * @brief The state of a single communication stream.
+     * 
+     * Each stream owns the consecutive range of worker threads starting at first_worker_thread_id.
+     */
+    struct Stream {
+        /**
+         * @brief Initialize all members.
+         * 
+         * @param [in] scheduler The scheduler of the stream.
+         * @param [in] first_worker_thread_id The id of the first worker thread that belongs to the stream.
+         */
+        Stream(std::unique_ptr<Scheduler> scheduler, WorkerTid first_worker_thread_id);
+
+        /** The scheduler that will be used to dispatch the stream's job slices to its worker threads. */
+        std::unique_ptr<Scheduler> scheduler;
+
+        /** The id of the first worker thread that belongs to the stream. */
+        WorkerTid first_worker_thread_id;
+
+        /**
+         * The number of jobs submitted to the stream that haven't finished yet.
+         * It is incremented without holding the access_mutex_ but only decremented while holding it.
+         */
+        std::atomic<int> number_of_current_jobs;
+
+        /** The eventfd to signal each time a job of the stream finishes or -1 if GetStreamEventFd() was never called. */
+        int event_fd;
+
+        /** Whether BeginBatch() was called without a matching EndBatch(). Only accessed by the submitting thread. */
+        bool batch_open;
+
+        /** The jobs collected since BeginBatch(). Only accessed by the submitting thread. */
+        std::vector<std::shared_ptr<Job>> batch;
+
+        /** Whether a thread is currently submitting jobs to the stream. Only used to catch concurrent submitters in debug builds. */
+        std::atomic<bool> submitting;
+    };
+
+    /** The communication streams in the same order as general.streams. (A deque since streams cannot be moved) */
+    std::deque<Stream> streams_;
+
+    /** Maps each worker thread id to the id of the stream that it belongs to. */
+    std::vector<StreamId> worker_thread_streams_;
 
     /** The backend that will be used for launching threads and doing communication */
     std::unique_ptr<Backend> backend_;
@@ -217,15 +665,19 @@ class Context {
     /** An atomic variable of the Current context state. */
     std::atomic<ContextState> context_state_;
 
-    /** The number of jobs submitted that haven't finished yet. */
-    int number_of_current_jobs_;
+    /**
+     * The number of jobs submitted (To all streams) that haven't finished yet.
+     * It is incremented without holding the access_mutex_ so that many threads can submit jobs without contending
+     * on it. It is only decremented while holding the access_mutex_ so waiting threads cannot miss it reaching 0.
+     */
+    std::atomic<int> number_of_current_jobs_;
     
     /** Mutex to protect access to object members and to be used by the all_jobs_finished_event */
     std::mutex access_mutex_;
     
     /** 
-     * An event that signifies that all current jobs reached 0 and that all submitted jobs have finished. 
-     * This is used by the WaitForAllJobs() function.
+     * An event that signifies that the current jobs of a stream reached 0 and that all jobs submitted to it have finished. 
+     * This is used by the WaitForAllJobs() functions.
      */
     std::condition_variable all_jobs_finished_event_;
 };
@@ -22,19 +22,58 @@
 
 #include "job.h"
 
+#include <algorithm>
+#include <cstring>
+#include <unistd.h>
+#include <sys/eventfd.h>
+
 #include "common_cc.h"
+#include "utils.h"
 
 namespace switchml {
 
-JobId Job::next_id_ = 0;
+std::atomic<JobId> Job::next_id_(0);
+
+Job::Job(Tensor tensor, JobType job_type, ExtraJobInfo extra_job_info, JobPriority priority, clock::duration deadline,
+         std::vector<TensorSegment> segments) :
+ id_(next_id_.fetch_add(1, std::memory_order_relaxed)), tensor_(tensor), job_type_(job_type), extra_job_info_(extra_job_info), priority_(priority), deadline_(deadline),
+ deadline_point_(deadline == clock::duration::max() ? clock::time_point::max() : clock::now() + deadline),
+ segments_(std::move(segments)), segment_offsets_(), ready_granularity_(0), ready_numel_(), chunk_numel_(0), done_numel_(), chunk_callback_(),
+ post_reduction_{PostReductionKernel::NO_POST_REDUCTION, 1, 0, 0, nullptr}, flush_callback_(), default_wait_policy_(WaitPolicy::BLOCK), wait_spin_duration_(clock::duration::zero()),
+ aborts_enabled_(false), abort_requested_(false), timeout_point_(clock::time_point::max()), job_status_(JobStatus::INIT), completion_callbacks_(), event_fd_(-1) {
+    if(!this->segments_.empty()) {
+        LOG_IF(FATAL, this->tensor_.in_ptr != nullptr || this->tensor_.out_ptr != nullptr) << "The pointers of a segmented tensor must be null.";
+        this->segment_offsets_.reserve(this->segments_.size());
+        Numel offset = 0;
+        for(const TensorSegment& segment : this->segments_) {
+            this->segment_offsets_.push_back(offset);
+            offset += segment.numel;
+        }
+        LOG_IF(FATAL, offset != this->tensor_.numel) << "The segments have '" << offset << "' elements but the tensor has '" << this->tensor_.numel << "'.";
+    }
+}
 
-Job::Job(Tensor tensor, JobType job_type, ExtraJobInfo extra_job_info) :
- id_(next_id_), tensor_(tensor), job_type_(job_type), extra_job_info_(extra_job_info),
- job_status_(JobStatus::INIT) {
-     Job::next_id_++;
+Job::~Job() {
+    if(this->event_fd_ >= 0) {
+        close(this->event_fd_);
+    }
 }
 
-void Job::WaitToComplete() {
+void Job::WaitToComplete(WaitPolicy wait_policy) {
+    if(wait_policy == WaitPolicy::DEFAULT_WAIT) {
+        wait_policy = this->default_wait_policy_;
+    }
+    if(this->flush_callback_ && this->job_status_ == JobStatus::QUEUED) {
+        this->flush_callback_(*this);
+    }
+    // Spinning only reads the atomic status so the job's lock is not touched unless we have to block.
+    if(SpinWait(wait_policy, this->wait_spin_duration_, [this] {
+        JobStatus job_status = this->job_status_.load(std::memory_order_acquire);
+        return job_status == JobStatus::FAILED || job_status == JobStatus::FINISHED;
+    })) {
+        return;
+    }
+
     std::unique_lock<std::mutex> lock(this->access_mutex_);
 
     this->job_finished_event_.wait(lock, [this] {
@@ -48,12 +87,274 @@ JobStatus Job::GetJobStatus() {
 
 void Job::SetJobStatus(JobStatus job_status) {
     std::unique_lock<std::mutex> lock(this->access_mutex_);
+    // Worker threads can still be picking up slices of a job that was failed by a stopping scheduler.
+    // A failed job stays failed.
+    if(this->job_status_ == JobStatus::FAILED) {
+        return;
+    }
     LOG_IF(FATAL, job_status < this->job_status_) << "Illegal change of job status. You cannot change job status from '" << this->job_status_ << "' to '" << job_status << "'";
+    // All slices of a cancelled or timed out job were released so it can finally fail.
+    if(job_status == JobStatus::FINISHED && this->abort_requested_) {
+        job_status = JobStatus::FAILED;
+    }
     this->job_status_ = job_status;
+    if(this->job_status_ == JobStatus::FAILED || this->job_status_ == JobStatus::FINISHED) {
+        this->NotifyCompletion(lock);
+    }
+}
+
+void Job::NotifyCompletion(std::unique_lock<std::mutex>& lock) {
+    std::vector<std::function<void(Job&)>> completion_callbacks = std::move(this->completion_callbacks_);
+    this->completion_callbacks_.clear();
+    if(this->event_fd_ >= 0) {
+        uint64_t one = 1;
+        LOG_IF(WARNING, write(this->event_fd_, &one, sizeof(one)) != sizeof(one)) << "Could not signal the eventfd of job id: " << this->id_ << ".";
+    }
+    lock.unlock();
+    this->job_finished_event_.notify_all();
+    for(std::function<void(Job&)>& callback : completion_callbacks) {
+        callback(*this);
+    }
+}
+
+void Job::EnableAborts() {
+    LOG_IF(FATAL, this->job_status_ != JobStatus::INIT) << "Aborts must be enabled before the job is submitted.";
+    this->aborts_enabled_ = true;
+}
+
+bool Job::Cancel() {
+    if(!this->aborts_enabled_) {
+        LOG(WARNING) << "Job id: " << this->id_ << " cannot be cancelled. Only the jobs of the dummy backend can be cancelled.";
+        return false;
+    }
+    std::unique_lock<std::mutex> lock(this->access_mutex_);
+    // Checking the status under the lock makes sure that a job that is finishing either finishes or fails but never both.
+    if(this->job_status_ == JobStatus::FAILED || this->job_status_ == JobStatus::FINISHED) {
+        return false;
+    }
+    DVLOG(2) << "Cancelling job id: " << this->id_ << ".";
+    // The worker threads can still be using the job's tensors so the job is only failed once they release all of its slices.
+    this->abort_requested_ = true;
+    return true;
+}
+
+void Job::SetTimeout(clock::duration timeout) {
+    if(!this->aborts_enabled_) {
+        LOG(WARNING) << "Job id: " << this->id_ << " cannot time out. Only the jobs of the dummy backend can time out.";
+        return;
+    }
+    LOG_IF(FATAL, this->UpdatesY()) << "Job id: " << this->id_ << " cannot time out since its post reduction kernel updates y in place "
+        << "and a timeout would leave y partly updated.";
+    this->timeout_point_.store(clock::now() + timeout, std::memory_order_relaxed);
+}
+
+bool Job::CheckAborted(clock::time_point now) {
+    if(!this->aborts_enabled_) {
+        return false;
+    }
+    if(this->abort_requested_.load(std::memory_order_acquire) || this->job_status_.load(std::memory_order_acquire) == JobStatus::FAILED) {
+        return true;
+    }
+    if(now < this->timeout_point_.load(std::memory_order_relaxed)) {
+        return false;
+    }
+    // Only the worker threads call this while they hold one of the job's slices so the job cannot have finished yet.
+    if(!this->abort_requested_.exchange(true, std::memory_order_acq_rel)) {
+        LOG(WARNING) << "Job id: " << this->id_ << " timed out.";
+    }
+    return true;
+}
+
+void Job::AddCompletionCallback(std::function<void(Job&)> callback) {
+    std::unique_lock<std::mutex> lock(this->access_mutex_);
     if(this->job_status_ == JobStatus::FAILED || this->job_status_ == JobStatus::FINISHED) {
         lock.unlock();
-        this->job_finished_event_.notify_all();
+        callback(*this);
+    } else {
+        this->completion_callbacks_.push_back(std::move(callback));
     }
 }
 
+int Job::GetEventFd() {
+    std::unique_lock<std::mutex> lock(this->access_mutex_);
+    if(this->event_fd_ < 0) {
+        this->event_fd_ = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+        LOG_IF(FATAL, this->event_fd_ < 0) << "Could not create an eventfd for job id: " << this->id_ << ". " << strerror(errno);
+        // The job might have already completed.
+        if(this->job_status_ == JobStatus::FAILED || this->job_status_ == JobStatus::FINISHED) {
+            uint64_t one = 1;
+            LOG_IF(WARNING, write(this->event_fd_, &one, sizeof(one)) != sizeof(one)) << "Could not signal the eventfd of job id: " << this->id_ << ".";
+        }
+    }
+    return this->event_fd_;
+}
+
+void Job::SetFlushCallback(std::function<void(Job&)> flush_callback) {
+    this->flush_callback_ = std::move(flush_callback);
+}
+
+void Job::SetDefaultWaitPolicy(WaitPolicy wait_policy, clock::duration spin_duration) {
+    LOG_IF(FATAL, wait_policy == WaitPolicy::DEFAULT_WAIT) << "The default wait policy cannot be DEFAULT_WAIT.";
+    this->default_wait_policy_ = wait_policy;
+    this->wait_spin_duration_ = spin_duration;
+}
+
+void Job::GetShardOfSlice(const Tensor& slice, Numel& begin, Numel& end) const {
+    Shard shard;
+    if(this->job_type_ == JobType::REDUCE_SCATTER) {
+        shard = this->extra_job_info_.reduce_scatter.shard;
+    } else if(this->job_type_ == JobType::ALL_GATHER) {
+        shard = this->extra_job_info_.all_gather.shard;
+    } else {
+        begin = 0;
+        end = slice.numel;
+        return;
+    }
+    const Numel slice_offset = this->GetSliceOffset(slice);
+    const Numel shard_begin = std::max(shard.offset, slice_offset);
+    const Numel shard_end = std::min(shard.offset + shard.numel, slice_offset + slice.numel);
+    if(shard_begin >= shard_end) {
+        begin = 0;
+        end = 0;
+        return;
+    }
+    begin = shard_begin - slice_offset;
+    end = shard_end - slice_offset;
+}
+
+Numel Job::GetSliceOffset(const Tensor& slice) const {
+    // All slices are created by offsetting the job's tensor pointers so we can recover the slice's offset from them.
+    return (reinterpret_cast<uintptr_t>(slice.in_ptr) - reinterpret_cast<uintptr_t>(this->tensor_.in_ptr)) / DataTypeSize(slice.data_type);
+}
+
+size_t Job::FindSegment(Numel offset, Numel& segment_offset) const {
+    // The last segment that starts at or before the offset. Empty segments that start at the same offset come before it.
+    auto it = std::upper_bound(this->segment_offsets_.begin(), this->segment_offsets_.end(), offset);
+    DCHECK(it != this->segment_offsets_.begin()) << "Offset '" << offset << "' is not within the segments of job id: " << this->id_ << ".";
+    --it;
+    segment_offset = *it;
+    return it - this->segment_offsets_.begin();
+}
+
+void Job::EnableProgressiveInput(Numel granularity) {
+    LOG_IF(FATAL, granularity == 0) << "The granularity of progressive input cannot be 0.";
+    LOG_IF(FATAL, this->job_status_ != JobStatus::INIT) << "Progressive input must be enabled before the job is submitted.";
+    Numel num_granules = (this->tensor_.numel + granularity - 1) / granularity; // Roundup division
+    this->ready_numel_.reset(new std::atomic<Numel>[num_granules]);
+    for(Numel i = 0; i < num_granules; i++) {
+        this->ready_numel_[i].store(0, std::memory_order_relaxed);
+    }
+    this->ready_granularity_ = granularity;
+}
+
+void Job::MarkReady(Numel offset, Numel numel) {
+    LOG_IF(FATAL, !this->IsProgressive()) << "Job id: " << this->id_ << " does not have progressive input.";
+    LOG_IF(FATAL, offset + numel > this->tensor_.numel) << "Cannot mark elements [" << offset << "-" << offset + numel
+        << ") ready since job id: " << this->id_ << " only has '" << this->tensor_.numel << "' elements.";
+    this->CountGranules(this->ready_numel_.get(), this->ready_granularity_, offset, numel, [](Numel, Numel) {});
+}
+
+bool Job::IsReady(Numel offset, Numel numel) const {
+    return !this->IsProgressive() || this->AreGranulesFull(this->ready_numel_.get(), this->ready_granularity_, offset, numel);
+}
+
+void Job::EnableChunkCompletion(Numel chunk_numel, std::function<void(Job&, Numel, Numel)> chunk_callback) {
+    LOG_IF(FATAL, chunk_numel == 0) << "The number of elements in a chunk cannot be 0.";
+    LOG_IF(FATAL, this->job_status_ != JobStatus::INIT) << "Chunk completion must be enabled before the job is submitted.";
+    Numel num_chunks = (this->tensor_.numel + chunk_numel - 1) / chunk_numel; // Roundup division
+    this->done_numel_.reset(new std::atomic<Numel>[num_chunks]);
+    for(Numel i = 0; i < num_chunks; i++) {
+        this->done_numel_[i].store(0, std::memory_order_relaxed);
+    }
+    this->chunk_numel_ = chunk_numel;
+    this->chunk_callback_ = std::move(chunk_callback);
+}
+
+void Job::MarkDone(Numel offset, Numel numel) {
+    this->CountGranules(this->done_numel_.get(), this->chunk_numel_, offset, numel, [this](Numel chunk_offset, Numel chunk_numel) {
+        DVLOG(3) << "Chunk [" << chunk_offset << "-" << chunk_offset + chunk_numel << ") of job id: " << this->id_ << " is done.";
+        if(this->chunk_callback_) {
+            this->chunk_callback_(*this, chunk_offset, chunk_numel);
+        }
+    });
+}
+
+bool Job::IsDone(Numel offset, Numel numel) const {
+    LOG_IF(FATAL, !this->TracksChunks()) << "Job id: " << this->id_ << " does not track the completion of its chunks.";
+    return this->AreGranulesFull(this->done_numel_.get(), this->chunk_numel_, offset, numel);
+}
+
+void Job::SetPostReduction(const PostReduction& post_reduction) {
+    LOG_IF(FATAL, this->job_status_ != JobStatus::INIT) << "The post reduction kernel must be set before the job is submitted.";
+    LOG_IF(FATAL, post_reduction.kernel != PostReductionKernel::NO_POST_REDUCTION && this->tensor_.data_type != DataType::FLOAT32)
+        << "Post reduction kernels only support FLOAT32 tensors.";
+    LOG_IF(FATAL, (post_reduction.kernel == PostReductionKernel::AXPY || post_reduction.kernel == PostReductionKernel::SGD) && post_reduction.y_ptr == nullptr)
+        << "The AXPY and SGD post reduction kernels need a y tensor.";
+    this->post_reduction_ = post_reduction;
+}
+
+template <typename F>
+void Job::CountGranules(std::atomic<Numel>* granule_numels, Numel granularity, Numel offset, Numel numel, F on_granule_full) {
+    Numel end = offset + numel;
+    while(offset < end) {
+        Numel granule = offset / granularity;
+        Numel granule_numel = std::min(granularity, this->tensor_.numel - granule * granularity);
+        Numel granule_end = std::min((granule + 1) * granularity, end);
+        // The release makes the elements that were written before this call visible to the threads that
+        // see the granule full through an acquire (AreGranulesFull() or the thread that fills the granule).
+        Numel counted_numel = granule_numels[granule].fetch_add(granule_end - offset, std::memory_order_acq_rel) + granule_end - offset;
+        LOG_IF(FATAL, counted_numel > granule_numel) << "Some elements of job id: " << this->id_ << " were marked more than once.";
+        if(counted_numel == granule_numel) {
+            on_granule_full(granule * granularity, granule_numel);
+        }
+        offset = granule_end;
+    }
+}
+
+bool Job::AreGranulesFull(const std::atomic<Numel>* granule_numels, Numel granularity, Numel offset, Numel numel) const {
+    if(numel == 0) {
+        return true;
+    }
+    Numel first_granule = offset / granularity;
+    Numel last_granule = (offset + numel - 1) / granularity;
+    for(Numel granule = first_granule; granule <= last_granule; granule++) {
+        Numel granule_numel = std::min(granularity, this->tensor_.numel - granule * granularity);
+        if(granule_numels[granule].load(std::memory_order_acquire) != granule_numel) {
+            return false;
+        }
+    }
+    return true;
+}
+
+JobGroup::JobGroup(std::vector<std::shared_ptr<Job>> jobs) : jobs_(std::move(jobs)) {
+    // Do nothing
+}
+
+void JobGroup::WaitToComplete(WaitPolicy wait_policy) {
+    for(const std::shared_ptr<Job>& job : this->jobs_) {
+        job->WaitToComplete(wait_policy);
+    }
+}
+
+JobStatus JobGroup::GetJobStatus() {
+    JobStatus group_status = JobStatus::FINISHED;
+    for(const std::shared_ptr<Job>& job : this->jobs_) {
+        JobStatus job_status = job->GetJobStatus();
+        if(job_status == JobStatus::FAILED) {
+            return JobStatus::FAILED;
+        }
+        group_status = std::min(group_status, job_status);
+    }
+    return group_status;
+}
+
+Plan::Plan(Tensor tensor, JobType job_type, ExtraJobInfo extra_job_info, JobPriority priority, StreamId stream) :
+ tensor_(tensor), job_type_(job_type), extra_job_info_(extra_job_info), priority_(priority), stream_(stream), last_job_() {
+     // Do nothing
+}
+
+std::shared_ptr<Job> Plan::GetLastJob() {
+    return this->last_job_;
+}
+
 } // namespace switchml
\ No newline at end of file
@@ -24,6 +24,9 @@
 #define SWITCHML_JOB_H_
 
 #include <mutex>
+#include <memory>
+#include <vector>
+#include <functional>
 #include <condition_variable>
 #include <atomic>
 
@@ -36,7 +39,9 @@ namespace switchml {
  */
 enum JobType {
     ALLREDUCE, /**< Perform an AllReduce operation */
-    BROADCAST /**< Perform a Broadcast operation. **Not yet supported** */
+    REDUCE_SCATTER, /**< Perform a ReduceScatter operation. Each worker only receives its shard of the reduced tensor. */
+    ALL_GATHER, /**< Perform an AllGather operation. Each worker contributes its shard and receives the whole tensor. */
+    BROADCAST /**< Perform a Broadcast operation. The root worker sends its tensor and all other workers receive it. */
 };
 
 /**
@@ -46,14 +51,53 @@ enum AllReduceOperation {
     SUM, /**< Use summation to reduce the tensors */
 };
 
+/**
+ * @brief A contiguous range of elements of a tensor that belongs to one worker in sharded collectives.
+ */
+struct Shard {
+    Numel offset; /**< The offset in elements of the first element of the shard. */
+    Numel numel; /**< The number of elements in the shard. */
+};
+
 /**
  * @brief Extra information specific to the collective communication job.
  */
 union ExtraJobInfo{
     AllReduceOperation allreduce_operation; /**< The operation to use for AllReduce */
+    struct {
+        AllReduceOperation operation; /**< The operation to use for ReduceScatter */
+        Shard shard; /**< The shard of the tensor that this worker receives. */
+    } reduce_scatter; /**< Information for ReduceScatter */
+    struct {
+        Shard shard; /**< The shard of the tensor that this worker contributes. */
+    } all_gather; /**< Information for AllGather */
     int32_t broadcast_root_rank; /**< The worker that is broadcasting so it knows that it should send and others will receive. */
 };
 
+/**
+ * @brief A kernel that is applied to the reduced elements while they are unloaded.
+ * 
+ * Applying it while each packet's data is still in cache saves the extra pass over the output
+ * that the application would otherwise need right after the reduction (Ex. averaging or the optimizer step).
+ */
+enum PostReductionKernel {
+    NO_POST_REDUCTION, /**< Store the reduced elements as they are */
+    SCALE,             /**< out = scale * reduced (Ex. scale = 1/num_workers to average) */
+    AXPY,              /**< out = scale * reduced then y += alpha * out */
+    SGD                /**< out = scale * reduced + weight_decay * y then y -= alpha * out. y holds the parameters and alpha is the learning rate. */
+};
+
+/**
+ * @brief The post reduction kernel of a job and its arguments.
+ */
+struct PostReduction {
+    PostReductionKernel kernel; /**< The kernel to apply. */
+    float scale; /**< The factor that the reduced elements are multiplied by. */
+    float alpha; /**< The factor of the AXPY update or the learning rate of the SGD update. */
+    float weight_decay; /**< The weight decay of the SGD update. */
+    float* y_ptr; /**< The tensor that is updated by the AXPY and SGD kernels. It has the same number of elements as the job's tensor. */
+};
+
 /**
  * @brief Describes the current status of a Job instance.
  */
@@ -80,10 +124,18 @@ public:
      * @param [in] tensor The tensor to work on for this job.
      * @param [in] job_type The type of the job.
      * @param [in] extra_job_info Extra information that might be needed for the job.
+     * @param [in] priority How urgent the job is. Only used by schedulers that support priorities.
+     * @param [in] deadline How long after its creation the job should be finished. Only used by schedulers that support deadlines and by the stats.
+     * @param [in] segments The segments of the tensor if it is scattered in memory. The tensor's pointers must then be null
+     * and its numel must be the total number of elements of the segments.
      */
-    Job(Tensor tensor, JobType job_type, ExtraJobInfo extra_job_info);
+    Job(Tensor tensor, JobType job_type, ExtraJobInfo extra_job_info, JobPriority priority = 0, clock::duration deadline = clock::duration::max(),
+        std::vector<TensorSegment> segments = {});
 
-    ~Job() = default;
+    /**
+     * @brief Closes the job's eventfd if GetEventFd() created one.
+     */
+    ~Job();
     
     Job(Job const&) = delete;
     void operator=(Job const&) = delete;
@@ -93,8 +145,85 @@ public:
 
     /**
      * @brief Block the calling thread until the job completes or fails.
+     * 
+     * If the job is held back by its stream's scheduler (Ex. in the pending group of the 'fusion' scheduler)
+     * then it is dispatched first (See SetFlushCallback()). So every worker must wait on the job at the same
+     * point of its sequence of submissions, just like Context::Flush().
+     * 
+     * @param [in] wait_policy Whether to spin before blocking or to never block. By default use the policy set by SetDefaultWaitPolicy().
+     */
+    void WaitToComplete(WaitPolicy wait_policy = WaitPolicy::DEFAULT_WAIT);
+
+    /**
+     * @brief Set the wait policy that is used when WaitToComplete() is called with DEFAULT_WAIT.
+     * 
+     * The context calls this with its general.wait_policy and general.wait_spin_us before it submits the job.
+     * So jobs of different contexts can have different default wait policies. It must not be called while the job is being waited for.
+     * 
+     * @param [in] wait_policy The default wait policy. It must not be DEFAULT_WAIT.
+     * @param [in] spin_duration How long to spin for when using the SPIN_THEN_BLOCK policy.
      */
-    void WaitToComplete();
+    void SetDefaultWaitPolicy(WaitPolicy wait_policy, clock::duration spin_duration);
+
+    /**
+     * @brief Set the function that dispatches the job if its scheduler is still holding it back.
+     * 
+     * This function must only be called by the scheduler before the job is returned to the application.
+     * WaitToComplete() calls it while the job is still queued so that waiting on the job cannot block forever.
+     * Polling GetJobStatus() or waiting on the completion callbacks or event fd does not call it, so call Context::Flush() first in that case.
+     * 
+     * @param [in] flush_callback The function to call. It receives a reference to the job.
+     */
+    void SetFlushCallback(std::function<void(Job&)> flush_callback);
+
+    /**
+     * @brief Allow the job to be cancelled or to time out.
+     * 
+     * The context calls this before it submits the job if its backend can drop job slices (See Backend::CanAbortJobs()).
+     * Only the dummy backend can. The dpdk and rdma backends must finish every job slice since the other workers'
+     * packets are aggregated in the same switch slots, so their jobs can neither be cancelled nor time out.
+     */
+    void EnableAborts();
+
+    /**
+     * @brief Cancel the job if it has not completed yet.
+     * 
+     * Worker threads skip the slices of the job that they did not start yet and abandon the slices that they are working on.
+     * The job is set to FAILED once all of its slices were released so waiting threads only return once the worker threads
+     * stopped using the job's tensors. The contents of the output tensor are undefined after a cancellation.
+     * This is a no-op that logs a warning and returns false on the dpdk and rdma backends since they cannot drop job slices
+     * (See EnableAborts()). So a job that is stuck on those backends cannot be cancelled.
+     * Cancelling a job whose post reduction kernel updates y in place (See UpdatesY()) leaves y partly updated since some of its
+     * elements were already stepped. So the application must restore y (Ex. from a checkpoint) after such a cancellation.
+     * 
+     * @return true If the job will fail.
+     * @return false If the job had already finished or failed or if it cannot be cancelled.
+     */
+    bool Cancel();
+
+    /**
+     * @brief Fail the job if it does not complete within some time.
+     * 
+     * The context calls this with general.job_timeout_ms before it submits the job.
+     * Calling it again replaces the previous timeout. The timeout is enforced by the worker threads just like Cancel().
+     * This is a no-op that logs a warning on the dpdk and rdma backends since they cannot drop job slices (See EnableAborts()).
+     * It is a fatal error to set a timeout for a job whose post reduction kernel updates y in place (See UpdatesY())
+     * since a timeout would leave y partly updated.
+     * 
+     * @param [in] timeout How long the job is allowed to take starting from now.
+     */
+    void SetTimeout(clock::duration timeout);
+
+    /**
+     * @brief Check whether the worker threads should drop the job.
+     * 
+     * If the job's timeout expired then the job is cancelled.
+     * Only backends that can drop job slices (See Backend::CanAbortJobs()) call this. It always returns false for jobs without aborts.
+     * 
+     * @param [in] now The current time.
+     * @return true If the job was cancelled, timed out, or failed.
+     */
+    bool CheckAborted(clock::time_point now = clock::now());
 
     /**
      * @brief Get the job's status.
@@ -107,12 +236,167 @@ public:
      * @brief Update the job's status and notify waiting threads if needed.
      * 
      * This function must only be called by the scheduler or the context.
-     * JobStatus must progress in an increasing order.
+     * JobStatus must progress in an increasing order. Once a job has FAILED, any further updates are ignored.
      * 
      * @param [in] job_status the new job_status
      */
     void SetJobStatus(JobStatus job_status);
 
+    /**
+     * @brief Register a function to be called once the job completes or fails.
+     * 
+     * The callback runs on the thread that completes the job which is usually the worker thread that finished its last job slice.
+     * So it should be short and must not block or submit jobs and wait for them.
+     * If the job has already completed then the callback runs right away on the calling thread.
+     * 
+     * @param [in] callback The function to call. It receives a reference to the job so that it can check its status.
+     */
+    void AddCompletionCallback(std::function<void(Job&)> callback);
+
+    /**
+     * @brief Get an eventfd that becomes readable once the job completes or fails.
+     * 
+     * The eventfd is created the first time that this function is called and is closed when the job is destroyed.
+     * This lets event loops (epoll, asyncio, libuv...) wait for jobs without dedicating a thread to each job.
+     * 
+     * @return int The eventfd file descriptor.
+     */
+    int GetEventFd();
+
+    /**
+     * @brief Find which elements of a slice of this job fall within the job's shard.
+     * 
+     * Used by the prepostprocessors to skip the elements that this worker does not need (ReduceScatter)
+     * or does not contribute (AllGather). For jobs that are not sharded (Ex. AllReduce) the whole slice is returned.
+     * 
+     * @param [in] slice A slice of this job's tensor as given to the worker threads.
+     * @param [out] begin The offset in elements within the slice of the first element in the shard.
+     * @param [out] end The offset in elements within the slice after the last element in the shard.
+     * Equal to begin if the slice does not overlap with the shard.
+     */
+    void GetShardOfSlice(const Tensor& slice, Numel& begin, Numel& end) const;
+
+    /**
+     * @brief Get the offset in elements of a slice of this job within the job's tensor.
+     * 
+     * @param [in] slice A slice of this job's tensor as given to the worker threads.
+     * @return Numel The offset of the slice's first element.
+     */
+    Numel GetSliceOffset(const Tensor& slice) const;
+
+    /**
+     * @brief Find the segment that holds an element of a segmented tensor.
+     * 
+     * @param [in] offset The offset in elements of the element within the job's tensor.
+     * @param [out] segment_offset The offset in elements of the found segment's first element within the job's tensor.
+     * @return size_t The index of the segment in segments_.
+     */
+    size_t FindSegment(Numel offset, Numel& segment_offset) const;
+
+    /**
+     * @brief Make the job wait for its input elements to be marked ready through MarkReady() before loading them.
+     * 
+     * The context calls this before it submits a job with progressive input (See Context::AllReduceProgressiveAsync()).
+     * 
+     * @param [in] granularity The number of elements whose readiness is tracked together. Usually general.packet_numel.
+     */
+    void EnableProgressiveInput(Numel granularity);
+
+    /**
+     * @brief Check whether the job was created with progressive input.
+     * 
+     * @return true If the worker threads must check IsReady() before loading input elements.
+     */
+    inline bool IsProgressive() const { return this->ready_granularity_ != 0; }
+
+    /**
+     * @brief Mark a range of input elements of a job with progressive input as ready to be sent.
+     * 
+     * The elements must not be written to after they are marked ready and each element must be marked exactly once.
+     * Ranges can be marked in any order and from any thread. The worker threads send the packets
+     * of the ready ranges as soon as they appear instead of waiting for the whole tensor.
+     * 
+     * @param [in] offset The offset in elements of the first ready element within the job's tensor.
+     * @param [in] numel The number of ready elements.
+     */
+    void MarkReady(Numel offset, Numel numel);
+
+    /**
+     * @brief Check whether a range of input elements was marked ready.
+     * 
+     * @param [in] offset The offset in elements of the first element within the job's tensor.
+     * @param [in] numel The number of elements.
+     * @return true If all of the elements were marked ready or if the job does not have progressive input.
+     */
+    bool IsReady(Numel offset, Numel numel) const;
+
+    /**
+     * @brief Make the job report each chunk of its output as soon as all of its elements were written.
+     * 
+     * The context calls this before it submits a job that tracks its chunks (See Context::AllReduceWithChunksAsync()).
+     * 
+     * @param [in] chunk_numel The number of elements in a chunk. The last chunk can be smaller.
+     * @param [in] chunk_callback The function to call once a chunk is done or an empty function to only poll through IsDone().
+     * It receives the job and the offset and number of elements of the chunk. It runs on the worker thread that wrote the
+     * chunk's last elements so it should be short and must not block or submit jobs and wait for them.
+     */
+    void EnableChunkCompletion(Numel chunk_numel, std::function<void(Job&, Numel, Numel)> chunk_callback);
+
+    /**
+     * @brief Check whether the job reports the completion of its chunks.
+     * 
+     * @return true If the prepostprocessors must call MarkDone() for the elements that they write.
+     */
+    inline bool TracksChunks() const { return this->chunk_numel_ != 0; }
+
+    /**
+     * @brief Count a range of output elements as written and call the chunk callback for the chunks that it completes.
+     * 
+     * This function must only be called by the prepostprocessors.
+     * 
+     * @param [in] offset The offset in elements of the first written element within the job's tensor.
+     * @param [in] numel The number of written elements.
+     */
+    void MarkDone(Numel offset, Numel numel);
+
+    /**
+     * @brief Check whether a range of output elements of a job that tracks its chunks was written.
+     * 
+     * The range is done once all of the chunks that it overlaps with are done so the
+     * output elements can be read before the whole job finishes.
+     * 
+     * @param [in] offset The offset in elements of the first element within the job's tensor.
+     * @param [in] numel The number of elements.
+     * @return true If all of the chunks that the range overlaps with are done.
+     */
+    bool IsDone(Numel offset, Numel numel) const;
+
+    /**
+     * @brief Set the kernel that the prepostprocessor applies to the reduced elements while unloading them.
+     * 
+     * The context calls this before it submits a job with a post reduction kernel (See Context::AllReduceWithPostReductionAsync()).
+     * 
+     * @param [in] post_reduction The kernel and its arguments.
+     */
+    void SetPostReduction(const PostReduction& post_reduction);
+
+    /**
+     * @brief Get the kernel that the prepostprocessor applies to the reduced elements while unloading them.
+     * 
+     * @return const PostReduction& The kernel and its arguments. The kernel is NO_POST_REDUCTION by default.
+     */
+    inline const PostReduction& GetPostReduction() const { return this->post_reduction_; }
+
+    /**
+     * @brief Check whether a post reduction kernel was set for this job.
+     */
+    inline bool HasPostReduction() const { return this->post_reduction_.kernel != PostReductionKernel::NO_POST_REDUCTION; }
+
+    /**
+     * @brief Check whether the job's post reduction kernel updates the y tensor in place (The AXPY and SGD kernels).
+     */
+    inline bool UpdatesY() const { return this->post_reduction_.kernel == PostReductionKernel::AXPY || this->post_reduction_.kernel == PostReductionKernel::SGD; }
+
     /** Unique identifier for the job. */
     const JobId id_;
     /** Tensor to perform the collective communication job on. */
@@ -121,10 +405,48 @@ public:
     const JobType job_type_;
     /** Extra information specific to the collective communication job. */
     const ExtraJobInfo extra_job_info_;
+    /** How urgent the job is. Jobs with higher values are more urgent. */
+    const JobPriority priority_;
+    /** How long after its creation the job should be finished. clock::duration::max() means that the job has no deadline. */
+    const clock::duration deadline_;
+    /** When the job should be finished by according to this worker's clock. Only used to record deadline misses. */
+    const clock::time_point deadline_point_;
+    /**
+     * The segments of the tensor if it is scattered in memory or empty if the tensor is contiguous.
+     * The pointers of a segmented tensor_ and of its slices are null based so they only hold offsets.
+     * The prepostprocessors then read and write the segments directly instead of the tensor's pointers.
+     */
+    const std::vector<TensorSegment> segments_;
 
 private:
-    /** Monotonically increasing counter to give unique IDs for each new job **/
-    static JobId next_id_;
+    /** Monotonically increasing counter to give unique IDs for each new job. Atomic since jobs can be created by many threads. **/
+    static std::atomic<JobId> next_id_;
+    /** The offset in elements of the first element of each segment within the tensor. */
+    std::vector<Numel> segment_offsets_;
+    /** The number of elements whose readiness is tracked together or 0 if the job does not have progressive input. */
+    Numel ready_granularity_;
+    /** The number of elements of each granule of the tensor that were marked ready. Only allocated for jobs with progressive input. */
+    std::unique_ptr<std::atomic<Numel>[]> ready_numel_;
+    /** The number of elements in a chunk or 0 if the job does not track the completion of its chunks. */
+    Numel chunk_numel_;
+    /** The number of elements of each chunk of the tensor that were written. Only allocated for jobs that track their chunks. */
+    std::unique_ptr<std::atomic<Numel>[]> done_numel_;
+    /** The function to call once a chunk is done. Can be empty. */
+    std::function<void(Job&, Numel, Numel)> chunk_callback_;
+    /** The kernel that the prepostprocessor applies to the reduced elements while unloading them. */
+    PostReduction post_reduction_;
+    /** The function that dispatches the job if its scheduler is still holding it back. Can be empty. */
+    std::function<void(Job&)> flush_callback_;
+    /** The wait policy to use when WaitToComplete() is called with DEFAULT_WAIT. */
+    WaitPolicy default_wait_policy_;
+    /** How long to spin for when using the SPIN_THEN_BLOCK wait policy. */
+    clock::duration wait_spin_duration_;
+    /** Whether the job can be cancelled or time out. */
+    bool aborts_enabled_;
+    /** Whether the job was cancelled or timed out. The job is set to FAILED instead of FINISHED once all of its slices were released. */
+    std::atomic<bool> abort_requested_;
+    /** When the job times out. clock::time_point::max() means that the job has no timeout. */
+    std::atomic<clock::time_point> timeout_point_;
     /** Describes the current status of the job. */
     std::atomic<JobStatus> job_status_;
     
@@ -132,6 +454,139 @@ private:
     std::mutex access_mutex_;
     /** An event that signifies that the job has finished */
     std::condition_variable job_finished_event_;
+
+    /** The functions to call once the job completes or fails. Protected by access_mutex_. */
+    std::vector<std::function<void(Job&)>> completion_callbacks_;
+
+    /** The eventfd to signal once the job completes or fails or -1 if GetEventFd() was never called. Protected by access_mutex_. */
+    int event_fd_;
+
+    /**
+     * @brief Notify waiting threads, signal the eventfd, and call the completion callbacks.
+     * 
+     * @param [in] lock A lock on access_mutex_ held by the caller. It is released by this function.
+     */
+    void NotifyCompletion(std::unique_lock<std::mutex>& lock);
+
+    /**
+     * @brief Add a range of elements to per granule counters and call a function for each granule that becomes full.
+     * 
+     * Used to track both the ready input elements and the done output elements.
+     * 
+     * @param [in] granule_numels The counter of each granule.
+     * @param [in] granularity The number of elements in a granule.
+     * @param [in] offset The offset in elements of the first element of the range.
+     * @param [in] numel The number of elements in the range.
+     * @param [in] on_granule_full Called with the offset and number of elements of each granule that becomes full.
+     */
+    template <typename F>
+    void CountGranules(std::atomic<Numel>* granule_numels, Numel granularity, Numel offset, Numel numel, F on_granule_full);
+
+    /**
+     * @brief Check whether all of the granules that a range of elements overlaps with are full.
+     * 
+     * @param [in] granule_numels The counter of each granule.
+     * @param [in] granularity The number of elements in a granule.
+     * @param [in] offset The offset in elements of the first element of the range.
+     * @param [in] numel The number of elements in the range.
+     * @return true If all of the granules are full.
+     */
+    bool AreGranulesFull(const std::atomic<Numel>* granule_numels, Numel granularity, Numel offset, Numel numel) const;
+};
+
+/**
+ * @brief A handle to a group of jobs that were submitted together.
+ * 
+ * It is created by the Context when a group operation is requested (Ex. Context::AllReduceGroupAsync()).
+ * The group completes once all of its jobs complete.
+ */
+class JobGroup {
+public:
+    /**
+     * @brief Construct a new JobGroup object
+     * 
+     * @param [in] jobs The jobs that make up the group.
+     */
+    JobGroup(std::vector<std::shared_ptr<Job>> jobs);
+
+    ~JobGroup() = default;
+
+    JobGroup(JobGroup const&) = delete;
+    void operator=(JobGroup const&) = delete;
+
+    JobGroup(JobGroup&&) = default;
+    JobGroup& operator=(JobGroup&&) = default;
+
+    /**
+     * @brief Block the calling thread until all jobs of the group complete or fail.
+     * 
+     * @param [in] wait_policy Whether to spin before blocking or to never block. See Job::WaitToComplete().
+     */
+    void WaitToComplete(WaitPolicy wait_policy = WaitPolicy::DEFAULT_WAIT);
+
+    /**
+     * @brief Get the status of the group as a whole.
+     * 
+     * @return JobStatus FAILED if any of the jobs failed. Otherwise the status of the least advanced job.
+     */
+    JobStatus GetJobStatus();
+
+    /** The jobs of the group in the order in which they were submitted. */
+    const std::vector<std::shared_ptr<Job>> jobs_;
+};
+
+/**
+ * @brief A persistent request that describes a job which is submitted many times.
+ * 
+ * It is created by the Context (Ex. Context::CreatePlan()) for a tensor that is reduced repeatedly like
+ * a gradient buffer that is reduced every training iteration. The arguments are validated once when the plan
+ * is created and starting the plan (Ex. Context::StartPlan()) only submits a new job made from them.
+ * Only one job of a plan can be running at a time.
+ */
+class Plan {
+public:
+    /**
+     * @brief Construct a new Plan object
+     * 
+     * @param [in] tensor The tensor that each job of the plan will work on.
+     * @param [in] job_type The type of each job of the plan.
+     * @param [in] extra_job_info Extra information specific to the collective communication job.
+     * @param [in] priority How urgent each job of the plan is.
+     * @param [in] stream The id of the stream that the jobs of the plan are submitted to.
+     */
+    Plan(Tensor tensor, JobType job_type, ExtraJobInfo extra_job_info, JobPriority priority, StreamId stream);
+
+    ~Plan() = default;
+
+    Plan(Plan const&) = delete;
+    void operator=(Plan const&) = delete;
+
+    Plan(Plan&&) = default;
+    Plan& operator=(Plan&&) = default;
+
+    /**
+     * @brief Get the job that was submitted the last time the plan was started.
+     * 
+     * @return std::shared_ptr<Job> The last job or a null pointer if the plan was never started.
+     */
+    std::shared_ptr<Job> GetLastJob();
+
+    /** The tensor that each job of the plan works on. */
+    const Tensor tensor_;
+    /** The type of each job of the plan. */
+    const JobType job_type_;
+    /** Extra information specific to the collective communication job. */
+    const ExtraJobInfo extra_job_info_;
+    /** How urgent each job of the plan is. */
+    const JobPriority priority_;
+    /** The id of the stream that the jobs of the plan are submitted to. */
+    const StreamId stream_;
+
+private:
+    friend class Context;
+
+    /** The job that was submitted the last time the plan was started. */
+    std::shared_ptr<Job> last_job_;
 };
 
 /**
@@ -145,6 +600,12 @@ struct JobSlice {
     std::shared_ptr<Job> job;
     /** The slice that the worker thread should work on */
     Tensor slice;
+    /**
+     * The worker thread that this slice is statically mapped to.
+     * Its share of the switch's slots must be used to process the slice. This is the worker thread
+     * that processes the slice unless the slice was stolen by another worker thread.
+     */
+    WorkerTid owner_tid;
 };
 
 } // namespace switchml
@@ -54,7 +54,7 @@ class PrePostProcessor {
      */
     static std::shared_ptr<PrePostProcessor> CreateInstance(Config& config, WorkerTid worker_tid, Numel ltu_size, Numel batch_num_ltus);
 
-    ~PrePostProcessor() = default;
+    virtual ~PrePostProcessor() = default;
 
     PrePostProcessor(PrePostProcessor const&) = delete;
     void operator=(PrePostProcessor const&) = delete;
@@ -85,6 +85,18 @@ class PrePostProcessor {
      */
     virtual bool NeedsExtraBatch() = 0;
 
+    /**
+     * @brief Check whether the input elements that PreprocessSingle() would read for an LTU are ready.
+     * 
+     * Backends only need to call this for the job slices of jobs with progressive input (See Job::IsProgressive())
+     * and must defer preprocessing the LTU until it returns true.
+     * 
+     * @param [in] ltu_id The id of the logical transmission unit within the current job slice.
+     * @return true If the LTU can be preprocessed.
+     * @return false If some of the input elements that it needs were not marked ready yet.
+     */
+    virtual bool IsReady(uint64_t ltu_id) = 0;
+
     /**
      * @brief Preprocess an LTU converting its representation if needed and moving its payload into the backend's buffers.
      * 
@@ -105,6 +117,9 @@ class PrePostProcessor {
      * @param [in] entries_ptr A pointer to where we will read the received payload from.
      * @param [in] extra_info A pointer to where we will read the extra info from if we need it.
      * 
+     * Implementations that write to the client's buffers must count the written elements through Job::MarkDone()
+     * for jobs that track their chunks (See Job::TracksChunks()).
+     * 
      * @see PreprocessSingle()
      */
 		virtual void PostprocessSingle(uint64_t ltu_id, void* entries_ptr, void* extra_info = nullptr) = 0;
@@ -78,6 +78,14 @@ class BypassPPP : public PrePostProcessor{
      */
     inline bool NeedsExtraBatch() override { return false; };
 
+    /**
+     * @brief always return true since nothing is loaded
+     * 
+     * @param pkt_id ignored
+     * @return true Always
+     */
+    inline bool IsReady(__attribute__((unused)) uint64_t pkt_id) override { return true; };
+
     /**
      * @brief Do nothing
      * 
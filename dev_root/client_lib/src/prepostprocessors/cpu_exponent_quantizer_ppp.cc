@@ -24,6 +24,7 @@
 
 #include <arpa/inet.h>
 #include <math.h>
+#include <cstring>
 
 #include "common_cc.h"
 
@@ -42,13 +43,22 @@ CpuExponentQuantizerPPP::CpuExponentQuantizerPPP(Config& config, WorkerTid worke
                                                  PrePostProcessor(config, worker_tid, ltu_size, batch_num_ltus),
     job_slice_(nullptr),
     scaling_factors_(nullptr),
-    total_main_num_ltus_(0)
+    scaling_factors_capacity_(0),
+    total_main_num_ltus_(0),
+    batch_num_ltus_(0),
+    quantize_(false),
+    slice_offset_(0),
+    load_begin_(0),
+    load_end_(0),
+    unload_begin_(0),
+    unload_end_(0)
 {
     // Do nothing
 }
 
 CpuExponentQuantizerPPP::~CpuExponentQuantizerPPP() {
     this->CleanupJobSlice();
+    delete [] this->scaling_factors_;
 }
 
 uint64_t CpuExponentQuantizerPPP::SetupJobSlice(JobSlice* job_slice) {
@@ -56,57 +66,106 @@ uint64_t CpuExponentQuantizerPPP::SetupJobSlice(JobSlice* job_slice) {
     uint64_t tensor_size = job_slice->slice.numel * DataTypeSize(job_slice->slice.data_type);
     this->total_main_num_ltus_ = (tensor_size + this->ltu_size_ - 1) / this->ltu_size_; // Roundup division
     this->batch_num_ltus_ = std::min(this->total_main_num_ltus_, this->batch_max_num_ltus_);
-    if (job_slice->slice.data_type == DataType::FLOAT32) {
+    // In an AllGather or a Broadcast every element is summed with zeros from all other workers so we send the raw 32 bit words
+    // instead of quantizing. This keeps float values exact and avoids the exponents' extra batch.
+    const JobType job_type = job_slice->job->job_type_;
+    this->slice_offset_ = job_slice->job->GetSliceOffset(job_slice->slice);
+    this->quantize_ = job_slice->slice.data_type == DataType::FLOAT32
+        && job_type != JobType::ALL_GATHER && job_type != JobType::BROADCAST;
+
+    // A ReduceScatter only unloads its shard, an AllGather only loads its shard, and only the root loads anything in a Broadcast.
+    Numel shard_begin, shard_end;
+    job_slice->job->GetShardOfSlice(job_slice->slice, shard_begin, shard_end);
+    this->load_begin_ = 0;
+    this->load_end_ = job_slice->slice.numel;
+    this->unload_begin_ = 0;
+    this->unload_end_ = job_slice->slice.numel;
+    if (job_type == JobType::ALL_GATHER) {
+        this->load_begin_ = shard_begin;
+        this->load_end_ = shard_end;
+    } else if (job_type == JobType::BROADCAST && job_slice->job->extra_job_info_.broadcast_root_rank != this->config_.general_.rank) {
+        this->load_end_ = 0;
+    } else if (job_type == JobType::REDUCE_SCATTER) {
+        this->unload_begin_ = shard_begin;
+        this->unload_end_ = shard_end;
+    }
+
+    // The scaling factors array is kept between job slices and only reallocated when a larger one is needed.
+    // So repeatedly reducing tensors of the same sizes never allocates.
+    if (this->quantize_ && this->total_main_num_ltus_ > this->scaling_factors_capacity_) {
+        delete [] this->scaling_factors_;
         this->scaling_factors_ = new float[this->total_main_num_ltus_];
+        this->scaling_factors_capacity_ = this->total_main_num_ltus_;
     }
     return this->total_main_num_ltus_;
 }
 
 bool CpuExponentQuantizerPPP::NeedsExtraBatch() {
-    return this->job_slice_->slice.data_type == DataType::FLOAT32;
+    return this->quantize_;
+}
+
+bool CpuExponentQuantizerPPP::IsReady(uint64_t ltu_id) {
+    uint64_t ltu_numel = this->ltu_size_ / DataTypeSize(this->job_slice_->slice.data_type);
+    auto is_main_ltu_ready = [&](uint64_t main_ltu_id) {
+        uint64_t job_slice_numel_offset = main_ltu_id * ltu_numel;
+        uint64_t ltu_numel_to_process = std::min(ltu_numel, this->job_slice_->slice.numel - job_slice_numel_offset);
+        return this->job_slice_->job->IsReady(this->slice_offset_ + job_slice_numel_offset, ltu_numel_to_process);
+    };
+    if (!this->quantize_) {
+        return is_main_ltu_ready(ltu_id);
+    }
+    // Just like in PreprocessSingle(), an LTU past the extra batch loads the LTU a batch before it
+    // and every LTU computes its own exponent.
+    if (ltu_id >= this->batch_num_ltus_ && !is_main_ltu_ready(ltu_id - this->batch_num_ltus_)) {
+        return false;
+    }
+    return ltu_id >= this->total_main_num_ltus_ || is_main_ltu_ready(ltu_id);
 }
 
 void CpuExponentQuantizerPPP::PreprocessSingle(uint64_t ltu_id, void* entries_ptr, void* exponent_ptr) {
     // Number of elements in an ltu
     uint64_t ltu_numel = this->ltu_size_ / DataTypeSize(this->job_slice_->slice.data_type);
-    if (this->job_slice_->slice.data_type == DataType::FLOAT32) {
+    if (this->quantize_) {
         // If this is not an LTU from the extra batch then we quantize and fill the backend buffers with 
         // the correct contents.
         if (ltu_id >= this->batch_num_ltus_) {
             // We subtract a batch from ltu id to ignore the empty first batch that was sent.
             ltu_id -= this->batch_num_ltus_;
             uint64_t job_slice_numel_offset = ltu_id * ltu_numel;
-            float* in_ptr = static_cast<float*>(this->job_slice_->slice.in_ptr) + job_slice_numel_offset;
-            int32_t* out_ptr = static_cast<int32_t*>(entries_ptr);
 
             uint64_t remaining_numel = this->job_slice_->slice.numel - job_slice_numel_offset;
-            uint64_t numel_to_process = std::min(ltu_numel, remaining_numel);
+            uint64_t ltu_numel_to_process = std::min(ltu_numel, remaining_numel);
             DVLOG(3) << "Worker thread '" << this->worker_tid_ << "' Quantizing/loading ltu_id=" << ltu_id + this->batch_num_ltus_ << 
-                " [" << job_slice_numel_offset << "-" << (job_slice_numel_offset + numel_to_process - 1) << "]";
+                " [" << job_slice_numel_offset << "-" << (job_slice_numel_offset + ltu_numel_to_process - 1) << "]";
 
-            uint64_t i = 0;
+            this->ForEachPiece(true, job_slice_numel_offset, ltu_numel_to_process, [&](void* piece_ptr, uint64_t piece_offset, uint64_t numel_to_process) {
+                float* in_ptr = static_cast<float*>(piece_ptr);
+                int32_t* out_ptr = static_cast<int32_t*>(entries_ptr) + piece_offset;
+
+                uint64_t i = 0;
 #ifdef VCL
-            Vec64c vectorial_byte_data;
-            Vec16f vectorial_float_data;
-            Vec16f vectorial_scaling_factor = this->scaling_factors_[ltu_id];
-            uint64_t to_vector_process = numel_to_process - numel_to_process % 16;
-            for(; i < to_vector_process; i += 16) {
-                vectorial_float_data.load(in_ptr + i);
-                // Quantization
-                vectorial_byte_data = roundi(vectorial_float_data * vectorial_scaling_factor);
-                // Byte-order conversion
-                permute64<ENDIANESS_CONVERSION>(vectorial_byte_data).store(out_ptr + i);
-            }
+                Vec64c vectorial_byte_data;
+                Vec16f vectorial_float_data;
+                Vec16f vectorial_scaling_factor = this->scaling_factors_[ltu_id];
+                uint64_t to_vector_process = numel_to_process - numel_to_process % 16;
+                for(; i < to_vector_process; i += 16) {
+                    vectorial_float_data.load(in_ptr + i);
+                    // Quantization
+                    vectorial_byte_data = roundi(vectorial_float_data * vectorial_scaling_factor);
+                    // Byte-order conversion
+                    permute64<ENDIANESS_CONVERSION>(vectorial_byte_data).store(out_ptr + i);
+                }
 #endif
-            // Quantize the remainder elements.
-            for (; i < numel_to_process; i++) {
-                out_ptr[i] = htonl(std::round(in_ptr[i] * scaling_factors_[ltu_id]));
-                DVLOG(4) << "Worker thread '" << this->worker_tid_ 
-                    << "' slice_index=" << job_slice_numel_offset + i
-                    << "' out_ptr[" << i << "]=" << out_ptr[i] 
-                    << " in_ptr[" << i << "]=" << in_ptr[i] 
-                    << " scaling_factors[" << ltu_id << "]=" << scaling_factors_[ltu_id];
-            }
+                // Quantize the remainder elements.
+                for (; i < numel_to_process; i++) {
+                    out_ptr[i] = htonl(std::round(in_ptr[i] * scaling_factors_[ltu_id]));
+                    DVLOG(4) << "Worker thread '" << this->worker_tid_ 
+                        << "' slice_index=" << job_slice_numel_offset + piece_offset + i
+                        << "' out_ptr[" << i << "]=" << out_ptr[i] 
+                        << " in_ptr[" << i << "]=" << in_ptr[i] 
+                        << " scaling_factors[" << ltu_id << "]=" << scaling_factors_[ltu_id];
+                }
+            });
 
             // Add the subtracted batch back to ltu id so that exponent calculation happens for the next LTU
             ltu_id += this->batch_num_ltus_;
@@ -116,34 +175,36 @@ void CpuExponentQuantizerPPP::PreprocessSingle(uint64_t ltu_id, void* entries_pt
         // of the next LTU. Unless we won't be sending a next LTU.
         if(ltu_id < this->total_main_num_ltus_) {
             uint64_t job_slice_numel_offset = ltu_id * ltu_numel;
-            float* in_ptr = static_cast<float*>(this->job_slice_->slice.in_ptr) + job_slice_numel_offset;
 
             uint64_t remaining_numel = this->job_slice_->slice.numel - job_slice_numel_offset;
-            uint64_t numel_to_process = std::min(ltu_numel, remaining_numel);
+            uint64_t ltu_numel_to_process = std::min(ltu_numel, remaining_numel);
 
             DVLOG(3) << "Worker thread '" << this->worker_tid_ << "' Computing exponent ltu_id=" << ltu_id << 
-                " [" << job_slice_numel_offset << "-" << (job_slice_numel_offset + numel_to_process - 1) << "]";
+                " [" << job_slice_numel_offset << "-" << (job_slice_numel_offset + ltu_numel_to_process - 1) << "]";
 
             // First step is to find the absolute maximum between the LTU elements
-            uint64_t i = 0;
             float current_max = 0;
+            this->ForEachPiece(true, job_slice_numel_offset, ltu_numel_to_process, [&](void* piece_ptr, uint64_t, uint64_t numel_to_process) {
+                float* in_ptr = static_cast<float*>(piece_ptr);
+                uint64_t i = 0;
 #ifdef VCL
-            Vec16f vectorial_current_max = 0;
-            Vec16f vectorial_float_data;
-            uint64_t to_vector_process = numel_to_process - numel_to_process % 16;
-            for(; i < to_vector_process; i += 16) {
-                vectorial_float_data.load(in_ptr + i);
-                vectorial_current_max = max(vectorial_current_max, abs(vectorial_float_data));
-            }
-            // This call has a large overhead
-            current_max = horizontal_max<Vec16f>(vectorial_current_max);
+                Vec16f vectorial_current_max = 0;
+                Vec16f vectorial_float_data;
+                uint64_t to_vector_process = numel_to_process - numel_to_process % 16;
+                for(; i < to_vector_process; i += 16) {
+                    vectorial_float_data.load(in_ptr + i);
+                    vectorial_current_max = max(vectorial_current_max, abs(vectorial_float_data));
+                }
+                // This call has a large overhead
+                current_max = std::max(current_max, horizontal_max<Vec16f>(vectorial_current_max));
 #endif
-            for (; i < numel_to_process; i++) {
-                float v = abs(in_ptr[i]);
-                if (v > current_max) {
-                    current_max = v;
+                for (; i < numel_to_process; i++) {
+                    float v = abs(in_ptr[i]);
+                    if (v > current_max) {
+                        current_max = v;
+                    }
                 }
-            }
+            });
             // Now we have the absolute maximum. 
 
             // Next we just convert it to an exponent.
@@ -151,41 +212,54 @@ void CpuExponentQuantizerPPP::PreprocessSingle(uint64_t ltu_id, void* entries_pt
 			// To calculate the exponent we select the 8 bits that represent the exponent field in the IEEE float representation.
 			// Shift the 8 bits to start from the LSB then subtract 127 to remove the exponent bias and finally add 1 because we
 			// want the exponent e and the actual value v such that 2^e >= v.
-            *exponent_int_ptr = ((*((int32_t*)(&current_max)) & 0x7f800000) >> 23) - 126;
+            // Copy the bits out instead of casting the pointer which would break strict aliasing.
+            int32_t current_max_bits;
+            memcpy(&current_max_bits, &current_max, sizeof(current_max_bits));
+            *exponent_int_ptr = ((current_max_bits & 0x7f800000) >> 23) - 126;
             DVLOG(4) << "Worker thread '" << this->worker_tid_ << "' ltu_id= " << ltu_id << " maximum=" << current_max << " exponent=" << (int) *exponent_int_ptr;
         }
 
-    } else if (this->job_slice_->slice.data_type == DataType::INT32) {
+    } else if (this->job_slice_->slice.data_type == DataType::INT32 || this->job_slice_->slice.data_type == DataType::FLOAT32) {
 
-        // Convert to big endian and send.
-        uint64_t job_slice_numel_offset = ltu_id * ltu_numel;
-        int32_t* in_ptr = static_cast<int32_t*>(this->job_slice_->slice.in_ptr) + job_slice_numel_offset;
-        int32_t* out_ptr = static_cast<int32_t*>(entries_ptr);
+        // Convert to big endian and send. Floats that are not quantized are sent as raw 32 bit words.
+        uint64_t ltu_numel_offset = ltu_id * ltu_numel;
+        uint64_t ltu_numel_to_process = std::min(ltu_numel, this->job_slice_->slice.numel - ltu_numel_offset);
 
-        uint64_t remaining_numel = this->job_slice_->slice.numel - job_slice_numel_offset;
-        uint64_t numel_to_process = std::min(ltu_numel, remaining_numel);
+        // Only load the elements that are within the load range (Ex. AllGather, Broadcast). The rest are zeroed in the backend's buffers
+        // so that the zeros never have to be materialized in the client's buffers.
+        uint64_t job_slice_numel_offset;
+        uint64_t numel_to_process = ClipToRange(ltu_numel_offset, ltu_numel_to_process, this->load_begin_, this->load_end_, job_slice_numel_offset);
+        uint64_t leading_zeros = job_slice_numel_offset - ltu_numel_offset;
+        memset(entries_ptr, 0, leading_zeros * sizeof(int32_t));
+        memset(static_cast<int32_t*>(entries_ptr) + leading_zeros + numel_to_process, 0,
+               (ltu_numel_to_process - leading_zeros - numel_to_process) * sizeof(int32_t));
 
         DVLOG(3) << "Worker thread '" << this->worker_tid_ << "' Converting endinannes/loading ltu_id=" << ltu_id << 
             " [" << job_slice_numel_offset << "-" << (job_slice_numel_offset + numel_to_process - 1) << "]";
 
-        uint64_t i = 0;
+        this->ForEachPiece(true, job_slice_numel_offset, numel_to_process, [&](void* piece_ptr, uint64_t piece_offset, uint64_t numel_to_process) {
+            int32_t* in_ptr = static_cast<int32_t*>(piece_ptr);
+            int32_t* out_ptr = static_cast<int32_t*>(entries_ptr) + leading_zeros + piece_offset;
+
+            uint64_t i = 0;
 #ifdef VCL
-        Vec64c vectorial_byte_data;
-        uint64_t to_vector_process = numel_to_process - numel_to_process % 16;
-        for(; i < to_vector_process; i += 16) {
-            vectorial_byte_data.load(in_ptr + i);
-            // Byte-order conversion
-            permute64<ENDIANESS_CONVERSION>(vectorial_byte_data).store(out_ptr + i);
-        }
+            Vec64c vectorial_byte_data;
+            uint64_t to_vector_process = numel_to_process - numel_to_process % 16;
+            for(; i < to_vector_process; i += 16) {
+                vectorial_byte_data.load(in_ptr + i);
+                // Byte-order conversion
+                permute64<ENDIANESS_CONVERSION>(vectorial_byte_data).store(out_ptr + i);
+            }
 #endif
-        // Convert the remainder elements.
-        for (; i < numel_to_process; i++) {
-            out_ptr[i] = htonl(in_ptr[i]);
-            DVLOG(4) << "Worker thread '" << this->worker_tid_ 
-                << "' slice_index=" << job_slice_numel_offset + i
-                << "' out_ptr[" << i << "]=" << out_ptr[i] 
-                << " in_ptr[" << i << "]=" << in_ptr[i];
-        }
+            // Convert the remainder elements.
+            for (; i < numel_to_process; i++) {
+                out_ptr[i] = htonl(in_ptr[i]);
+                DVLOG(4) << "Worker thread '" << this->worker_tid_ 
+                    << "' slice_index=" << job_slice_numel_offset + piece_offset + i
+                    << "' out_ptr[" << i << "]=" << out_ptr[i] 
+                    << " in_ptr[" << i << "]=" << in_ptr[i];
+            }
+        });
     } else {
         LOG(FATAL) << "Worker thread '" << this->worker_tid_ << "' '" << this->job_slice_->slice.data_type << "' is not a supported data type.";
     }
@@ -194,56 +268,46 @@ void CpuExponentQuantizerPPP::PreprocessSingle(uint64_t ltu_id, void* entries_pt
 void CpuExponentQuantizerPPP::PostprocessSingle(uint64_t ltu_id, void* entries_ptr, void* exponent_ptr) {
     // Number of elements in an ltu
     uint64_t ltu_numel = this->ltu_size_ / DataTypeSize(this->job_slice_->slice.data_type);
-    if (this->job_slice_->slice.data_type == DataType::FLOAT32) {
+    if (this->quantize_) {
         // If the LTU is not from the extra batch then let's dequantize it and move the contents
         // back to the client's buffers.
         if (ltu_id >= this->batch_num_ltus_) {
             // We subtract a batch from ltu id to ignore the empty first batch that was sent.
             ltu_id -= this->batch_num_ltus_;
-            uint64_t job_slice_numel_offset = ltu_id * ltu_numel;
+            uint64_t ltu_numel_offset = ltu_id * ltu_numel;
 
-            float* out_ptr = static_cast<float*>(this->job_slice_->slice.out_ptr) + job_slice_numel_offset;
-            int32_t* in_ptr = static_cast<int32_t*>(entries_ptr);
-
-            uint64_t remaining_numel = this->job_slice_->slice.numel - job_slice_numel_offset;
-            uint64_t numel_to_process = std::min(ltu_numel, remaining_numel);
+            // Only unload the elements that are within the shard (Ex. ReduceScatter). The rest are neither dequantized nor written.
+            uint64_t job_slice_numel_offset;
+            uint64_t numel_to_process = ClipToRange(ltu_numel_offset, ltu_numel, this->unload_begin_, this->unload_end_, job_slice_numel_offset);
 
             DVLOG(3) << "Worker thread '" << this->worker_tid_ << "' Dequantizing/unloading ltu_id=" << ltu_id + this->batch_num_ltus_ << 
                 " [" << job_slice_numel_offset << "-" << (job_slice_numel_offset + numel_to_process-1) << "]";
 
-            uint64_t i = 0;
-#ifdef VCL
-            Vec64c vectorial_byte_data;
-            Vec16f vectorial_float_data;
-            Vec16f vectorial_scaling_factor = this->scaling_factors_[ltu_id];
-            uint64_t to_vector_process = numel_to_process - numel_to_process % 16;
-            for(; i < to_vector_process; i += 16) {
-                vectorial_byte_data.load(in_ptr + i);
-
-                // Byte-order conversion
-                vectorial_float_data = to_float((Vec16i)reinterpret_i(
-                    permute64<ENDIANESS_CONVERSION>(vectorial_byte_data)));
-
-                // Dequantization
-                vectorial_float_data /= vectorial_scaling_factor;
-
-                // Move to client buffer
-                vectorial_float_data.store(out_ptr + i);
-            }
-#endif
-            // If we do not set this iterator to volatile the optimizer tries to optimize this loop and ends up causing a segfault for 
-            // specific number of elements (255) for example.
-            // Since this portion of the code is only executed rarely this does not affect performance.
-            volatile uint64_t j = i; 
-            // Dequantize the remainder elements.
-            for (; j < numel_to_process; j++) {
-                int32_t in_be = (int32_t) ntohl(in_ptr[j]);
-                out_ptr[j] = in_be / this->scaling_factors_[ltu_id];
-                DVLOG(4) << "Worker thread '" << this->worker_tid_ 
-                    << "' slice_index=" << job_slice_numel_offset + i
-                    << "' out_ptr[" << i << "]=" << out_ptr[i] 
-                    << " in_ptr[" << i << "]=" << in_ptr[i] 
-                    << " scaling_factors[" << ltu_id << "]=" << scaling_factors_[ltu_id];
+            const PostReduction& post_reduction = this->job_slice_->job->GetPostReduction();
+            this->ForEachPiece(false, job_slice_numel_offset, numel_to_process, [&](void* piece_ptr, uint64_t piece_offset, uint64_t numel_to_process) {
+                float* out_ptr = static_cast<float*>(piece_ptr);
+                int32_t* in_ptr = static_cast<int32_t*>(entries_ptr) + (job_slice_numel_offset - ltu_numel_offset) + piece_offset;
+                // The y tensor is indexed like the job's tensor even if the job's tensor is segmented.
+                float* y_ptr = post_reduction.y_ptr == nullptr ? nullptr :
+                    post_reduction.y_ptr + this->slice_offset_ + job_slice_numel_offset + piece_offset;
+
+                switch (post_reduction.kernel) {
+                    case PostReductionKernel::NO_POST_REDUCTION:
+                        this->Dequantize<PostReductionKernel::NO_POST_REDUCTION>(in_ptr, out_ptr, y_ptr, numel_to_process, this->scaling_factors_[ltu_id], post_reduction);
+                        break;
+                    case PostReductionKernel::SCALE:
+                        this->Dequantize<PostReductionKernel::SCALE>(in_ptr, out_ptr, y_ptr, numel_to_process, this->scaling_factors_[ltu_id], post_reduction);
+                        break;
+                    case PostReductionKernel::AXPY:
+                        this->Dequantize<PostReductionKernel::AXPY>(in_ptr, out_ptr, y_ptr, numel_to_process, this->scaling_factors_[ltu_id], post_reduction);
+                        break;
+                    case PostReductionKernel::SGD:
+                        this->Dequantize<PostReductionKernel::SGD>(in_ptr, out_ptr, y_ptr, numel_to_process, this->scaling_factors_[ltu_id], post_reduction);
+                        break;
+                }
+            });
+            if (this->job_slice_->job->TracksChunks()) {
+                this->job_slice_->job->MarkDone(this->slice_offset_ + job_slice_numel_offset, numel_to_process);
             }
 
             // Add the subtracted batch back to ltu_id so that the received global exponent is stored for the next LTU
@@ -259,50 +323,123 @@ void CpuExponentQuantizerPPP::PostprocessSingle(uint64_t ltu_id, void* entries_p
             DVLOG(4) << "Worker thread '" << this->worker_tid_ << "' Scaling factor=" << this->scaling_factors_[ltu_id] << " Computed from received global exponent=" << (int) exponent;
         }
 
-    } else if (this->job_slice_->slice.data_type == DataType::INT32) {
-        // Convert to little endian and store.
-        uint64_t job_slice_numel_offset = ltu_id * ltu_numel;
-        int32_t* in_ptr = static_cast<int32_t*>(entries_ptr);
-        int32_t* out_ptr = static_cast<int32_t*>(this->job_slice_->slice.out_ptr) + job_slice_numel_offset;
+    } else if (this->job_slice_->slice.data_type == DataType::INT32 || this->job_slice_->slice.data_type == DataType::FLOAT32) {
+        // Convert to little endian and store. Floats that are not quantized are received as raw 32 bit words.
+        uint64_t ltu_numel_offset = ltu_id * ltu_numel;
 
-        uint64_t remaining_numel = this->job_slice_->slice.numel - job_slice_numel_offset;
-        uint64_t numel_to_process = std::min(ltu_numel, remaining_numel);
+        // Only unload the elements that are within the shard (Ex. ReduceScatter).
+        uint64_t job_slice_numel_offset;
+        uint64_t numel_to_process = ClipToRange(ltu_numel_offset, ltu_numel, this->unload_begin_, this->unload_end_, job_slice_numel_offset);
 
         DVLOG(3) << "Worker thread '" << this->worker_tid_ << "' Converting endinannes/unloading ltu_id=" << ltu_id << 
             " [" << job_slice_numel_offset << "-" << (job_slice_numel_offset + numel_to_process - 1) << "]";
 
-        uint64_t i = 0;
+        this->ForEachPiece(false, job_slice_numel_offset, numel_to_process, [&](void* piece_ptr, uint64_t piece_offset, uint64_t numel_to_process) {
+            int32_t* in_ptr = static_cast<int32_t*>(entries_ptr) + (job_slice_numel_offset - ltu_numel_offset) + piece_offset;
+            int32_t* out_ptr = static_cast<int32_t*>(piece_ptr);
+
+            uint64_t i = 0;
 #ifdef VCL
-        Vec64c vectorial_byte_data;
-        uint64_t to_vector_process = numel_to_process - numel_to_process % 16;
-        for(; i < to_vector_process; i += 16) {
-            vectorial_byte_data.load(in_ptr + i);
-            // Byte-order conversion
-            permute64<ENDIANESS_CONVERSION>(vectorial_byte_data).store(out_ptr + i);
-        }
+            Vec64c vectorial_byte_data;
+            uint64_t to_vector_process = numel_to_process - numel_to_process % 16;
+            for(; i < to_vector_process; i += 16) {
+                vectorial_byte_data.load(in_ptr + i);
+                // Byte-order conversion
+                permute64<ENDIANESS_CONVERSION>(vectorial_byte_data).store(out_ptr + i);
+            }
 #endif
-        // If we do not set this iterator to volatile the optimizer tries to optimize this loop and ends up causing a segfault for 
-        // specific number of elements (255) for example.
-        // Since this portion of the code is only executed rarely this does not affect performance.
-        volatile uint64_t j = i;
-        // Convert the remainder elements.
-        for (;j < numel_to_process; j++) {
-            out_ptr[j] = ntohl(in_ptr[j]);
-            DVLOG(4) << "Worker thread '" << this->worker_tid_ 
-                << "' slice_index=" << job_slice_numel_offset + i
-                << "' out_ptr[" << i << "]=" << out_ptr[i] 
-                << " in_ptr[" << i << "]=" << in_ptr[i];
+            // If we do not set this iterator to volatile the optimizer tries to optimize this loop and ends up causing a segfault for 
+            // specific number of elements (255) for example.
+            // Since this portion of the code is only executed rarely this does not affect performance.
+            volatile uint64_t j = i;
+            // Convert the remainder elements.
+            for (;j < numel_to_process; j++) {
+                out_ptr[j] = ntohl(in_ptr[j]);
+                DVLOG(4) << "Worker thread '" << this->worker_tid_ 
+                    << "' slice_index=" << job_slice_numel_offset + piece_offset + i
+                    << "' out_ptr[" << i << "]=" << out_ptr[i] 
+                    << " in_ptr[" << i << "]=" << in_ptr[i];
+            }
+        });
+        if (this->job_slice_->job->TracksChunks()) {
+            this->job_slice_->job->MarkDone(this->slice_offset_ + job_slice_numel_offset, numel_to_process);
         }
     } else {
         LOG(FATAL) << "Worker thread '" << this->worker_tid_ << "' '" << this->job_slice_->slice.data_type << "' is not a supported data type.";
     } 
 }
 
-void CpuExponentQuantizerPPP::CleanupJobSlice() {
-    if (this->scaling_factors_ != nullptr) {
-        delete [] this->scaling_factors_;
-        this->scaling_factors_ = nullptr;
+template <PostReductionKernel kernel>
+void CpuExponentQuantizerPPP::Dequantize(const int32_t* in_ptr, float* out_ptr, float* y_ptr, uint64_t numel,
+                                         float scaling_factor, const PostReduction& post_reduction) {
+    uint64_t i = 0;
+#ifdef VCL
+    Vec64c vectorial_byte_data;
+    Vec16f vectorial_float_data;
+    Vec16f vectorial_scaling_factor = scaling_factor;
+    Vec16f vectorial_scale = post_reduction.scale;
+    Vec16f vectorial_alpha = post_reduction.alpha;
+    Vec16f vectorial_weight_decay = post_reduction.weight_decay;
+    Vec16f vectorial_y;
+    uint64_t to_vector_process = numel - numel % 16;
+    for(; i < to_vector_process; i += 16) {
+        vectorial_byte_data.load(in_ptr + i);
+
+        // Byte-order conversion
+        vectorial_float_data = to_float((Vec16i)reinterpret_i(
+            permute64<ENDIANESS_CONVERSION>(vectorial_byte_data)));
+
+        // Dequantization
+        vectorial_float_data /= vectorial_scaling_factor;
+
+        // Post reduction
+        if constexpr (kernel != PostReductionKernel::NO_POST_REDUCTION) {
+            vectorial_float_data *= vectorial_scale;
+        }
+        if constexpr (kernel == PostReductionKernel::AXPY) {
+            vectorial_y.load(y_ptr + i);
+            vectorial_y = mul_add(vectorial_alpha, vectorial_float_data, vectorial_y);
+            vectorial_y.store(y_ptr + i);
+        }
+        if constexpr (kernel == PostReductionKernel::SGD) {
+            vectorial_y.load(y_ptr + i);
+            vectorial_float_data = mul_add(vectorial_weight_decay, vectorial_y, vectorial_float_data);
+            vectorial_y = nmul_add(vectorial_alpha, vectorial_float_data, vectorial_y);
+            vectorial_y.store(y_ptr + i);
+        }
+
+        // Move to client buffer
+        vectorial_float_data.store(out_ptr + i);
+    }
+#endif
+    // If we do not set this iterator to volatile the optimizer tries to optimize this loop and ends up causing a segfault for 
+    // specific number of elements (255) for example.
+    // Since this portion of the code is only executed rarely this does not affect performance.
+    volatile uint64_t j = i; 
+    // Dequantize the remainder elements.
+    for (; j < numel; j++) {
+        int32_t in_be = (int32_t) ntohl(in_ptr[j]);
+        float value = in_be / scaling_factor;
+        if constexpr (kernel != PostReductionKernel::NO_POST_REDUCTION) {
+            value *= post_reduction.scale;
+        }
+        if constexpr (kernel == PostReductionKernel::AXPY) {
+            y_ptr[j] += post_reduction.alpha * value;
+        }
+        if constexpr (kernel == PostReductionKernel::SGD) {
+            value += post_reduction.weight_decay * y_ptr[j];
+            y_ptr[j] -= post_reduction.alpha * value;
+        }
+        out_ptr[j] = value;
+        DVLOG(4) << "Worker thread '" << this->worker_tid_ 
+            << "' out_ptr[" << j << "]=" << out_ptr[j] 
+            << " in_ptr[" << j << "]=" << in_ptr[j] 
+            << " scaling_factor=" << scaling_factor;
     }
 }
 
+void CpuExponentQuantizerPPP::CleanupJobSlice() {
+    this->job_slice_ = nullptr;
+}
+
 } // namespace switchml
\ No newline at end of file
@@ -24,6 +24,8 @@
 #ifndef SWITCHML_CPU_EXPONENT_QUANTIZER_H_
 #define SWITCHML_CPU_EXPONENT_QUANTIZER_H_
 
+#include <algorithm>
+
 #include "common.h"
 #include "job.h"
 #include "config.h"
@@ -48,7 +50,7 @@ class CpuExponentQuantizerPPP : public PrePostProcessor{
     CpuExponentQuantizerPPP(Config& config, WorkerTid worker_tid, Numel ltu_size, Numel batch_num_ltus);
 
     /**
-     * @brief Calls CleanupJobSlice() to make sure that any dynamically allocated memory is released.
+     * @brief Calls CleanupJobSlice() and releases the scaling factors array.
      * 
      * @see CleanupJobSlice()
      */
@@ -80,6 +82,14 @@ class CpuExponentQuantizerPPP : public PrePostProcessor{
      */
     bool NeedsExtraBatch() override;
 
+    /**
+     * @brief Check whether the input elements of an LTU and of the LTU whose exponent it carries are ready.
+     * 
+     * @param [in] ltu_id The id of the logical transmission unit within the current job slice.
+     * @return true If the LTU can be preprocessed.
+     * @return false otherwise
+     */
+    bool IsReady(uint64_t ltu_id) override;
 
     /**
      * @brief Preprocess a tensor converting it to switchml's representation and loading it into the backend's buffers.
@@ -101,12 +111,18 @@ class CpuExponentQuantizerPPP : public PrePostProcessor{
      * @param [in] entries_ptr A pointer to where we will read the received payload from.
      * @param [in] exponent_ptr A pointer to where we will read the exponent from.
      * 
+     * If the job has a post reduction kernel (See Job::SetPostReduction()) then it is applied to the dequantized elements
+     * as they are stored so that the application does not need another pass over the output.
+     * The unloaded elements are then counted through Job::MarkDone() if the job tracks its chunks.
+     * 
      * @see PreprocessSingle()
      */
     void PostprocessSingle(uint64_t ltu_id, void* entries_ptr, void* exponent_ptr) override;
 
     /**
-     * @brief Cleans up all internal structures and release any dynamically allocated memory associated with the job slice.
+     * @brief Cleans up all internal structures associated with the job slice.
+     * 
+     * The scaling factors array is kept for the next job slice so that it does not have to be reallocated.
      * 
      * @see SetupJobSlice()
      */
@@ -119,6 +135,9 @@ class CpuExponentQuantizerPPP : public PrePostProcessor{
     /** An array of the scaling factors computed from the global exponents received from the switch */
     float* scaling_factors_;
 
+    /** How many scaling factors the scaling_factors_ array can hold. */
+    uint64_t scaling_factors_capacity_;
+
     /** 
      * The total number of LTUs to send for the currently running job slice.
      * (This means it excludes the number of extra batch ltus)
@@ -131,6 +150,110 @@ class CpuExponentQuantizerPPP : public PrePostProcessor{
      * a small number of LTUs to be transmitted.)
      */
     uint64_t batch_num_ltus_;
+
+    /**
+     * Whether the values of the currently running job slice are quantized using the exponents.
+     * Otherwise they are sent as raw 32 bit words without an extra batch.
+     */
+    bool quantize_;
+
+    /** The offset in elements of the currently running job slice within its job's tensor. */
+    uint64_t slice_offset_;
+
+    /**
+     * The range [load_begin_, load_end_) of elements of the currently running job slice that are read from the client's buffers.
+     * Zeros are sent in place of the rest. This is the whole job slice unless the job is an AllGather or a Broadcast.
+     */
+    uint64_t load_begin_;
+    uint64_t load_end_;
+
+    /**
+     * The range [unload_begin_, unload_end_) of elements of the currently running job slice that are written to the client's buffers.
+     * This is the whole job slice unless the job is a ReduceScatter.
+     */
+    uint64_t unload_begin_;
+    uint64_t unload_end_;
+
+    /**
+     * @brief Clip the elements of an LTU to a range of elements of the currently running job slice.
+     * 
+     * @param [in] ltu_numel_offset The offset of the first element of the LTU within the job slice.
+     * @param [in] ltu_numel_to_process The number of elements in the LTU.
+     * @param [in] range_begin The offset of the first element of the range within the job slice.
+     * @param [in] range_end The offset after the last element of the range within the job slice.
+     * @param [out] numel_offset The offset of the first element of the LTU that is within the range
+     * or ltu_numel_offset if none of its elements are.
+     * @return uint64_t The number of elements of the LTU that are within the range.
+     */
+    static inline uint64_t ClipToRange(uint64_t ltu_numel_offset, uint64_t ltu_numel_to_process,
+                                       uint64_t range_begin, uint64_t range_end, uint64_t& numel_offset) {
+        uint64_t begin = std::max(ltu_numel_offset, range_begin);
+        uint64_t end = std::min(ltu_numel_offset + ltu_numel_to_process, range_end);
+        if (begin >= end) {
+            numel_offset = ltu_numel_offset;
+            return 0;
+        }
+        numel_offset = begin;
+        return end - begin;
+    }
+
+    /**
+     * @brief Dequantize received elements into the client's buffer and apply a post reduction kernel to them.
+     * 
+     * The kernel is a template parameter so that the loops of each kernel are compiled separately
+     * and the plain dequantization loop is left untouched.
+     * 
+     * @tparam kernel The post reduction kernel to apply.
+     * @param [in] in_ptr A pointer to the received big endian quantized elements.
+     * @param [out] out_ptr A pointer to where we will store the dequantized elements.
+     * @param [in,out] y_ptr A pointer to the elements of the kernel's y tensor that correspond to out_ptr. Ignored by NO_POST_REDUCTION and SCALE.
+     * @param [in] numel The number of elements to dequantize.
+     * @param [in] scaling_factor The scaling factor computed from the global exponent of the LTU.
+     * @param [in] post_reduction The arguments of the kernel.
+     */
+    template <PostReductionKernel kernel>
+    void Dequantize(const int32_t* in_ptr, float* out_ptr, float* y_ptr, uint64_t numel, float scaling_factor, const PostReduction& post_reduction);
+
+    /**
+     * @brief Call a function on each contiguous piece of the client's memory that holds a range of elements of the currently running job slice.
+     * 
+     * A contiguous tensor has a single piece while a segmented tensor (See Job::segments_) has a piece for every segment
+     * that overlaps with the range. This lets us load and unload segmented tensors directly without staging copies.
+     * 
+     * @param [in] input Whether to walk the input pointers or the output pointers.
+     * @param [in] numel_offset The offset of the first element of the range within the job slice.
+     * @param [in] numel The number of elements in the range.
+     * @param [in] f The function to call with a pointer to the piece, the offset in elements of the piece within the range,
+     * and the number of elements in the piece.
+     */
+    template <typename F>
+    inline void ForEachPiece(bool input, uint64_t numel_offset, uint64_t numel, F f) {
+        const Job& job = *this->job_slice_->job;
+        const Tensor& slice = this->job_slice_->slice;
+        const uint16_t element_size = DataTypeSize(slice.data_type);
+        if (numel == 0) {
+            return;
+        }
+        if (job.segments_.empty()) {
+            f(static_cast<char*>(input ? slice.in_ptr : slice.out_ptr) + numel_offset * element_size, 0, numel);
+            return;
+        }
+        const Numel tensor_offset = this->slice_offset_ + numel_offset;
+        Numel segment_offset;
+        size_t segment_index = job.FindSegment(tensor_offset, segment_offset);
+        uint64_t done = 0;
+        while (done < numel) {
+            const TensorSegment& segment = job.segments_[segment_index];
+            const Numel offset_in_segment = tensor_offset + done - segment_offset;
+            const uint64_t piece_numel = std::min<uint64_t>(numel - done, segment.numel - offset_in_segment);
+            if (piece_numel > 0) {
+                f(static_cast<char*>(input ? segment.in_ptr : segment.out_ptr) + offset_in_segment * element_size, done, piece_numel);
+            }
+            done += piece_numel;
+            segment_offset += segment.numel;
+            segment_index++;
+        }
+    }
 };
 
 } // namespace switchml
@@ -22,27 +22,106 @@
 
 #include "scheduler.h"
 #include "fifo_scheduler.h"
+#include "priority_scheduler.h"
+#include "chunked_scheduler.h"
+#include "fusion_scheduler.h"
+#include "work_stealing_scheduler.h"
+#include "deadline_scheduler.h"
+
+#include <numeric>
+#include <algorithm>
 
 #include "common_cc.h"
 
 namespace switchml {
 
-std::unique_ptr<Scheduler> Scheduler::CreateInstance(Config& config) {
+std::unique_ptr<Scheduler> Scheduler::CreateInstance(Config& config, uint16_t num_worker_threads) {
     std::string& scheduler = config.general_.scheduler;
     if(scheduler == "fifo"){
-        return std::make_unique<FifoScheduler>(config);
+        return std::make_unique<FifoScheduler>(config, num_worker_threads);
+    } else if(scheduler == "priority"){
+        return std::make_unique<PriorityScheduler>(config, num_worker_threads);
+    } else if(scheduler == "chunked"){
+        return std::make_unique<ChunkedScheduler>(config, num_worker_threads);
+    } else if(scheduler == "fusion"){
+        return std::make_unique<FusionScheduler>(config, num_worker_threads);
+    } else if(scheduler == "work_stealing"){
+        return std::make_unique<WorkStealingScheduler>(config, num_worker_threads);
+    } else if(scheduler == "deadline"){
+        return std::make_unique<DeadlineScheduler>(config, num_worker_threads);
     } else {
         LOG(FATAL) << "'" << scheduler << "' is not a valid scheduler";
     }
 }
 
-Scheduler::Scheduler(Config& config) : 
+Scheduler::Scheduler(Config& config, uint16_t num_worker_threads) : 
     stopped_(false),
-    config_(config) 
+    config_(config),
+    num_worker_threads_(num_worker_threads),
+    num_small_jobs_(0)
 {
     // Do nothing
 };
 
+Numel Scheduler::SliceTensor(const Tensor& tensor, WorkerTid worker_thread_id, Tensor& slice) {
+    const Numel num_worker_threads = this->num_worker_threads_;
+    const Numel unit = this->SlicingUnit(tensor.data_type);
+    slice = tensor;
+
+    // How many units should this thread work on? The last unit of the tensor can be partial.
+    const Numel num_units = (tensor.numel + unit - 1) / unit;
+    Numel num_thread_units = num_units / num_worker_threads;
+    const Numel remainder = num_units % num_worker_threads;
+    // What about the remainder units? Divide those across the first threads.
+    // All previous worker threads got an extra unit if this one did, otherwise the remainder units have been added across them.
+    const Numel first_unit = worker_thread_id * num_thread_units + std::min<Numel>(worker_thread_id, remainder);
+    if ((Numel) worker_thread_id < remainder) {
+        num_thread_units++;
+    }
+
+    Numel offset = std::min(first_unit * unit, tensor.numel);
+    slice.numel = std::min((first_unit + num_thread_units) * unit, tensor.numel) - offset;
+    slice.OffsetPtrs(offset);
+    return offset;
+}
+
+Numel Scheduler::SlicingUnit(DataType data_type) {
+    Numel transmission_unit = this->config_.general_.packet_numel;
+#ifdef RDMA
+    if(this->config_.general_.backend == "rdma") {
+        transmission_unit = this->config_.backend_.rdma.msg_numel;
+    }
+#endif
+    const Numel cache_line_numel = std::max<Numel>(1, SWITCHML_CACHE_LINE_SIZE / DataTypeSize(data_type));
+    return std::lcm(transmission_unit, cache_line_numel);
+}
+
+bool Scheduler::IsSmallJob(const Job& job) {
+    return job.tensor_.numel <= this->config_.general_.small_job_numel;
+}
+
+WorkerTid Scheduler::NextSmallJobWorkerThread() {
+    return this->num_small_jobs_.fetch_add(1, std::memory_order_relaxed) % this->num_worker_threads_;
+}
+
+bool Scheduler::EnqueueJobs(const std::vector<std::shared_ptr<Job>>& jobs) {
+    bool all_enqueued = true;
+    for(const std::shared_ptr<Job>& job : jobs) {
+        all_enqueued &= this->EnqueueJob(job);
+    }
+    return all_enqueued;
+}
+
+uint64_t Scheduler::FinishJob(std::shared_ptr<Job> job, const std::function<void(Job&)>& job_finished) {
+    job->SetJobStatus(JobStatus::FINISHED);
+    job_finished(*job);
+    return 1;
+}
+
+void Scheduler::Flush() {
+    // Nothing is held back by default.
+}
+
 void Scheduler::Stop() {
     std::unique_lock<std::mutex> lock(this->access_mutex_);
     VLOG(1) << "Waking up waiting threads";
@@ -25,6 +25,10 @@
 
 #include <mutex>
 #include <memory>
+#include <vector>
+#include <atomic>
+#include <condition_variable>
+#include <functional>
 
 #include "common.h"
 #include "job.h"
@@ -39,10 +43,21 @@ namespace switchml {
  * or distribution mechanism to serve its purpose.
  * 
  * The scheduler should only be accessed through the context api.
- * Any scheduler implementation must be thread safe in the sense that it locks the scheduler
- * access lock before any function and releases it before exiting.
+ * Any scheduler implementation must be thread safe. The simplest way to achieve that is to lock the scheduler
+ * access lock before any function and release it before exiting.
  * 
  * If more fine grained locking is needed then the implementation can create its own locks.
+ * In that case, Stop() must still wake up every thread that is blocked inside the scheduler.
+ *
+ * The context creates one scheduler for each of its streams and each scheduler only serves the worker threads of its stream.
+ * The worker thread ids that a scheduler sees (And the owner_tid of the job slices it returns) are local to the stream
+ * and range from 0 to num_worker_threads_ - 1. The context translates them to and from the backend's worker thread ids.
+ *
+ * The switch aggregates packets by slot so worker thread i of every worker must work on the same job slices in the same order.
+ * The application guarantees that all workers make the same sequence of EnqueueJob() and EnqueueJobs() calls on each stream.
+ * In return, the job slices that a scheduler gives to each worker thread must only depend on that sequence
+ * and never on timing (Ex. which jobs happen to be queued when a worker thread asks for its next job slice or a local clock).
+ * So schedulers only reorder the jobs of a single EnqueueJobs() call (See BatchScheduler).
  */
 class Scheduler {
   public:
@@ -50,11 +65,12 @@ class Scheduler {
      * @brief Creates a Scheduler object based on the scheduler name in the config
      * 
      * @param config a reference to the context configuration.
+     * @param num_worker_threads The number of worker threads of the stream that the scheduler serves.
      * @return std::unique_ptr<Scheduler> an exclusive pointer to the created scheduler object.
      */
-    static std::unique_ptr<Scheduler> CreateInstance(Config& config);
+    static std::unique_ptr<Scheduler> CreateInstance(Config& config, uint16_t num_worker_threads);
 
-    ~Scheduler() = default;
+    virtual ~Scheduler() = default;
 
     Scheduler(Scheduler const&) = delete;
     void operator=(Scheduler const&) = delete;
@@ -73,21 +89,43 @@ class Scheduler {
      */
     virtual bool EnqueueJob(std::shared_ptr<Job> job) = 0;
 
+    /**
+     * @brief Add a group of jobs to the Scheduler's queue as a unit.
+     * 
+     * This function is called by the context after a user submits a group or a batch of communication jobs.
+     * The jobs of a single call form a batch which is the only set of jobs that schedulers are allowed to reorder.
+     * Schedulers that do not reorder jobs must dispatch them in the same order as if they were enqueued one by one.
+     * By default this just calls EnqueueJob() for each job. Implementations can override it to
+     * take their locks and wake up worker threads once for the whole group.
+     * 
+     * @param [in] jobs the jobs that we will enqueue in order.
+     * @return true if we could add all of the jobs successfully.
+     * @return false otherwise.
+     */
+    virtual bool EnqueueJobs(const std::vector<std::shared_ptr<Job>>& jobs);
+
     /**
      * @brief Get a job request slice.
      * 
      * This is called through the context by worker threads to get a job slice.
      * How the Job is sliced and distributed depends on the scheduler implementation.
-     * the function will block the calling thread on the job_submitted_event_ until a job slice is retrieved
+     * If block is true, the function will block the calling thread on the job_submitted_event_ until a job slice is retrieved
      * OR the Stop is called. This is why it is important to check for the return value to make
      * sure that a job slice has been received.
      * 
+     * Worker threads call this function with block set to false while they are still finishing their current job slice
+     * so that they can overlap the start of the next job slice with its tail. A worker thread can thus have more
+     * than one job slice in flight but it always notifies their completion in the order in which it got them.
+     * A job slice given to a non blocking call must use the same switch slots (owner_tid) as the slice it overlaps with.
+     * An implementation can always return false for non blocking calls.
+     * 
      * @param [in] worker_thread_id  The id of the worker thread that wants a job slice.
      * @param [out] job_slice  A reference to a job slice variable. 
+     * @param [in] block Whether to wait for a job slice if none is available right away.
      * @return true if the scheduler returned a valid job slice.
-     * @return false the caller was forced to wakeup and the scheduler did not return a valid job slice.
+     * @return false the caller was forced to wakeup (or did not want to wait) and the scheduler did not return a valid job slice.
      */
-    virtual bool GetJobSlice(WorkerTid worker_thread_id, JobSlice& job_slice) = 0;
+    virtual bool GetJobSlice(WorkerTid worker_thread_id, JobSlice& job_slice, bool block) = 0;
 
     /**
      * @brief Signal the scheduler that a job slice has been finished.
@@ -102,6 +140,26 @@ class Scheduler {
      */
     virtual bool NotifyJobSliceCompletion(WorkerTid worker_thread_id, const JobSlice& job_slice) = 0;
 
+    /**
+     * @brief Mark a job as finished after NotifyJobSliceCompletion() reported that it was fully completed.
+     * 
+     * By default this just sets the job's status to FINISHED.
+     * Schedulers that merge several submitted jobs into a single job override it to finish the submitted jobs instead.
+     * 
+     * @param [in] job The job that has been fully completed.
+     * @param [in] job_finished Called for each submitted job right after its status was set (It can be FAILED if the job was cancelled).
+     * @return uint64_t The number of submitted jobs that finished.
+     */
+    virtual uint64_t FinishJob(std::shared_ptr<Job> job, const std::function<void(Job&)>& job_finished);
+
+    /**
+     * @brief Dispatch any job that the scheduler is holding back until more jobs are submitted.
+     * 
+     * By default this does nothing. Schedulers that merge several submitted jobs into a single job
+     * override it to dispatch the jobs they merged so far.
+     */
+    virtual void Flush();
+
     /**
      * @brief Set the stopped_ flag to true and notify threads waiting on the job submitted event.
      * 
@@ -116,11 +174,66 @@ class Scheduler {
      * @brief Construct a new Scheduler object
      * 
      * @param [in] config A reference to the context configuration
+     * @param [in] num_worker_threads The number of worker threads of the stream that this scheduler serves.
      */
-    Scheduler(Config& config);
+    Scheduler(Config& config, uint16_t num_worker_threads);
+
+    /**
+     * @brief Compute the part of a tensor that a worker thread is statically mapped to.
+     * 
+     * The tensor is divided into almost-equally-sized slices, one for each worker thread of the stream.
+     * Worker thread i always gets slice i. Schedulers that use a static mapping between slices and
+     * worker threads must all use this function so that all workers send the same elements to the same switch slots.
+     * 
+     * Slice boundaries are multiples of SlicingUnit() from the start of the tensor so only the worker thread
+     * whose slice holds the end of the tensor sends a partial packet (or message). When the tensor's buffers are
+     * cache line aligned, adjacent worker threads also never write to the same cache line.
+     * The boundaries cannot depend on the buffers' addresses because all workers must slice tensors the same way.
+     * Worker threads past the end of small tensors get empty slices.
+     * 
+     * @param [in] tensor The tensor to slice.
+     * @param [in] worker_thread_id The id of the worker thread that the slice is for.
+     * @param [out] slice The slice of the tensor that the worker thread should work on.
+     * @return Numel The offset in elements of the slice from the start of the tensor.
+     */
+    Numel SliceTensor(const Tensor& tensor, WorkerTid worker_thread_id, Tensor& slice);
+
+    /**
+     * @brief Get the number of elements that slice boundaries must be a multiple of.
+     * 
+     * This is the smallest number of elements that fills whole packets (Or messages for the rdma backend)
+     * and whole cache lines.
+     * 
+     * @param [in] data_type The data type of the tensor to slice.
+     * @return Numel The slicing unit in elements.
+     */
+    Numel SlicingUnit(DataType data_type);
+
+    /**
+     * @brief Check whether a job is small enough to skip slicing.
+     * 
+     * Small jobs (At most general.small_job_numel elements) only fill one or a few packets. Slicing them would
+     * wake up every worker thread to mostly work on empty slices so they are given whole to a single worker thread instead.
+     * 
+     * @param [in] job The job to check.
+     * @return true if the job should be given whole to a single worker thread.
+     * @return false if the job should be sliced across all worker threads.
+     */
+    bool IsSmallJob(const Job& job);
+
+    /**
+     * @brief Choose the worker thread that will work on the next small job.
+     * 
+     * Small jobs are spread across worker threads in round robin order.
+     * All workers submit the same sequence of jobs so they all choose the same worker thread
+     * (and thus the same switch slots) for the same job.
+     * 
+     * @return WorkerTid The id of the chosen worker thread.
+     */
+    WorkerTid NextSmallJobWorkerThread();
 
     /** A flag that signifies that the scheduler has been stopped_ */
-    volatile bool stopped_;
+    std::atomic<bool> stopped_;
 
     /** A mutex that is used to wrap all functions of the scheduler to make them thread safe. */
     std::mutex access_mutex_;
@@ -130,6 +243,12 @@ class Scheduler {
 
     /** A reference to the context configuration */
     Config& config_;
+
+    /** The number of worker threads of the stream that this scheduler serves. Jobs are sliced across these worker threads only. */
+    uint16_t num_worker_threads_;
+
+    /** The number of small jobs that have been enqueued so far. */
+    std::atomic<uint64_t> num_small_jobs_;
 };
 
 } // namespace switchml
@@ -0,0 +1,195 @@
+/*
+  Copyright 2021 Intel-KAUST-Microsoft
+
+  Licensed under the Apache License, Version 2.0 (the "License");
+  you may not use this file except in compliance with the License.
+  You may obtain a copy of the License at
+
+     http://www.apache.org/licenses/LICENSE-2.0
+
+  Unless required by applicable law or agreed to in writing, software
+  distributed under the License is distributed on an "AS IS" BASIS,
+  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+  See the License for the specific language governing permissions and
+  limitations under the License.
+*/
+
+/**
+ * SwitchML Project
+ * @file batch_scheduler.cc
+ * @brief Implements the BatchScheduler class.
+ */
+
+#include "common_cc.h"
+#include "batch_scheduler.h"
+#include "config.h"
+#include "utils.h"
+
+namespace switchml {
+
+BatchScheduler::BatchScheduler(Config& config, uint16_t num_worker_threads, Numel chunk_numel)
+    : Scheduler(config, num_worker_threads)
+    , chunk_numel_(chunk_numel)
+    , queues_(num_worker_threads)
+{
+    // nothing to do here
+}
+
+bool BatchScheduler::EnqueueJob(std::shared_ptr<Job> job) {
+    return this->EnqueueBatch(&job, 1);
+}
+
+bool BatchScheduler::EnqueueJobs(const std::vector<std::shared_ptr<Job>>& jobs) {
+    return this->EnqueueBatch(jobs.data(), jobs.size());
+}
+
+bool BatchScheduler::EnqueueBatch(const std::shared_ptr<Job>* jobs, size_t num_jobs) {
+    if(this->stopped_) {
+        for(size_t i = 0; i < num_jobs; i++) {
+            jobs[i]->SetJobStatus(JobStatus::FAILED);
+        }
+        return false;
+    }
+    if(num_jobs == 0) {
+        return true;
+    }
+    // Lock all queues once for the whole batch. Worker threads only ever hold their own queue's lock
+    // so taking them in order cannot deadlock with other submitting threads.
+    for(WorkerThreadQueue& wtq : this->queues_) {
+        wtq.access_mutex.lock();
+        wtq.batches.emplace_back();
+    }
+    for(size_t i = 0; i < num_jobs; i++) {
+        const std::shared_ptr<Job>& job = jobs[i];
+        job->SetJobStatus(JobStatus::QUEUED);
+        std::shared_ptr<JobState> job_state = std::allocate_shared<JobState>(PoolAllocator<JobState>());
+        job_state->job = job;
+        if(this->IsSmallJob(*job)) {
+            // Small jobs are not sliced. A single worker thread works on the whole job.
+            job_state->unfinished_worker_threads = 1;
+            this->queues_[this->NextSmallJobWorkerThread()].batches.back().push_back({job_state, 0, (uint32_t) i});
+        } else {
+            job_state->unfinished_worker_threads = this->num_worker_threads_;
+            for(WorkerThreadQueue& wtq : this->queues_) {
+                wtq.batches.back().push_back({job_state, 0, (uint32_t) i});
+            }
+        }
+        DVLOG(2) << "Queued job id: " << job->id_ << " job_type: " << job->job_type_ << " priority: " << job->priority_
+            << " numel: " << job->tensor_.numel << " data_type: " << job->tensor_.data_type << " at position " << i << " of its batch.";
+    }
+    for(WorkerThreadQueue& wtq : this->queues_) {
+        // Worker threads that did not get any of the batch's small jobs skip it.
+        const bool got_jobs = !wtq.batches.back().empty();
+        if(!got_jobs) {
+            wtq.batches.pop_back();
+        }
+        wtq.access_mutex.unlock();
+        if(got_jobs) {
+            wtq.job_submitted_event.notify_one();
+        }
+    }
+    return true;
+}
+
+bool BatchScheduler::GetJobSlice(WorkerTid worker_thread_id, JobSlice& job_slice, bool block) {
+    DVLOG(2) << "Worker thread '" << worker_thread_id << "' is asking for a job slice.";
+    WorkerThreadQueue& wtq = this->queues_[worker_thread_id];
+    std::unique_lock<std::mutex> lock(wtq.access_mutex);
+
+    // Block until we have a job. If the queue already has jobs then the thread will continue immediately.
+    if(block) {
+        DVLOG_IF(2, !this->stopped_ && wtq.batches.empty()) << "Worker thread '" << worker_thread_id << "' waiting for a job.";
+        wtq.job_submitted_event.wait(lock, [this, &wtq] {
+             return this->stopped_ || !wtq.batches.empty();
+        });
+    }
+
+    // If we were forced to stop or there is nothing to do then return false.
+    if(this->stopped_ || wtq.batches.empty()) {
+        return false;
+    }
+
+    // Only the jobs of the current batch are considered.
+    std::deque<JobProgress>& batch = wtq.batches.front();
+    auto it = batch.begin() + this->SelectJob(batch);
+    JobProgress progress = std::move(*it);
+    batch.erase(it);
+
+    // Cut the next chunk out of the job's tensor.
+    std::shared_ptr<Job> job = progress.job_state->job;
+    Tensor chunk = job->tensor_;
+    chunk.OffsetPtrs(progress.next_chunk_offset);
+    chunk.numel = std::min(this->chunk_numel_, job->tensor_.numel - progress.next_chunk_offset);
+    progress.next_chunk_offset += chunk.numel;
+    const Numel chunk_offset = progress.next_chunk_offset - chunk.numel;
+    const bool last_chunk = progress.next_chunk_offset >= job->tensor_.numel;
+
+    // The job goes back to the batch right away so that its next chunk can overlap with this one.
+    wtq.running.push_back({progress.job_state, last_chunk});
+    if(!last_chunk) {
+        batch.push_back(std::move(progress));
+    }
+    if(batch.empty()) {
+        wtq.batches.pop_front();
+    }
+    lock.unlock();
+
+    // ## Construct job slice ##
+    // Take this worker thread's slice of the chunk (Or the whole chunk for small jobs).
+    job_slice.job = job;
+    job_slice.owner_tid = worker_thread_id;
+    Numel offset = 0;
+    if(this->IsSmallJob(*job)) {
+        job_slice.slice = chunk;
+    } else {
+        offset = this->SliceTensor(chunk, worker_thread_id, job_slice.slice);
+    }
+
+    // Set job status to running. Only the first worker thread to reach the job needs to do it.
+    if(job->GetJobStatus() == JobStatus::QUEUED) {
+        job->SetJobStatus(JobStatus::RUNNING);
+    }
+
+    DVLOG(2) << "A job slice from job id: " << job_slice.job->id_ << " with offset: " << chunk_offset + offset
+        << " numel: " << job_slice.slice.numel << " was given to worker thread '" << worker_thread_id << "'.";
+    return true;
+}
+
+bool BatchScheduler::NotifyJobSliceCompletion(WorkerTid worker_thread_id, const JobSlice& job_slice){
+    if(this->stopped_) {
+        job_slice.job->SetJobStatus(JobStatus::FAILED);
+        return false;
+    }
+    WorkerThreadQueue& wtq = this->queues_[worker_thread_id];
+    // Only the owning worker thread touches its running chunks so no locking is needed here.
+    // Worker threads notify the completion of their job slices in the order in which they got them.
+    RunningChunk running_chunk = std::move(wtq.running.front());
+    wtq.running.pop_front();
+    DCHECK(running_chunk.job_state->job == job_slice.job) << "Worker thread '" << worker_thread_id << "' notified the completion of a job slice it was not given.";
+    DVLOG(2) << "Worker thread '" << worker_thread_id << "' has finished its job slice for job id: " << job_slice.job->id_ << ".";
+
+    if(!running_chunk.last_chunk) {
+        return false;
+    }
+    // The thread that brings the counter to 0 is the one that finished the job.
+    return running_chunk.job_state->unfinished_worker_threads.fetch_sub(1, std::memory_order_acq_rel) == 1;
+}
+
+void BatchScheduler::Stop() {
+    Scheduler::Stop();
+    // Set all the current jobs that haven't finished to failed.
+    // This will also wakeup any thread waiting on a job.
+    for(WorkerThreadQueue& wtq : this->queues_) {
+        std::unique_lock<std::mutex> lock(wtq.access_mutex);
+        for(std::deque<JobProgress>& batch : wtq.batches) {
+            for(JobProgress& progress : batch) {
+                progress.job_state->job->SetJobStatus(JobStatus::FAILED);
+            }
+        }
+        wtq.batches.clear();
+        lock.unlock();
+        wtq.job_submitted_event.notify_all();
+    }
+}
+
+} // namespace switchml
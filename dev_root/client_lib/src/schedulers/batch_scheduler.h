@@ -0,0 +1,205 @@
+/*
+  Copyright 2021 Intel-KAUST-Microsoft
+
+  Licensed under the Apache License, Version 2.0 (the "License");
+  you may not use this file except in compliance with the License.
+  You may obtain a copy of the License at
+
+     http://www.apache.org/licenses/LICENSE-2.0
+
+  Unless required by applicable law or agreed to in writing, software
+  distributed under the License is distributed on an "AS IS" BASIS,
+  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+  See the License for the specific language governing permissions and
+  limitations under the License.
+*/
+
+/**
+ * SwitchML Project
+ * @file batch_scheduler.h
+ * @brief Declares the BatchScheduler class.
+ */
+
+#ifndef SWITCHML_BATCH_SCHEDULER_H_
+#define SWITCHML_BATCH_SCHEDULER_H_
+
+#include <deque>
+#include <vector>
+#include <atomic>
+#include <mutex>
+#include <condition_variable>
+
+#include "common.h"
+#include "job.h"
+#include "scheduler.h"
+
+namespace switchml {
+
+/**
+ * @brief A base class for schedulers that reorder the jobs of a batch.
+ *
+ * Each call to EnqueueJobs() forms a batch (And each call to EnqueueJob() forms a batch of a single job).
+ * Batches are dispatched in the order in which they were enqueued and a worker thread only moves on to the next
+ * batch once it took its slices of all of the jobs of the current batch. Within a batch, subclasses choose
+ * which job to dispatch next through SelectJob(). See Scheduler for why jobs are never reordered across batches.
+ *
+ * Jobs can be divided into chunks that are dispatched separately (Ex. to interleave the chunks of several jobs).
+ * Each chunk is then sliced across worker threads using the same static mapping as the FifoScheduler.
+ * A job is finished once all worker threads finished their slices of all of its chunks.
+ * Each worker thread owns its own queue so worker threads never contend with each other.
+ */
+class BatchScheduler : public switchml::Scheduler {
+  public:
+    ~BatchScheduler() = default;
+
+    BatchScheduler(BatchScheduler const&) = delete;
+    void operator=(BatchScheduler const&) = delete;
+
+    BatchScheduler(BatchScheduler&&) = default;
+    BatchScheduler& operator=(BatchScheduler&&) = default;
+
+    /**
+     * @brief Add a batch of a single job to the queue of every worker thread.
+     *
+     * Small jobs are only added to the queue of a single worker thread which works on their whole chunks.
+     *
+     * @param [in] job a shared pointer for the job that we will enqueue
+     * @return true if we could add the request successfully.
+     * @return false otherwise.
+     */
+    bool EnqueueJob(std::shared_ptr<Job> job) override;
+
+    /**
+     * @brief Add a batch of jobs to the queues of the worker threads.
+     *
+     * All queues are locked once for the whole batch and each worker thread is woken up once.
+     *
+     * @param [in] jobs the jobs of the batch in submission order.
+     * @return true if we could add the jobs successfully.
+     * @return false otherwise.
+     */
+    bool EnqueueJobs(const std::vector<std::shared_ptr<Job>>& jobs) override;
+
+    /**
+     * @brief Get this worker thread's slice of the next chunk of the job chosen by SelectJob() in the current batch.
+     *
+     * If block is true, the function blocks the calling thread until its own queue has a job.
+     *
+     * @param [in] worker_thread_id  The id of the worker thread that wants a job slice.
+     * @param [out] job_slice  A reference to a job slice variable.
+     * @param [in] block Whether to wait for a job slice if none is available right away.
+     * @return true if the scheduler returned a valid job slice.
+     * @return false the caller was forced to wakeup and the scheduler did not return a valid job slice.
+     */
+    bool GetJobSlice(WorkerTid worker_thread_id, JobSlice& job_slice, bool block) override;
+
+    /**
+     * @brief Signal the scheduler that a job slice has been finished.
+     *
+     * @param [in] worker_thread_id The id of the worker thread that finished the job slice.
+     * @param [in] job_slice The job slice that finished.
+     * @return true If the job corresponding to this job slice has finished all its job slices.
+     * @return false If there is still some job slices to be completed either by this or other worker threads.
+     * or if the scheduler has already stopped.
+     */
+    bool NotifyJobSliceCompletion(WorkerTid worker_thread_id, const JobSlice& job_slice) override;
+
+    /**
+     * @brief calls Scheduler::Stop(), wakes up all threads waiting, and clears all queues.
+     *
+     * All jobs that are still queued are set to failed.
+     */
+    void Stop() override;
+
+  protected:
+    /**
+     * @brief Initialize all the members
+     *
+     * @param [in] config the switchml configuration.
+     * @param [in] num_worker_threads The number of worker threads of the stream that this scheduler serves.
+     * @param [in] chunk_numel The number of elements in a chunk. Jobs are dispatched whole if it is larger than any job.
+     */
+    BatchScheduler(Config& config, uint16_t num_worker_threads, Numel chunk_numel);
+
+    /**
+     * @brief The state of a job that is shared between all worker threads.
+     */
+    struct JobState {
+        /** The job itself */
+        std::shared_ptr<Job> job;
+        /**
+         * The number of worker threads that have not finished all of their chunks yet.
+         * Once it reaches 0 the job is finished.
+         */
+        std::atomic<int> unfinished_worker_threads;
+    };
+
+    /**
+     * @brief The progress of a single worker thread through the chunks of a job.
+     */
+    struct JobProgress {
+        /** The shared state of the job */
+        std::shared_ptr<JobState> job_state;
+        /** The offset of the next chunk to dispatch within the job's tensor */
+        Numel next_chunk_offset;
+        /** The position of the job within its batch which is the same on all workers. */
+        uint32_t position;
+    };
+
+    /**
+     * @brief Choose the job of the current batch whose next chunk should be dispatched.
+     *
+     * Once a chunk is taken, the job is moved to the back of the batch if it still has chunks left.
+     * The choice must only depend on the jobs of the batch (Not on the time or on other batches)
+     * so that all workers make the same choices.
+     *
+     * @param [in] batch The jobs of the current batch that still have chunks left for the calling worker thread.
+     * It is never empty.
+     * @return size_t The index of the chosen job within the batch.
+     */
+    virtual size_t SelectJob(const std::deque<JobProgress>& batch) = 0;
+
+  private:
+    /**
+     * @brief A chunk that a worker thread is currently working on.
+     */
+    struct RunningChunk {
+        /** The shared state of the job */
+        std::shared_ptr<JobState> job_state;
+        /** Whether this is the last chunk of the job */
+        bool last_chunk;
+    };
+
+    /**
+     * @brief A queue of batches owned by a single worker thread.
+     */
+    struct alignas(64) WorkerThreadQueue {
+        /** Protects the queue. Only the owning worker thread and submitting threads use it. */
+        std::mutex access_mutex;
+        /** Signals the owning worker thread that a batch was added to the queue. */
+        std::condition_variable job_submitted_event;
+        /** The batches that still have chunks left for the owning worker thread in the order in which they were enqueued. */
+        std::deque<std::deque<JobProgress>> batches;
+        /** The chunks that the owning worker thread is currently working on in the order it got them. Only accessed by the owning worker thread. */
+        std::deque<RunningChunk> running;
+    };
+
+    /**
+     * @brief Add a batch of jobs to the queues of the worker threads.
+     *
+     * @param [in] jobs A pointer to the first job of the batch.
+     * @param [in] num_jobs The number of jobs in the batch.
+     * @return true if we could add the jobs successfully.
+     * @return false otherwise.
+     */
+    bool EnqueueBatch(const std::shared_ptr<Job>* jobs, size_t num_jobs);
+
+    /** The number of elements in a chunk. */
+    Numel chunk_numel_;
+
+    /** One queue per worker thread indexed by the worker thread id. */
+    std::vector<WorkerThreadQueue> queues_;
+};
+
+} // namespace switchml
+#endif // SWITCHML_BATCH_SCHEDULER_H_
@@ -0,0 +1,40 @@
+/*
+  Copyright 2021 Intel-KAUST-Microsoft
+
+  Licensed under the Apache License, Version 2.0 (the "License");
+  you may not use this file except in compliance with the License.
+  You may obtain a copy of the License at
+
+     http://www.apache.org/licenses/LICENSE-2.0
+
+  Unless required by applicable law or agreed to in writing, software
+  distributed under the License is distributed on an "AS IS" BASIS,
+  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+  See the License for the specific language governing permissions and
+  limitations under the License.
+*/
+
+/**
+ * SwitchML Project
+ * @file chunked_scheduler.cc
+ * @brief Implements the ChunkedScheduler class.
+ */
+
+#include "common_cc.h"
+#include "chunked_scheduler.h"
+#include "config.h"
+#include "utils.h"
+
+namespace switchml {
+
+ChunkedScheduler::ChunkedScheduler(Config& config, uint16_t num_worker_threads)
+    : BatchScheduler(config, num_worker_threads, config.general_.chunk_numel)
+{
+    // nothing to do here
+}
+
+size_t ChunkedScheduler::SelectJob(__attribute__((unused)) const std::deque<JobProgress>& batch) {
+    return 0;
+}
+
+} // namespace switchml
@@ -0,0 +1,79 @@
+/*
+  Copyright 2021 Intel-KAUST-Microsoft
+
+  Licensed under the Apache License, Version 2.0 (the "License");
+  you may not use this file except in compliance with the License.
+  You may obtain a copy of the License at
+
+     http://www.apache.org/licenses/LICENSE-2.0
+
+  Unless required by applicable law or agreed to in writing, software
+  distributed under the License is distributed on an "AS IS" BASIS,
+  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+  See the License for the specific language governing permissions and
+  limitations under the License.
+*/
+
+/**
+ * SwitchML Project
+ * @file chunked_scheduler.h
+ * @brief Declares the ChunkedScheduler class.
+ */
+
+#ifndef SWITCHML_CHUNKED_SCHEDULER_H_
+#define SWITCHML_CHUNKED_SCHEDULER_H_
+
+#include <deque>
+
+#include "common.h"
+#include "job.h"
+#include "batch_scheduler.h"
+
+namespace switchml {
+
+/**
+ * @brief A subclass of BatchScheduler that splits jobs into chunks and interleaves the chunks of the jobs of a batch.
+ * 
+ * Each job is divided into chunks of general.chunk_numel elements (the last chunk can be smaller).
+ * Each chunk is then sliced across worker threads using the same static mapping as the FifoScheduler.
+ * 
+ * Each worker thread dispatches the chunks of the jobs of the current batch in round robin order.
+ * Once a worker thread takes its slice of a chunk, the job is moved to the back of the batch so that
+ * the next job of the batch gets a turn. This way a small job that is submitted in the same batch as a huge one
+ * (Ex. with Context::BeginBatch()) only waits for a single chunk instead of the whole huge job.
+ * Jobs of different batches are never interleaved so the chunks of a job that is submitted on its own are dispatched back to back.
+ * 
+ * A job is finished once all worker threads finished their slices of all of its chunks.
+ */
+class ChunkedScheduler : public switchml::BatchScheduler {
+  public:
+    /**
+     * @brief Initialize all the members
+     * 
+     * @param [in] config the switchml configuration.
+     * @param [in] num_worker_threads The number of worker threads of the stream that this scheduler serves.
+     */
+    ChunkedScheduler(Config& config, uint16_t num_worker_threads);
+
+    ~ChunkedScheduler() = default;
+
+    ChunkedScheduler(ChunkedScheduler const&) = delete;
+    void operator=(ChunkedScheduler const&) = delete;
+
+    ChunkedScheduler(ChunkedScheduler&&) = default;
+    ChunkedScheduler& operator=(ChunkedScheduler&&) = default;
+
+  protected:
+    /**
+     * @brief Choose the job at the front of the batch.
+     * 
+     * Jobs that still have chunks left go to the back of the batch so this dispatches the jobs' chunks in round robin order.
+     * 
+     * @param [in] batch The jobs of the current batch.
+     * @return size_t Always 0.
+     */
+    size_t SelectJob(const std::deque<JobProgress>& batch) override;
+};
+
+} // namespace switchml
+#endif // SWITCHML_CHUNKED_SCHEDULER_H_
@@ -0,0 +1,79 @@
+/*
+  Copyright 2021 Intel-KAUST-Microsoft
+
+  Licensed under the Apache License, Version 2.0 (the "License");
+  you may not use this file except in compliance with the License.
+  You may obtain a copy of the License at
+
+     http://www.apache.org/licenses/LICENSE-2.0
+
+  Unless required by applicable law or agreed to in writing, software
+  distributed under the License is distributed on an "AS IS" BASIS,
+  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+  See the License for the specific language governing permissions and
+  limitations under the License.
+*/
+
+/**
+ * SwitchML Project
+ * @file deadline_scheduler.h
+ * @brief Declares the DeadlineScheduler class.
+ */
+
+#ifndef SWITCHML_DEADLINE_SCHEDULER_H_
+#define SWITCHML_DEADLINE_SCHEDULER_H_
+
+#include <deque>
+
+#include "common.h"
+#include "job.h"
+#include "batch_scheduler.h"
+
+namespace switchml {
+
+/**
+ * @brief A subclass of BatchScheduler that dispatches the chunks of the jobs of a batch earliest deadline first.
+ * 
+ * Like the ChunkedScheduler, each job is divided into chunks of general.chunk_numel elements and each chunk
+ * is sliced across worker threads using the same static mapping as the FifoScheduler.
+ * But instead of taking turns, each worker thread always dispatches the next chunk of the job of the current batch
+ * with the shortest deadline (Job::deadline_). Jobs without a deadline come after all jobs with one
+ * and jobs with equal deadlines are dispatched in the order in which they were submitted.
+ * So a job with a tight deadline that is submitted in the same batch as a huge job only waits for a single chunk.
+ * 
+ * Deadlines are relative to the submission of each job rather than points in time since the clocks of the workers differ.
+ * The jobs of a batch are ordered by their deadlines as if they were all submitted at the same time.
+ * Jobs of different batches are never reordered so a job with a tight deadline waits for all batches that were submitted before it.
+ * 
+ * The context records how many jobs finished after their deadline in its Stats.
+ */
+class DeadlineScheduler : public switchml::BatchScheduler {
+  public:
+    /**
+     * @brief Initialize all the members
+     * 
+     * @param [in] config the switchml configuration.
+     * @param [in] num_worker_threads The number of worker threads of the stream that this scheduler serves.
+     */
+    DeadlineScheduler(Config& config, uint16_t num_worker_threads);
+
+    ~DeadlineScheduler() = default;
+
+    DeadlineScheduler(DeadlineScheduler const&) = delete;
+    void operator=(DeadlineScheduler const&) = delete;
+
+    DeadlineScheduler(DeadlineScheduler&&) = default;
+    DeadlineScheduler& operator=(DeadlineScheduler&&) = default;
+
+  protected:
+    /**
+     * @brief Choose the job of the batch with the shortest deadline.
+     * 
+     * @param [in] batch The jobs of the current batch.
+     * @return size_t The index of the job with the shortest deadline. Ties go to the job that was submitted first.
+     */
+    size_t SelectJob(const std::deque<JobProgress>& batch) override;
+};
+
+} // namespace switchml
+#endif // SWITCHML_DEADLINE_SCHEDULER_H_
@@ -20,6 +20,8 @@
  * @brief Implements the FifoScheduler class.
  */
 
+#include <thread>
+
 #include "common_cc.h"
 #include "fifo_scheduler.h"
 #include "config.h"
@@ -27,88 +29,164 @@
 
 namespace switchml {
 
-FifoScheduler::FifoScheduler(Config& config)
-    : Scheduler(config)
-    , queue_()
-    , finished_job_slices_()
-    , undispatched_job_slices_()
-    , barrier_(config.general_.num_worker_threads)
+FifoScheduler::FifoScheduler(Config& config, uint16_t num_worker_threads)
+    : Scheduler(config, num_worker_threads)
+    , queues_(num_worker_threads)
 {
     // nothing to do here
 }
 
+FifoScheduler::~FifoScheduler() {
+    std::shared_ptr<JobState> job_state;
+    for(WorkerThreadQueue& wtq : this->queues_) {
+        while(wtq.queue.TryPop(job_state)) {
+            job_state->job->SetJobStatus(JobStatus::FAILED);
+        }
+    }
+}
+
 bool FifoScheduler::EnqueueJob(std::shared_ptr<Job> job) {
-    std::unique_lock<std::mutex> lock(this->access_mutex_);
+    if(this->stopped_) {
+        job->SetJobStatus(JobStatus::FAILED);
+        return false;
+    }
     job->SetJobStatus(JobStatus::QUEUED);
-    this->finished_job_slices_.insert({job->id_, 0});
-    this->undispatched_job_slices_.insert({job->id_, this->config_.general_.num_worker_threads});
-    this->queue_.push(job);
+    std::shared_ptr<JobState> job_state = std::allocate_shared<JobState>(PoolAllocator<JobState>());
+    job_state->job = job;
+    if(this->IsSmallJob(*job)) {
+        // Small jobs are not sliced. A single worker thread works on the whole job.
+        job_state->unfinished_job_slices = 1;
+        WorkerThreadQueue& wtq = this->queues_[this->NextSmallJobWorkerThread()];
+        if(!this->Push(wtq, std::move(job_state))) {
+            return false;
+        }
+        this->WakeUp(wtq);
+    } else {
+        job_state->unfinished_job_slices = this->num_worker_threads_;
+        for(WorkerThreadQueue& wtq : this->queues_) {
+            if(!this->Push(wtq, job_state)) {
+                return false;
+            }
+            this->WakeUp(wtq);
+        }
+    }
     DVLOG(2) << "Queued job id: " << job->id_ << " job_type: "
         << job->job_type_ << " numel: " << job->tensor_.numel << " data_type: " << job->tensor_.data_type;
-    this->job_submitted_event_.notify_all();
     return true;
 }
 
-bool FifoScheduler::GetJobSlice(WorkerTid worker_thread_id, JobSlice& job_slice) {
-    DVLOG(2) << "Worker thread '" << worker_thread_id << "' is asking for a job slice.";
-    std::unique_lock<std::mutex> lock(this->access_mutex_);
-
+bool FifoScheduler::EnqueueJobs(const std::vector<std::shared_ptr<Job>>& jobs) {
     if(this->stopped_) {
+        for(const std::shared_ptr<Job>& job : jobs) {
+            job->SetJobStatus(JobStatus::FAILED);
+        }
+        return false;
+    }
+    bool pushed = true;
+    for(const std::shared_ptr<Job>& job : jobs) {
+        if(!pushed) {
+            // The scheduler was stopped while pushing a previous job.
+            job->SetJobStatus(JobStatus::FAILED);
+            continue;
+        }
+        job->SetJobStatus(JobStatus::QUEUED);
+        std::shared_ptr<JobState> job_state = std::allocate_shared<JobState>(PoolAllocator<JobState>());
+        job_state->job = job;
+        if(this->IsSmallJob(*job)) {
+            // Small jobs are not sliced. A single worker thread works on the whole job.
+            job_state->unfinished_job_slices = 1;
+            pushed = this->Push(this->queues_[this->NextSmallJobWorkerThread()], std::move(job_state));
+        } else {
+            job_state->unfinished_job_slices = this->num_worker_threads_;
+            for(WorkerThreadQueue& wtq : this->queues_) {
+                pushed = this->Push(wtq, job_state);
+                if(!pushed) {
+                    break;
+                }
+            }
+        }
+    }
+    if(!pushed) {
         return false;
     }
+    // Wake up worker threads once for the whole group.
+    for(WorkerThreadQueue& wtq : this->queues_) {
+        this->WakeUp(wtq);
+    }
+    DVLOG(2) << "Queued a group of " << jobs.size() << " jobs starting with job id: " << jobs.front()->id_ << ".";
+    return true;
+}
+
+bool FifoScheduler::Push(WorkerThreadQueue& wtq, std::shared_ptr<JobState> job_state) {
+    while(!wtq.queue.TryPush(job_state)) {
+        if(this->stopped_) {
+            job_state->job->SetJobStatus(JobStatus::FAILED);
+            return false;
+        }
+        // The worker thread must be awake to make room.
+        this->WakeUp(wtq);
+        std::this_thread::yield();
+    }
+    return true;
+}
 
-    const int num_worker_threads = this->config_.general_.num_worker_threads;
+void FifoScheduler::WakeUp(WorkerThreadQueue& wtq) {
+    // Pairs with the fence in GetJobSlice. Either the worker thread sees the job that we just pushed
+    // before it goes to sleep or we see that it is waiting.
+    std::atomic_thread_fence(std::memory_order_seq_cst);
+    if(wtq.waiting.load(std::memory_order_relaxed)) {
+        // Taking the lock makes sure that the worker thread is either already waiting or has not checked the queue yet.
+        { std::unique_lock<std::mutex> lock(wtq.access_mutex); }
+        wtq.job_submitted_event.notify_one();
+    }
+}
 
-    // Wait for other workers
-    lock.unlock();
-    this->barrier_.Wait();
-    lock.lock();
+bool FifoScheduler::GetJobSlice(WorkerTid worker_thread_id, JobSlice& job_slice, bool block) {
+    DVLOG(2) << "Worker thread '" << worker_thread_id << "' is asking for a job slice.";
+    WorkerThreadQueue& wtq = this->queues_[worker_thread_id];
+    std::shared_ptr<JobState> job_state;
 
     // Block until we have a job. If the queue already has jobs then the thread will continue immediately.
-    DVLOG_IF(2, !this->stopped_ && this->queue_.empty()) << "Worker thread '" << worker_thread_id << "' waiting for a job.";
-    this->job_submitted_event_.wait(lock, [this] {
-         return this->stopped_ || !this->queue_.empty();
-    });
+    while(!this->stopped_ && !wtq.queue.TryPop(job_state)) {
+        if(!block) {
+            return false;
+        }
+        std::unique_lock<std::mutex> lock(wtq.access_mutex);
+        wtq.waiting.store(true, std::memory_order_relaxed);
+        // Pairs with the fence in WakeUp().
+        std::atomic_thread_fence(std::memory_order_seq_cst);
+        DVLOG_IF(2, !this->stopped_ && wtq.queue.Empty()) << "Worker thread '" << worker_thread_id << "' waiting for a job.";
+        wtq.job_submitted_event.wait(lock, [this, &wtq] {
+             return this->stopped_ || !wtq.queue.Empty();
+        });
+        wtq.waiting.store(false, std::memory_order_relaxed);
+    }
 
     // If we were forced to stop then return false.
     if(this->stopped_) {
+        if(job_state) {
+            job_state->job->SetJobStatus(JobStatus::FAILED);
+        }
         return false;
     }
 
-    // ## Construct job slice ##
-    std::shared_ptr<Job> job = this->queue_.front();
-
-    int& job_slices_left = this->undispatched_job_slices_.at(job->id_);
-    job_slices_left--;
-    // If this is the last slice of the job then remove the job from the queue.
-    if (job_slices_left == 0) {
-        this->queue_.pop();
-        this->undispatched_job_slices_.erase(job->id_);
-    }
+    wtq.running.push_back(std::move(job_state));
 
+    // ## Construct job slice ##
+    std::shared_ptr<Job> job = wtq.running.back()->job;
     job_slice.job = job;
-    job_slice.slice = job->tensor_;
-
-    // How many elements should this thread work on?
-    job_slice.slice.numel = job->tensor_.numel / num_worker_threads;
-    int remainder = job->tensor_.numel % num_worker_threads;
-    // What about the remainder elements? Divide those across threads.
-    // SUGGESTION: the number of extra elements is too small for us to care. Just give it to the first thread.
-    bool get_extra_element = remainder > worker_thread_id;
-    Numel offset;
-    if (get_extra_element) {
-        job_slice.slice.numel++;
-        // If this worker thread got an extra element, then all previous
-        // worker threads also got an extra element.
-        offset = worker_thread_id * job_slice.slice.numel;
+    job_slice.owner_tid = worker_thread_id;
+    Numel offset = 0;
+    if(this->IsSmallJob(*job)) {
+        job_slice.slice = job->tensor_;
     } else {
-        // If this worker thread did not get an extra element, then the remainder elements
-        // have been added across previous threads.
-        offset = worker_thread_id * job_slice.slice.numel + remainder;
+        offset = this->SliceTensor(job->tensor_, worker_thread_id, job_slice.slice);
+    }
+
+    // Set job status to running. Only the first worker thread to reach the job needs to do it.
+    if(job->GetJobStatus() == JobStatus::QUEUED) {
+        job->SetJobStatus(JobStatus::RUNNING);
     }
-    job_slice.slice.OffsetPtrs(offset);
-    // Set job status to running
-    job->SetJobStatus(JobStatus::RUNNING);
 
     DVLOG(2) << "A job slice from job id: " << job_slice.job->id_ << " with offset: " << offset << " numel: " << job_slice.slice.numel
         << " was given to worker thread '" << worker_thread_id << "'.";
@@ -116,33 +194,29 @@ bool FifoScheduler::GetJobSlice(WorkerTid worker_thread_id, JobSlice& job_slice)
 }
 
 bool FifoScheduler::NotifyJobSliceCompletion(WorkerTid worker_thread_id, const JobSlice& job_slice){
-    std::unique_lock<std::mutex> lock(this->access_mutex_);
     if(this->stopped_) {
         job_slice.job->SetJobStatus(JobStatus::FAILED);
         return false;
     }
-    int& finished_job_slices = this->finished_job_slices_.at(job_slice.job->id_);
-    finished_job_slices++;
+    // Only the owning worker thread touches its running job states so no locking is needed here.
+    // Worker threads notify the completion of their job slices in the order in which they got them.
+    WorkerThreadQueue& wtq = this->queues_[worker_thread_id];
+    std::shared_ptr<JobState> job_state = std::move(wtq.running.front());
+    wtq.running.pop_front();
+    DCHECK(job_state->job == job_slice.job) << "Worker thread '" << worker_thread_id << "' notified the completion of a job slice it was not given.";
     DVLOG(2) << "Worker thread '" << worker_thread_id << "' has finished its job slice for job id: " << job_slice.job->id_ << ".";
-    bool finished_job = finished_job_slices == this->config_.general_.num_worker_threads;
-    if(finished_job){
-        this->finished_job_slices_.erase(job_slice.job->id_);
-    }
-    return finished_job;
+    // The thread that brings the counter to 0 is the one that finished the job.
+    return job_state->unfinished_job_slices.fetch_sub(1, std::memory_order_acq_rel) == 1;
 }
 
 void FifoScheduler::Stop() {
     Scheduler::Stop();
-    std::unique_lock<std::mutex> lock(this->access_mutex_);
-    this->barrier_.Destroy();
-    // Set all the current jobs that haven't finished to failed.
-    // This will also wakeup any thread waiting on a job.
-    while(!this->queue_.empty()) {
-        this->queue_.front()->SetJobStatus(JobStatus::FAILED);
-        this->queue_.pop();
+    // Wakeup any worker thread waiting on its queue.
+    // Jobs that are still queued are set to failed when the scheduler is destroyed.
+    for(WorkerThreadQueue& wtq : this->queues_) {
+        { std::unique_lock<std::mutex> lock(wtq.access_mutex); }
+        wtq.job_submitted_event.notify_all();
     }
-    this->undispatched_job_slices_.clear();
-    this->finished_job_slices_.clear();
 }
 
 } // namespace switchml
\ No newline at end of file
@@ -23,8 +23,10 @@
 #ifndef SWITCHML_FIFO_SCHEDULER_H_
 #define SWITCHML_FIFO_SCHEDULER_H_
 
-#include <queue>
-#include <unordered_map>
+#include <vector>
+#include <atomic>
+#include <mutex>
+#include <condition_variable>
 
 #include "common.h"
 #include "job.h"
@@ -34,7 +36,7 @@
 namespace switchml {
 
 /**
- * @brief A subclass of Scheduler that uses a single FIFO queue to store and dispatch jobs. 
+ * @brief A subclass of Scheduler that dispatches jobs in FIFO order. 
  * 
  * Jobs are divided into almost-equally-sized job slices where each worker thread works on a single job slice.
  * 
@@ -46,6 +48,14 @@ namespace switchml {
  * The static mapping is done to avoid collisions at the switch because each worker thread is assigned a unique slot in
  * the switch (at least with the current p4 program version). And we want to make sure that for example elements 0-7 in worker node 0 and 
  * worker node 1 are all heading to the same slot in the switch.
+ * 
+ * Since the mapping is static, worker threads do not need to agree on anything at job boundaries.
+ * Each worker thread owns a private FIFO queue that receives a reference to every enqueued job, and it
+ * only ever touches its own queue. The queues are lock free with many producers (So submitting to one stream never blocks
+ * submitting to another) and a single consumer (The owning worker thread). A mutex is only taken to put an idle
+ * worker thread to sleep and to wake it up. There is no barrier between worker threads, so a fast thread can move on
+ * to its slice of the next job while a slower thread is still working on the previous one.
+ * Job completion is tracked with an atomic counter of unfinished slices that is shared by all worker threads.
  */
 class FifoScheduler : public switchml::Scheduler {
   public:
@@ -53,10 +63,17 @@ class FifoScheduler : public switchml::Scheduler {
      * @brief Initialize all the members
      * 
      * @param [in] config the switchml configuration.
+     * @param [in] num_worker_threads The number of worker threads of the stream that this scheduler serves.
      */
-    FifoScheduler(Config& config);
+    FifoScheduler(Config& config, uint16_t num_worker_threads);
 
-    ~FifoScheduler() = default;
+    /**
+     * @brief Sets all jobs that are still queued to failed.
+     * 
+     * This is not done in Stop() since only the owning worker thread may take jobs out of its queue.
+     * The context destroys the scheduler after all worker threads have exited.
+     */
+    ~FifoScheduler();
 
     FifoScheduler(FifoScheduler const&) = delete;
     void operator=(FifoScheduler const&) = delete;
@@ -64,69 +81,124 @@ class FifoScheduler : public switchml::Scheduler {
     FifoScheduler(FifoScheduler&&) = default;
     FifoScheduler& operator=(FifoScheduler&&) = default;
 
+    /**
+     * @brief Add a job to the queue of every worker thread.
+     * 
+     * Small jobs are only added to the queue of a single worker thread.
+     * This does not take any lock unless a worker thread has to be woken up.
+     * The scheduler does not order concurrent calls: jobs that are enqueued concurrently can reach the queues in a different order
+     * on each worker and the switch would then aggregate different jobs together. Keeping the order is the caller's job.
+     * The context rejects concurrent submitters on the same stream in debug builds (See Context::AllReduceAsync()).
+     * 
+     * @param [in] job a shared pointer for the job that we will enqueue
+     * @return true if we could add the request successfully.
+     * @return false otherwise.
+     */
     bool EnqueueJob(std::shared_ptr<Job> job) override;
 
+    /**
+     * @brief Add a group of jobs to the queues of the worker threads as a unit.
+     * 
+     * Each worker thread is woken up at most once for the whole group.
+     * 
+     * @param [in] jobs the jobs that we will enqueue in order.
+     * @return true if we could add the jobs successfully.
+     * @return false otherwise.
+     */
+    bool EnqueueJobs(const std::vector<std::shared_ptr<Job>>& jobs) override;
+
     /**
      * @brief Get a job request slice.
      * 
      * This is called through the context by worker threads to get a job slice.
-     * How the Job is sliced and distributed depends on the scheduler implementation.
-     * The function should block the calling thread until a job slice is retrieved.
-     * 
-     * This function implements a worker thread barrier that ensures
-     * that no worker thread gets ahead of other worker threads and that all worker threads
-     * are working on the same job. This is unecessary but it allows us to use a single simple
-     * queue with constant GetJobSlice time.
+     * If block is true, the function blocks the calling thread until its own queue has a job.
      * 
      * @param [in] worker_thread_id  The id of the worker thread that wants a job slice.
      * @param [out] job_slice  A reference to a job slice variable. 
+     * @param [in] block Whether to wait for a job slice if none is available right away.
      * @return true if the scheduler returned a valid job slice.
      * @return false the caller was forced to wakeup and the scheduler did not return a valid job slice.
      */
-    bool GetJobSlice(WorkerTid worker_thread_id, JobSlice& job_slice) override;
+    bool GetJobSlice(WorkerTid worker_thread_id, JobSlice& job_slice, bool block) override;
 
     /**
      * @brief Signal the scheduler that a job slice has been finished.
      * 
+     * This does not take any lock. It decrements the unfinished slices counter of the job
+     * that the calling worker thread is currently working on.
+     * 
      * @param [in] worker_thread_id The id of the worker thread that finished the job slice.
      * @param [in] job_slice The job slice that finished.
      * @return true If the job corresponding to this job slice has finished all its job slices.
      * @return false If there is still some job slices to be completed either by other worker threads.
      * or if the scheduler has already stopped.
      */
-    bool NotifyJobSliceCompletion(WorkerTid worker_thread_i, const JobSlice& job_slice) override;
+    bool NotifyJobSliceCompletion(WorkerTid worker_thread_id, const JobSlice& job_slice) override;
 
     /**
-     * @brief calls Scheduler::Stop(), wakes up all threads waiting, and clears all queues.
+     * @brief calls Scheduler::Stop() and wakes up all threads waiting.
      * 
-     * After calling the super function Scheduler::Stop(), the functions destroys the barrier waking up all
-     * threads that are waiting on the barrier.
-     * Then the function sets all unfinished jobs to failed thus waking up any threads waiting on a specific job.
-     * Finally, it clears queue_, undispatched_job_slices_, and undispatched_job_slices_
+     * After calling the super function Scheduler::Stop(), the function wakes up all
+     * worker threads that are waiting on their queues.
+     * Jobs that are still queued are set to failed when the scheduler is destroyed.
      */
     void Stop() override;
 
   private:
     /**
-     * This simple fifo queue is the main data structure for this scheduler.
-     * Jobs are added to the back, job slices are taken from the front.
+     * @brief The state of a job that is shared between all worker threads.
+     */
+    struct JobState {
+        /** The job itself */
+        std::shared_ptr<Job> job;
+        /**
+         * The number of job slices that have not finished yet.
+         * Once it reaches 0 the job is finished.
+         */
+        std::atomic<int> unfinished_job_slices;
+    };
+
+    /**
+     * @brief A FIFO queue owned by a single worker thread.
+     * 
+     * It is aligned to a cache line so that worker threads polling their own queues
+     * do not falsely share cache lines with each other.
      */
-    std::queue<std::shared_ptr<Job>> queue_;
-    
+    struct alignas(64) WorkerThreadQueue {
+        /** Only used to put the owning worker thread to sleep and to wake it up. */
+        std::mutex access_mutex;
+        /** Signals the owning worker thread that a job was added to the queue. */
+        std::condition_variable job_submitted_event;
+        /** Whether the owning worker thread is waiting (Or about to wait) on the job_submitted_event. */
+        std::atomic<bool> waiting{false};
+        /** Jobs are added to the back by submitting threads, the owning worker thread takes them from the front. */
+        MpscQueue<std::shared_ptr<JobState>> queue;
+        /** The jobs that the owning worker thread is currently working on in the order it got them. Only accessed by the owning worker thread. */
+        RingQueue<std::shared_ptr<JobState>> running;
+    };
+
     /**
-     * This map will store the number of job slices that finished for each job.
-     * Once the number of job slices reaches the number worker threads, it means
-     * the job is finished. 
+     * @brief Add a job state to the back of a worker thread's queue.
+     * 
+     * If the queue is full then this wakes up the owning worker thread and yields until it makes room.
+     * If the scheduler is stopped meanwhile then the job is failed since no worker thread will make room anymore.
+     * 
+     * @param [in] wtq The worker thread's queue.
+     * @param [in] job_state The state of the job to add.
+     * @return true If the job state was added.
+     * @return false If the scheduler was stopped and the job was failed.
      */
-    std::unordered_map<JobId, int> finished_job_slices_;
-    
-    /** This map will store the number of job slices that are yet to be dispatched. */
-    std::unordered_map<JobId, int> undispatched_job_slices_;
+    bool Push(WorkerThreadQueue& wtq, std::shared_ptr<JobState> job_state);
 
     /**
-     * A synchronization barrier used by GetJobSlice
+     * @brief Wake up the owning worker thread of a queue if it is waiting for a job.
+     * 
+     * @param [in] wtq The worker thread's queue.
      */
-    Barrier barrier_;
+    void WakeUp(WorkerThreadQueue& wtq);
+
+    /** One queue per worker thread indexed by the worker thread id. */
+    std::vector<WorkerThreadQueue> queues_;
 };
 
 } // namespace switchml
@@ -0,0 +1,286 @@
+/*
+  Copyright 2021 Intel-KAUST-Microsoft
+
+  Licensed under the Apache License, Version 2.0 (the "License");
+  you may not use this file except in compliance with the License.
+  You may obtain a copy of the License at
+
+     http://www.apache.org/licenses/LICENSE-2.0
+
+  Unless required by applicable law or agreed to in writing, software
+  distributed under the License is distributed on an "AS IS" BASIS,
+  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+  See the License for the specific language governing permissions and
+  limitations under the License.
+*/
+
+/**
+ * SwitchML Project
+ * @file fusion_scheduler.cc
+ * @brief Implements the FusionScheduler class.
+ */
+
+#include "common_cc.h"
+#include "fusion_scheduler.h"
+#include "config.h"
+#include "utils.h"
+
+namespace switchml {
+
+FusionScheduler::FusionScheduler(Config& config, uint16_t num_worker_threads)
+    : Scheduler(config, num_worker_threads)
+    , queues_(num_worker_threads)
+    , pending_group_()
+    , group_pending_(false)
+    , pending_group_number_(0)
+{
+    // nothing to do here
+}
+
+bool FusionScheduler::EnqueueJob(std::shared_ptr<Job> job) {
+    if(this->stopped_) {
+        job->SetJobStatus(JobStatus::FAILED);
+        return false;
+    }
+    job->SetJobStatus(JobStatus::QUEUED);
+    const Numel fusion_threshold_numel = this->config_.general_.fusion_threshold_numel;
+
+    std::unique_lock<std::mutex> lock(this->fusion_mutex_);
+    // Only all reduce jobs of contiguous tensors are fused. The other collectives do not load or unload the whole tensor of each worker
+    // (Ex. each ReduceScatter or AllGather job has its own shard) and segmented tensors are reduced without staging copies.
+    // Jobs with progressive input cannot be copied into the fusion buffer before their input is ready
+    // and jobs that track their chunks would only get their output once the whole fused job finishes.
+    if(job->tensor_.numel == 0 || job->tensor_.numel > fusion_threshold_numel || job->job_type_ != JobType::ALLREDUCE || !job->segments_.empty()
+       || job->IsProgressive() || job->TracksChunks() || job->HasPostReduction()) {
+        // The job will not be fused. Dispatch the pending group first to keep the FIFO order.
+        if(this->group_pending_) {
+            this->DispatchPendingGroup();
+        }
+        this->DispatchJob(job);
+        DVLOG(2) << "Queued job id: " << job->id_ << " job_type: " << job->job_type_ 
+            << " numel: " << job->tensor_.numel << " data_type: " << job->tensor_.data_type;
+        return true;
+    }
+
+    if(this->group_pending_ && !this->CanJoinPendingGroup(job)) {
+        this->DispatchPendingGroup();
+    }
+
+    if(!this->group_pending_) {
+        // Start a new group.
+        if(this->free_buffers_.empty()) {
+            this->pending_group_.buffer = std::make_unique<char[]>(fusion_threshold_numel * DataTypeSize(job->tensor_.data_type));
+        } else {
+            this->pending_group_.buffer = std::move(this->free_buffers_.back());
+            this->free_buffers_.pop_back();
+        }
+        this->pending_group_.numel = 0;
+        this->group_pending_ = true;
+        this->pending_group_number_++;
+    }
+
+    // Gather the job's input into the fusion buffer.
+    const uint16_t element_size = DataTypeSize(job->tensor_.data_type);
+    memcpy(this->pending_group_.buffer.get() + this->pending_group_.numel * element_size, job->tensor_.in_ptr, job->tensor_.numel * element_size);
+    this->pending_group_.numel += job->tensor_.numel;
+    this->pending_group_.jobs.push_back(job);
+    // Waiting on the job dispatches its group if it is still pending.
+    const uint64_t group_number = this->pending_group_number_;
+    job->SetFlushCallback([this, group_number](Job&) { this->FlushGroup(group_number); });
+    DVLOG(2) << "Added job id: " << job->id_ << " job_type: " << job->job_type_ << " numel: " << job->tensor_.numel
+        << " data_type: " << job->tensor_.data_type << " to the pending fusion group.";
+
+    if(this->pending_group_.numel == fusion_threshold_numel) {
+        this->DispatchPendingGroup();
+    }
+    return true;
+}
+
+bool FusionScheduler::EnqueueJobs(const std::vector<std::shared_ptr<Job>>& jobs) {
+    bool all_enqueued = Scheduler::EnqueueJobs(jobs);
+    // Groups never span batches.
+    this->Flush();
+    return all_enqueued;
+}
+
+void FusionScheduler::Flush() {
+    std::unique_lock<std::mutex> lock(this->fusion_mutex_);
+    if(this->group_pending_ && !this->stopped_) {
+        this->DispatchPendingGroup();
+    }
+}
+
+void FusionScheduler::FlushGroup(uint64_t group_number) {
+    std::unique_lock<std::mutex> lock(this->fusion_mutex_);
+    if(this->group_pending_ && this->pending_group_number_ == group_number && !this->stopped_) {
+        this->DispatchPendingGroup();
+    }
+}
+
+bool FusionScheduler::GetJobSlice(WorkerTid worker_thread_id, JobSlice& job_slice, bool block) {
+    DVLOG(2) << "Worker thread '" << worker_thread_id << "' is asking for a job slice.";
+    WorkerThreadQueue& wtq = this->queues_[worker_thread_id];
+    std::unique_lock<std::mutex> lock(wtq.access_mutex);
+
+    // Block until we have a job. If the queue already has jobs then the thread will continue immediately.
+    if(block) {
+        DVLOG_IF(2, !this->stopped_ && wtq.queue.empty()) << "Worker thread '" << worker_thread_id << "' waiting for a job.";
+        wtq.job_submitted_event.wait(lock, [this, &wtq] {
+             return this->stopped_ || !wtq.queue.empty();
+        });
+    }
+
+    // If we were forced to stop or there is nothing to do then return false.
+    if(this->stopped_ || wtq.queue.empty()) {
+        return false;
+    }
+
+    wtq.running.push_back(std::move(wtq.queue.front()));
+    wtq.queue.pop();
+    lock.unlock();
+
+    // ## Construct job slice ##
+    std::shared_ptr<Job> job = wtq.running.back()->job;
+    job_slice.job = job;
+    job_slice.owner_tid = worker_thread_id;
+    Numel offset = 0;
+    if(this->IsSmallJob(*job)) {
+        job_slice.slice = job->tensor_;
+    } else {
+        offset = this->SliceTensor(job->tensor_, worker_thread_id, job_slice.slice);
+    }
+
+    // Set job status to running. Only the first worker thread to reach the job needs to do it.
+    if(job->GetJobStatus() == JobStatus::QUEUED) {
+        job->SetJobStatus(JobStatus::RUNNING);
+    }
+
+    DVLOG(2) << "A job slice from job id: " << job_slice.job->id_ << " with offset: " << offset
+        << " numel: " << job_slice.slice.numel << " was given to worker thread '" << worker_thread_id << "'.";
+    return true;
+}
+
+bool FusionScheduler::NotifyJobSliceCompletion(WorkerTid worker_thread_id, const JobSlice& job_slice){
+    if(this->stopped_) {
+        job_slice.job->SetJobStatus(JobStatus::FAILED);
+        return false;
+    }
+    // Only the owning worker thread touches its running job states so no locking is needed here.
+    // Worker threads notify the completion of their job slices in the order in which they got them.
+    WorkerThreadQueue& wtq = this->queues_[worker_thread_id];
+    std::shared_ptr<JobState> job_state = std::move(wtq.running.front());
+    wtq.running.pop_front();
+    DCHECK(job_state->job == job_slice.job) << "Worker thread '" << worker_thread_id << "' notified the completion of a job slice it was not given.";
+    DVLOG(2) << "Worker thread '" << worker_thread_id << "' has finished its job slice for job id: " << job_slice.job->id_ << ".";
+    // The thread that brings the counter to 0 is the one that finished the job.
+    return job_state->unfinished_job_slices.fetch_sub(1, std::memory_order_acq_rel) == 1;
+}
+
+uint64_t FusionScheduler::FinishJob(std::shared_ptr<Job> job, const std::function<void(Job&)>& job_finished) {
+    std::unique_lock<std::mutex> lock(this->fusion_mutex_);
+    auto it = this->dispatched_groups_.find(job->id_);
+    if(it == this->dispatched_groups_.end()) {
+        lock.unlock();
+        return Scheduler::FinishJob(job, job_finished);
+    }
+    FusionGroup group = std::move(it->second);
+    this->dispatched_groups_.erase(it);
+    lock.unlock();
+
+    // Scatter the results back to the fused jobs.
+    const uint16_t element_size = DataTypeSize(job->tensor_.data_type);
+    const char* results = group.buffer.get();
+    for(std::shared_ptr<Job>& fused_job : group.jobs) {
+        memcpy(fused_job->tensor_.out_ptr, results, fused_job->tensor_.numel * element_size);
+        results += fused_job->tensor_.numel * element_size;
+        fused_job->SetJobStatus(JobStatus::FINISHED);
+        job_finished(*fused_job);
+    }
+    job->SetJobStatus(JobStatus::FINISHED);
+    DVLOG(2) << "Finished fused job id: " << job->id_ << " which fused " << group.jobs.size() << " jobs.";
+
+    lock.lock();
+    this->free_buffers_.push_back(std::move(group.buffer));
+    return group.jobs.size();
+}
+
+void FusionScheduler::Stop() {
+    Scheduler::Stop();
+    {
+        std::unique_lock<std::mutex> lock(this->fusion_mutex_);
+        for(std::shared_ptr<Job>& job : this->pending_group_.jobs) {
+            job->SetJobStatus(JobStatus::FAILED);
+        }
+        this->pending_group_.jobs.clear();
+        this->group_pending_ = false;
+        for(auto& id_group : this->dispatched_groups_) {
+            for(std::shared_ptr<Job>& job : id_group.second.jobs) {
+                job->SetJobStatus(JobStatus::FAILED);
+            }
+        }
+        this->dispatched_groups_.clear();
+    }
+    // Set all the current jobs that haven't finished to failed.
+    // This will also wakeup any thread waiting on a job.
+    for(WorkerThreadQueue& wtq : this->queues_) {
+        std::unique_lock<std::mutex> lock(wtq.access_mutex);
+        while(!wtq.queue.empty()) {
+            wtq.queue.front()->job->SetJobStatus(JobStatus::FAILED);
+            wtq.queue.pop();
+        }
+        lock.unlock();
+        wtq.job_submitted_event.notify_all();
+    }
+}
+
+bool FusionScheduler::CanJoinPendingGroup(const std::shared_ptr<Job>& job) {
+    const std::shared_ptr<Job>& first_job = this->pending_group_.jobs.front();
+    return job->job_type_ == first_job->job_type_
+        && job->tensor_.data_type == first_job->tensor_.data_type
+        && (job->job_type_ != JobType::ALLREDUCE || job->extra_job_info_.allreduce_operation == first_job->extra_job_info_.allreduce_operation)
+        && this->pending_group_.numel + job->tensor_.numel <= this->config_.general_.fusion_threshold_numel;
+}
+
+void FusionScheduler::DispatchJob(std::shared_ptr<Job> job) {
+    std::shared_ptr<JobState> job_state = std::allocate_shared<JobState>(PoolAllocator<JobState>());
+    job_state->job = job;
+    if(this->IsSmallJob(*job)) {
+        // Small jobs are not sliced. A single worker thread works on the whole job.
+        job_state->unfinished_job_slices = 1;
+        WorkerThreadQueue& wtq = this->queues_[this->NextSmallJobWorkerThread()];
+        {
+            std::unique_lock<std::mutex> lock(wtq.access_mutex);
+            wtq.queue.push(job_state);
+        }
+        wtq.job_submitted_event.notify_one();
+    } else {
+        job_state->unfinished_job_slices = this->num_worker_threads_;
+        for(WorkerThreadQueue& wtq : this->queues_) {
+            {
+                std::unique_lock<std::mutex> lock(wtq.access_mutex);
+                wtq.queue.push(job_state);
+            }
+            wtq.job_submitted_event.notify_one();
+        }
+    }
+}
+
+void FusionScheduler::DispatchPendingGroup() {
+    const std::shared_ptr<Job>& first_job = this->pending_group_.jobs.front();
+    Tensor tensor;
+    tensor.in_ptr = this->pending_group_.buffer.get();
+    tensor.out_ptr = this->pending_group_.buffer.get();
+    tensor.numel = this->pending_group_.numel;
+    tensor.data_type = first_job->tensor_.data_type;
+    std::shared_ptr<Job> fused_job = std::allocate_shared<Job>(PoolAllocator<Job>(), tensor, first_job->job_type_, first_job->extra_job_info_, first_job->priority_);
+    fused_job->SetJobStatus(JobStatus::QUEUED);
+    DVLOG(2) << "Queued fused job id: " << fused_job->id_ << " which fuses " << this->pending_group_.jobs.size() << " jobs"
+        << " numel: " << tensor.numel << " data_type: " << tensor.data_type;
+
+    this->dispatched_groups_.emplace(fused_job->id_, std::move(this->pending_group_));
+    this->pending_group_.jobs.clear();
+    this->group_pending_ = false;
+    this->DispatchJob(fused_job);
+}
+
+} // namespace switchml
@@ -0,0 +1,244 @@
+/*
+  Copyright 2021 Intel-KAUST-Microsoft
+
+  Licensed under the Apache License, Version 2.0 (the "License");
+  you may not use this file except in compliance with the License.
+  You may obtain a copy of the License at
+
+     http://www.apache.org/licenses/LICENSE-2.0
+
+  Unless required by applicable law or agreed to in writing, software
+  distributed under the License is distributed on an "AS IS" BASIS,
+  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+  See the License for the specific language governing permissions and
+  limitations under the License.
+*/
+
+/**
+ * SwitchML Project
+ * @file fusion_scheduler.h
+ * @brief Declares the FusionScheduler class.
+ */
+
+#ifndef SWITCHML_FUSION_SCHEDULER_H_
+#define SWITCHML_FUSION_SCHEDULER_H_
+
+#include <queue>
+#include <deque>
+#include <vector>
+#include <unordered_map>
+#include <atomic>
+#include <mutex>
+#include <condition_variable>
+
+#include "common.h"
+#include "job.h"
+#include "scheduler.h"
+
+namespace switchml {
+
+/**
+ * @brief A subclass of Scheduler that fuses consecutive small jobs into a single job and dispatches jobs in FIFO order.
+ * 
+ * Frameworks like PyTorch DDP submit many tiny tensors where each of them pays the full per job cost
+ * (prepostprocessor setup, a partial last packet, an extra exponent batch...). This scheduler copies consecutive
+ * small jobs that have the same type, operation, and data type into a fusion buffer, reduces the whole buffer as a
+ * single job, then copies the results back into each submitted job's output and finishes it.
+ * 
+ * A job is fused if it has at most general.fusion_threshold_numel elements and is an all reduce job of a contiguous tensor
+ * without progressive input, chunk tracking or a post reduction kernel. The group of fused jobs is dispatched to the worker threads as soon as:
+ * - The next job does not fit in the fusion buffer (general.fusion_threshold_numel elements) or cannot be fused with the group.
+ * - A job that is too large to be fused is submitted. The group is dispatched before it to keep the FIFO order.
+ * - A batch ends (Ex. at the end of an AllReduceGroupAsync() call or at Context::EndBatch()).
+ * - The application calls Context::Flush() or Context::WaitForAllJobs().
+ * 
+ * - The application waits on one of the jobs of the group with Job::WaitToComplete().
+ * 
+ * All workers must fuse the same jobs together so the group is never dispatched based on time.
+ * Jobs that are waiting in the group are not dispatched until one of the above happens, so call Context::Flush()
+ * before polling the status of such a job or waiting on its completion callbacks or event fd.
+ * 
+ * Fusion buffers are pooled and reused once the fused job finishes.
+ * Apart from fusion, this scheduler behaves exactly like the FifoScheduler.
+ */
+class FusionScheduler : public switchml::Scheduler {
+  public:
+    /**
+     * @brief Initialize all the members
+     * 
+     * @param [in] config the switchml configuration.
+     * @param [in] num_worker_threads The number of worker threads of the stream that this scheduler serves.
+     */
+    FusionScheduler(Config& config, uint16_t num_worker_threads);
+
+    ~FusionScheduler() = default;
+
+    FusionScheduler(FusionScheduler const&) = delete;
+    void operator=(FusionScheduler const&) = delete;
+
+    FusionScheduler(FusionScheduler&&) = default;
+    FusionScheduler& operator=(FusionScheduler&&) = default;
+
+    /**
+     * @brief Add a job to the pending fusion group or to the queue of every worker thread.
+     * 
+     * @param [in] job a shared pointer for the job that we will enqueue
+     * @return true if we could add the request successfully.
+     * @return false otherwise.
+     */
+    bool EnqueueJob(std::shared_ptr<Job> job) override;
+
+    /**
+     * @brief Add a batch of jobs to the pending fusion group or to the queue of every worker thread then dispatch the pending fusion group.
+     * 
+     * @param [in] jobs the jobs that we will enqueue in order.
+     * @return true if we could add the jobs successfully.
+     * @return false otherwise.
+     */
+    bool EnqueueJobs(const std::vector<std::shared_ptr<Job>>& jobs) override;
+
+    /**
+     * @brief Dispatch the pending fusion group if there is one.
+     */
+    void Flush() override;
+
+    /**
+     * @brief Get a job slice.
+     * 
+     * If block is true, the function blocks the calling thread until its own queue has a job.
+     * 
+     * @param [in] worker_thread_id  The id of the worker thread that wants a job slice.
+     * @param [out] job_slice  A reference to a job slice variable. 
+     * @param [in] block Whether to wait for a job slice if none is available right away.
+     * @return true if the scheduler returned a valid job slice.
+     * @return false the caller was forced to wakeup and the scheduler did not return a valid job slice.
+     */
+    bool GetJobSlice(WorkerTid worker_thread_id, JobSlice& job_slice, bool block) override;
+
+    /**
+     * @brief Signal the scheduler that a job slice has been finished.
+     * 
+     * @param [in] worker_thread_id The id of the worker thread that finished the job slice.
+     * @param [in] job_slice The job slice that finished.
+     * @return true If the job corresponding to this job slice has finished all its job slices.
+     * @return false If there is still some job slices to be completed either by other worker threads.
+     * or if the scheduler has already stopped.
+     */
+    bool NotifyJobSliceCompletion(WorkerTid worker_thread_id, const JobSlice& job_slice) override;
+
+    /**
+     * @brief Copy the results of a fused job back to the jobs that it fused and finish them.
+     * 
+     * Jobs that were not fused are simply set to finished.
+     * 
+     * @param [in] job The job that has been fully completed.
+     * @param [in] job_finished Called for each submitted job right after its status was set. It is not called for the fused job itself.
+     * @return uint64_t The number of submitted jobs that finished.
+     */
+    uint64_t FinishJob(std::shared_ptr<Job> job, const std::function<void(Job&)>& job_finished) override;
+
+    /**
+     * @brief calls Scheduler::Stop(), wakes up all threads waiting, and clears all queues.
+     * 
+     * All jobs that are still queued, pending fusion, or part of a running fused job are set to failed.
+     */
+    void Stop() override;
+
+  private:
+    /**
+     * @brief The state of a job that is shared between all worker threads.
+     */
+    struct JobState {
+        /** The job itself */
+        std::shared_ptr<Job> job;
+        /**
+         * The number of job slices that have not finished yet.
+         * Once it reaches 0 the job is finished.
+         */
+        std::atomic<int> unfinished_job_slices;
+    };
+
+    /**
+     * @brief A FIFO queue owned by a single worker thread.
+     */
+    struct alignas(64) WorkerThreadQueue {
+        /** Protects the queue. Only the owning worker thread and submitting threads use it. */
+        std::mutex access_mutex;
+        /** Signals the owning worker thread that a job was added to the queue. */
+        std::condition_variable job_submitted_event;
+        /** The jobs that the owning worker thread still needs to work on. */
+        std::queue<std::shared_ptr<JobState>> queue;
+        /** The jobs that the owning worker thread is currently working on in the order it got them. Only accessed by the owning worker thread. */
+        std::deque<std::shared_ptr<JobState>> running;
+    };
+
+    /**
+     * @brief A group of submitted jobs that share a fusion buffer.
+     */
+    struct FusionGroup {
+        /** The submitted jobs in the order in which they were copied into the buffer. */
+        std::vector<std::shared_ptr<Job>> jobs;
+        /** The fusion buffer. */
+        std::unique_ptr<char[]> buffer;
+        /** The number of elements used in the fusion buffer */
+        Numel numel;
+    };
+
+    /**
+     * @brief Check whether a job can be added to the pending fusion group.
+     * 
+     * @param [in] job The job to check.
+     * @return true if the job is small enough and matches the jobs already in the group.
+     * @return false otherwise.
+     */
+    bool CanJoinPendingGroup(const std::shared_ptr<Job>& job);
+
+    /**
+     * @brief Add a job to the queue of every worker thread.
+     * 
+     * Small jobs are only added to the queue of a single worker thread.
+     * 
+     * @param [in] job The job to dispatch.
+     */
+    void DispatchJob(std::shared_ptr<Job> job);
+
+    /**
+     * @brief Create a single job out of the pending fusion group and dispatch it.
+     * 
+     * The fusion_mutex_ must be held by the caller.
+     */
+    void DispatchPendingGroup();
+
+    /**
+     * @brief Dispatch the pending fusion group if it is still the given group.
+     * 
+     * This is the flush callback of the jobs of the group (See Job::SetFlushCallback()).
+     * 
+     * @param [in] group_number The number of the group that the waited on job was added to.
+     */
+    void FlushGroup(uint64_t group_number);
+
+    /** One queue per worker thread indexed by the worker thread id. */
+    std::vector<WorkerThreadQueue> queues_;
+
+    /** Protects all fusion related members. Always acquired before any of the worker thread queue mutexes. */
+    std::mutex fusion_mutex_;
+
+    /** The group of jobs that are waiting to be fused. */
+    FusionGroup pending_group_;
+
+    /** Whether there are jobs in the pending fusion group. */
+    bool group_pending_;
+
+    /** The number of the pending fusion group. Incremented every time a group is started so that a job can tell whether its group is still pending. */
+    uint64_t pending_group_number_;
+
+    /** Fusion groups that have been dispatched indexed by the id of the job that fused them. */
+    std::unordered_map<JobId, FusionGroup> dispatched_groups_;
+
+    /** Fusion buffers that can be reused. */
+    std::vector<std::unique_ptr<char[]>> free_buffers_;
+};
+
+} // namespace switchml
+#endif // SWITCHML_FUSION_SCHEDULER_H_
@@ -0,0 +1,51 @@
+/*
+  Copyright 2021 Intel-KAUST-Microsoft
+
+  Licensed under the Apache License, Version 2.0 (the "License");
+  you may not use this file except in compliance with the License.
+  You may obtain a copy of the License at
+
+     http://www.apache.org/licenses/LICENSE-2.0
+
+  Unless required by applicable law or agreed to in writing, software
+  distributed under the License is distributed on an "AS IS" BASIS,
+  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+  See the License for the specific language governing permissions and
+  limitations under the License.
+*/
+
+/**
+ * SwitchML Project
+ * @file priority_scheduler.cc
+ * @brief Implements the PriorityScheduler class.
+ */
+
+#include "common_cc.h"
+#include "priority_scheduler.h"
+#include "config.h"
+#include "utils.h"
+
+#include <limits>
+
+namespace switchml {
+
+PriorityScheduler::PriorityScheduler(Config& config, uint16_t num_worker_threads)
+    : BatchScheduler(config, num_worker_threads, std::numeric_limits<Numel>::max())
+{
+    // Chunks are larger than any job so jobs are dispatched whole.
+}
+
+size_t PriorityScheduler::SelectJob(const std::deque<JobProgress>& batch) {
+    size_t selected = 0;
+    for(size_t i = 1; i < batch.size(); i++) {
+        const JobProgress& candidate = batch[i];
+        const JobProgress& best = batch[selected];
+        if(candidate.job_state->job->priority_ > best.job_state->job->priority_
+           || (candidate.job_state->job->priority_ == best.job_state->job->priority_ && candidate.position < best.position)) {
+            selected = i;
+        }
+    }
+    return selected;
+}
+
+} // namespace switchml
@@ -0,0 +1,76 @@
+/*
+  Copyright 2021 Intel-KAUST-Microsoft
+
+  Licensed under the Apache License, Version 2.0 (the "License");
+  you may not use this file except in compliance with the License.
+  You may obtain a copy of the License at
+
+     http://www.apache.org/licenses/LICENSE-2.0
+
+  Unless required by applicable law or agreed to in writing, software
+  distributed under the License is distributed on an "AS IS" BASIS,
+  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+  See the License for the specific language governing permissions and
+  limitations under the License.
+*/
+
+/**
+ * SwitchML Project
+ * @file priority_scheduler.h
+ * @brief Declares the PriorityScheduler class.
+ */
+
+#ifndef SWITCHML_PRIORITY_SCHEDULER_H_
+#define SWITCHML_PRIORITY_SCHEDULER_H_
+
+#include <deque>
+
+#include "common.h"
+#include "job.h"
+#include "batch_scheduler.h"
+
+namespace switchml {
+
+/**
+ * @brief A subclass of BatchScheduler that dispatches the most urgent job of each batch first.
+ * 
+ * The jobs of a batch (Ex. an AllReduceGroupAsync() call or the jobs submitted between Context::BeginBatch() and Context::EndBatch())
+ * are ordered by their priority (Job::priority_) where higher values are dispatched first.
+ * Jobs with equal priorities are dispatched in the order in which they were submitted.
+ * This lets a framework submit the gradients of early layers with a higher priority so that they are
+ * reduced before the gradients of late layers and the next forward pass can start sooner.
+ * 
+ * Batches themselves are dispatched in FIFO order so jobs that are submitted on their own are never reordered.
+ * Apart from the dispatch order, this scheduler behaves exactly like the FifoScheduler.
+ * Jobs are sliced using the same static mapping and a job is never preempted once a worker thread started working on its slice.
+ */
+class PriorityScheduler : public switchml::BatchScheduler {
+  public:
+    /**
+     * @brief Initialize all the members
+     * 
+     * @param [in] config the switchml configuration.
+     * @param [in] num_worker_threads The number of worker threads of the stream that this scheduler serves.
+     */
+    PriorityScheduler(Config& config, uint16_t num_worker_threads);
+
+    ~PriorityScheduler() = default;
+
+    PriorityScheduler(PriorityScheduler const&) = delete;
+    void operator=(PriorityScheduler const&) = delete;
+
+    PriorityScheduler(PriorityScheduler&&) = default;
+    PriorityScheduler& operator=(PriorityScheduler&&) = default;
+
+  protected:
+    /**
+     * @brief Choose the job of the batch with the highest priority.
+     * 
+     * @param [in] batch The jobs of the current batch.
+     * @return size_t The index of the most urgent job. Ties go to the job that was submitted first.
+     */
+    size_t SelectJob(const std::deque<JobProgress>& batch) override;
+};
+
+} // namespace switchml
+#endif // SWITCHML_PRIORITY_SCHEDULER_H_
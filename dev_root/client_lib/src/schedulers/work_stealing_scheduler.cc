@@ -0,0 +1,196 @@
+/*
+  Copyright 2021 Intel-KAUST-Microsoft
+
+  Licensed under the Apache License, Version 2.0 (the "License");
+  you may not use this file except in compliance with the License.
+  You may obtain a copy of the License at
+
+     http://www.apache.org/licenses/LICENSE-2.0
+
+  Unless required by applicable law or agreed to in writing, software
+  distributed under the License is distributed on an "AS IS" BASIS,
+  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+  See the License for the specific language governing permissions and
+  limitations under the License.
+*/
+
+/**
+ * SwitchML Project
+ * @file work_stealing_scheduler.cc
+ * @brief Implements the WorkStealingScheduler class.
+ */
+
+#include "common_cc.h"
+#include "work_stealing_scheduler.h"
+#include "config.h"
+#include "utils.h"
+
+namespace switchml {
+
+WorkStealingScheduler::WorkStealingScheduler(Config& config, uint16_t num_worker_threads)
+    : Scheduler(config, num_worker_threads)
+    , partitions_(num_worker_threads, Partition{{}, false})
+{
+    // nothing to do here
+}
+
+bool WorkStealingScheduler::EnqueueJob(std::shared_ptr<Job> job) {
+    std::unique_lock<std::mutex> lock(this->access_mutex_);
+    if(this->stopped_) {
+        job->SetJobStatus(JobStatus::FAILED);
+        return false;
+    }
+    this->QueueJob(job);
+    lock.unlock();
+    this->job_submitted_event_.notify_all();
+    return true;
+}
+
+bool WorkStealingScheduler::EnqueueJobs(const std::vector<std::shared_ptr<Job>>& jobs) {
+    std::unique_lock<std::mutex> lock(this->access_mutex_);
+    if(this->stopped_) {
+        for(const std::shared_ptr<Job>& job : jobs) {
+            job->SetJobStatus(JobStatus::FAILED);
+        }
+        return false;
+    }
+    for(const std::shared_ptr<Job>& job : jobs) {
+        this->QueueJob(job);
+    }
+    lock.unlock();
+    this->job_submitted_event_.notify_all();
+    return true;
+}
+
+void WorkStealingScheduler::QueueJob(std::shared_ptr<Job> job) {
+    job->SetJobStatus(JobStatus::QUEUED);
+    std::shared_ptr<JobState> job_state = std::allocate_shared<JobState>(PoolAllocator<JobState>());
+    job_state->job = job;
+    if(this->IsSmallJob(*job)) {
+        // Small jobs are not sliced. A single partition holds the whole job.
+        job_state->unfinished_partitions = 1;
+        this->partitions_[this->NextSmallJobWorkerThread()].queue.push_back(PartitionJob{job_state, job->tensor_, 0});
+    } else {
+        job_state->unfinished_partitions = this->num_worker_threads_;
+        for(WorkerTid partition_id = 0; partition_id < (WorkerTid) this->partitions_.size(); partition_id++) {
+            PartitionJob partition_job{job_state, Tensor(), 0};
+            this->SliceTensor(job->tensor_, partition_id, partition_job.slice);
+            this->partitions_[partition_id].queue.push_back(std::move(partition_job));
+        }
+    }
+    DVLOG(2) << "Queued job id: " << job->id_ << " job_type: " << job->job_type_ 
+        << " numel: " << job->tensor_.numel << " data_type: " << job->tensor_.data_type;
+}
+
+bool WorkStealingScheduler::GetJobSlice(WorkerTid worker_thread_id, JobSlice& job_slice, bool block) {
+    DVLOG(2) << "Worker thread '" << worker_thread_id << "' is asking for a job slice.";
+    // Worker threads only overlap ranges of the same partition and that partition stays busy until the
+    // worker thread finishes its current range. So there is never a range to give to a non blocking call.
+    if(!block) {
+        return false;
+    }
+
+    std::unique_lock<std::mutex> lock(this->access_mutex_);
+
+    // Block until there is a free partition with work.
+    WorkerTid partition_id = -1;
+    this->job_submitted_event_.wait(lock, [this, worker_thread_id, &partition_id] {
+         if(this->stopped_) {
+             return true;
+         }
+         partition_id = this->FindPartition(worker_thread_id);
+         return partition_id >= 0;
+    });
+
+    // If we were forced to stop then return false.
+    if(this->stopped_) {
+        return false;
+    }
+
+    Partition& partition = this->partitions_[partition_id];
+    partition.busy = true;
+    PartitionJob& partition_job = partition.queue.front();
+
+    // ## Construct job slice ##
+    std::shared_ptr<Job> job = partition_job.job_state->job;
+    job_slice.job = job;
+    job_slice.owner_tid = partition_id;
+    job_slice.slice = partition_job.slice;
+    job_slice.slice.OffsetPtrs(partition_job.next_range_offset);
+    job_slice.slice.numel = std::min(this->config_.general_.range_numel, partition_job.slice.numel - partition_job.next_range_offset);
+    partition_job.next_range_offset += job_slice.slice.numel;
+
+    // Set job status to running. Only the first worker thread to reach the job needs to do it.
+    if(job->GetJobStatus() == JobStatus::QUEUED) {
+        job->SetJobStatus(JobStatus::RUNNING);
+    }
+
+    DVLOG(2) << "A job slice from job id: " << job_slice.job->id_ << " partition: " << partition_id
+        << " with offset: " << partition_job.next_range_offset - job_slice.slice.numel
+        << " numel: " << job_slice.slice.numel << " was given to worker thread '" << worker_thread_id << "'.";
+    DVLOG_IF(2, partition_id != worker_thread_id) << "Worker thread '" << worker_thread_id << "' stole a job slice from partition " << partition_id << ".";
+    return true;
+}
+
+bool WorkStealingScheduler::NotifyJobSliceCompletion(WorkerTid worker_thread_id, const JobSlice& job_slice){
+    std::unique_lock<std::mutex> lock(this->access_mutex_);
+    if(this->stopped_) {
+        job_slice.job->SetJobStatus(JobStatus::FAILED);
+        return false;
+    }
+    Partition& partition = this->partitions_[job_slice.owner_tid];
+    PartitionJob& partition_job = partition.queue.front();
+    DCHECK(partition.busy && partition_job.job_state->job == job_slice.job) 
+        << "Worker thread '" << worker_thread_id << "' notified the completion of a job slice it was not given.";
+    DVLOG(2) << "Worker thread '" << worker_thread_id << "' has finished its job slice for job id: " << job_slice.job->id_ 
+        << " partition: " << job_slice.owner_tid << ".";
+    partition.busy = false;
+
+    bool job_finished = false;
+    if(partition_job.next_range_offset >= partition_job.slice.numel) {
+        job_finished = --partition_job.job_state->unfinished_partitions == 0;
+        partition.queue.pop_front();
+    }
+    lock.unlock();
+    // The partition is free again so other worker threads might be able to work on it.
+    this->job_submitted_event_.notify_all();
+    return job_finished;
+}
+
+void WorkStealingScheduler::Stop() {
+    Scheduler::Stop();
+    // Set all the current jobs that haven't finished to failed.
+    std::unique_lock<std::mutex> lock(this->access_mutex_);
+    for(Partition& partition : this->partitions_) {
+        for(PartitionJob& partition_job : partition.queue) {
+            partition_job.job_state->job->SetJobStatus(JobStatus::FAILED);
+        }
+        partition.queue.clear();
+    }
+}
+
+WorkerTid WorkStealingScheduler::FindPartition(WorkerTid worker_thread_id) {
+    // Always prefer the worker thread's own partition.
+    Partition& own_partition = this->partitions_[worker_thread_id];
+    if(!own_partition.busy && !own_partition.queue.empty()) {
+        return worker_thread_id;
+    }
+    // Otherwise steal from the free partition with the most remaining work in its current job.
+    WorkerTid best_partition_id = -1;
+    Numel best_remaining_numel = 0;
+    for(WorkerTid partition_id = 0; partition_id < (WorkerTid) this->partitions_.size(); partition_id++) {
+        Partition& partition = this->partitions_[partition_id];
+        if(partition.busy || partition.queue.empty()) {
+            continue;
+        }
+        const PartitionJob& partition_job = partition.queue.front();
+        Numel remaining_numel = partition_job.slice.numel - partition_job.next_range_offset;
+        if(best_partition_id < 0 || remaining_numel > best_remaining_numel) {
+            best_partition_id = partition_id;
+            best_remaining_numel = remaining_numel;
+        }
+    }
+    return best_partition_id;
+}
+
+} // namespace switchml
@@ -0,0 +1,186 @@
+/*
+  Copyright 2021 Intel-KAUST-Microsoft
+
+  Licensed under the Apache License, Version 2.0 (the "License");
+  you may not use this file except in compliance with the License.
+  You may obtain a copy of the License at
+
+     http://www.apache.org/licenses/LICENSE-2.0
+
+  Unless required by applicable law or agreed to in writing, software
+  distributed under the License is distributed on an "AS IS" BASIS,
+  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+  See the License for the specific language governing permissions and
+  limitations under the License.
+*/
+
+/**
+ * SwitchML Project
+ * @file work_stealing_scheduler.h
+ * @brief Declares the WorkStealingScheduler class.
+ */
+
+#ifndef SWITCHML_WORK_STEALING_SCHEDULER_H_
+#define SWITCHML_WORK_STEALING_SCHEDULER_H_
+
+#include <deque>
+#include <vector>
+
+#include "common.h"
+#include "job.h"
+#include "scheduler.h"
+
+namespace switchml {
+
+/**
+ * @brief A subclass of Scheduler that dispatches jobs in FIFO order and lets idle worker threads steal work from busy ones.
+ * 
+ * Jobs are sliced using the same static mapping as the FifoScheduler. But the slice of each worker thread is further
+ * divided into packet aligned ranges of general.range_numel elements which are dispatched one at a time.
+ * 
+ * The static mapping is what keeps the switch's slots correct. Each worker thread owns a partition of the switch's slots
+ * and all workers must send the same elements to the same slots in the same order. So the ranges of a worker thread's slice
+ * (its partition) must still be processed in order and one at a time, but they do not all have to be processed by the owner.
+ * When a worker thread has no ranges left in its own partition, it steals the next range of the free partition that has
+ * the most remaining work and processes it using the owner's slots (JobSlice::owner_tid). This way a straggler thread
+ * (Ex. one that shares its core or loses more packets) only delays the range it is working on instead of its whole slice.
+ * 
+ * A job is finished once all the ranges of all partitions have been processed.
+ * 
+ * Note: the backend must be able to use another worker thread's share of the switch's slots.
+ * This is supported by the dummy and dpdk backends but not by the rdma backend.
+ */
+class WorkStealingScheduler : public switchml::Scheduler {
+  public:
+    /**
+     * @brief Initialize all the members
+     * 
+     * @param [in] config the switchml configuration.
+     * @param [in] num_worker_threads The number of worker threads of the stream that this scheduler serves.
+     */
+    WorkStealingScheduler(Config& config, uint16_t num_worker_threads);
+
+    ~WorkStealingScheduler() = default;
+
+    WorkStealingScheduler(WorkStealingScheduler const&) = delete;
+    void operator=(WorkStealingScheduler const&) = delete;
+
+    WorkStealingScheduler(WorkStealingScheduler&&) = default;
+    WorkStealingScheduler& operator=(WorkStealingScheduler&&) = default;
+
+    /**
+     * @brief Add a job's slices to the queues of all partitions.
+     * 
+     * Small jobs are not sliced and are only added to the queue of a single partition.
+     * 
+     * @param [in] job a shared pointer for the job that we will enqueue
+     * @return true if we could add the request successfully.
+     * @return false otherwise.
+     */
+    bool EnqueueJob(std::shared_ptr<Job> job) override;
+
+    /**
+     * @brief Split a group of jobs across the partitions as a unit.
+     * 
+     * The scheduler lock is taken once for the whole group and waiting worker threads are woken up once.
+     * 
+     * @param [in] jobs the jobs that we will enqueue in order.
+     * @return true if we could add the jobs successfully.
+     * @return false otherwise.
+     */
+    bool EnqueueJobs(const std::vector<std::shared_ptr<Job>>& jobs) override;
+
+    /**
+     * @brief Get the next range of the worker thread's own partition or steal one from another partition.
+     * 
+     * The function blocks the calling thread until there is a range that it can work on.
+     * Non blocking calls always return false: a worker thread holds its partition exclusively while working
+     * on a range so it can never have a second range of the same partition in flight.
+     * 
+     * @param [in] worker_thread_id  The id of the worker thread that wants a job slice.
+     * @param [out] job_slice  A reference to a job slice variable. 
+     * @param [in] block Whether to wait for a job slice if none is available right away.
+     * @return true if the scheduler returned a valid job slice.
+     * @return false the caller was forced to wakeup and the scheduler did not return a valid job slice.
+     */
+    bool GetJobSlice(WorkerTid worker_thread_id, JobSlice& job_slice, bool block) override;
+
+    /**
+     * @brief Signal the scheduler that a job slice has been finished and release its partition.
+     * 
+     * @param [in] worker_thread_id The id of the worker thread that finished the job slice.
+     * @param [in] job_slice The job slice that finished.
+     * @return true If the job corresponding to this job slice has finished all its job slices.
+     * @return false If there is still some job slices to be completed either by this or other worker threads.
+     * or if the scheduler has already stopped.
+     */
+    bool NotifyJobSliceCompletion(WorkerTid worker_thread_id, const JobSlice& job_slice) override;
+
+    /**
+     * @brief calls Scheduler::Stop(), wakes up all threads waiting, and clears all queues.
+     * 
+     * All jobs that are still queued are set to failed.
+     */
+    void Stop() override;
+
+  private:
+    /**
+     * @brief The state of a job that is shared between all partitions.
+     */
+    struct JobState {
+        /** The job itself */
+        std::shared_ptr<Job> job;
+        /**
+         * The number of partitions that have not finished all of their ranges yet.
+         * Once it reaches 0 the job is finished.
+         */
+        int unfinished_partitions;
+    };
+
+    /**
+     * @brief The progress of a partition through its slice of a job.
+     */
+    struct PartitionJob {
+        /** The shared state of the job */
+        std::shared_ptr<JobState> job_state;
+        /** The partition's slice of the job */
+        Tensor slice;
+        /** The offset of the next range to dispatch within the slice */
+        Numel next_range_offset;
+    };
+
+    /**
+     * @brief The jobs of a single partition. A partition is statically owned by the worker thread with the same id.
+     */
+    struct Partition {
+        /** The jobs that still have ranges left in this partition. */
+        std::deque<PartitionJob> queue;
+        /** Whether a worker thread is currently working on a range of this partition */
+        bool busy;
+    };
+
+    /**
+     * @brief Split a job across the partitions.
+     * 
+     * The access_mutex_ must be held by the caller.
+     * 
+     * @param [in] job a shared pointer for the job that we will enqueue
+     */
+    void QueueJob(std::shared_ptr<Job> job);
+
+    /**
+     * @brief Find the partition that a worker thread should take its next range from.
+     * 
+     * The access_mutex_ must be held by the caller.
+     * 
+     * @param [in] worker_thread_id The id of the worker thread that wants a range.
+     * @return WorkerTid The partition's id or -1 if there are no free partitions with work.
+     */
+    WorkerTid FindPartition(WorkerTid worker_thread_id);
+
+    /** The partitions indexed by the id of the worker thread that owns them. */
+    std::vector<Partition> partitions_;
+};
+
+} // namespace switchml
+#endif // SWITCHML_WORK_STEALING_SCHEDULER_H_
@@ -34,8 +34,13 @@ namespace switchml {
 Stats::Stats():
     num_worker_threads_(0),
     jobs_submitted_num_(0),
-    jobs_submitted_numel_(),
+    jobs_submitted_numel_sum_(0),
+    jobs_submitted_numel_max_(0),
+    jobs_submitted_numel_min_(UINT64_MAX),
+    jobs_submitted_numel_histogram_(),
     jobs_finished_num_(0),
+    deadline_jobs_finished_num_(0),
+    deadline_misses_lateness_us_(),
     total_pkts_sent_(nullptr),
     wrong_pkts_received_(nullptr),
     correct_pkts_received_(nullptr)
@@ -64,19 +69,39 @@ void Stats::InitStats(WorkerTid num_worker_threads) {
 #ifdef TIMEOUTS
     timeouts_num_ = new uint64_t[num_worker_threads];
 #endif
-    this->jobs_submitted_numel_.reserve(1024); // Start with a big number to improve performance
     ResetStats();
 }
 
 void Stats::LogStats() {
     std::ostringstream output;
 
+    // Describe the submitted job sizes
+    uint64_t jobs_submitted_num = this->jobs_submitted_num_;
+    std::string jobs_submitted_numel_description;
+    std::ostringstream jobs_submitted_numel_histogram;
+    if(jobs_submitted_num > 0) {
+        char buffer[200];
+        sprintf(buffer, "Sum: %-10ld Mean: %-10.4f Max: %-10ld Min: %-10ld",
+                this->jobs_submitted_numel_sum_.load(), double(this->jobs_submitted_numel_sum_) / jobs_submitted_num,
+                this->jobs_submitted_numel_max_.load(), this->jobs_submitted_numel_min_.load());
+        jobs_submitted_numel_description = buffer;
+        for(int i = 0; i < 64; i++) {
+            if(this->jobs_submitted_numel_histogram_[i] > 0) {
+                jobs_submitted_numel_histogram << "[" << (1ULL << i) << "," << (i == 63 ? UINT64_MAX : (1ULL << (i + 1)) - 1)
+                    << "]:" << this->jobs_submitted_numel_histogram_[i] << " ";
+            }
+        }
+    }
+
     // Add global stats
     output << "Stats: "
-        << "\n    Submitted jobs: #" << this->jobs_submitted_num_ << "#"
-        << "\n    Submitted jobs sizes: #" << List2Str(this->jobs_submitted_numel_) << "#"
-        << "\n    Submitted jobs sizes distribution: #" << DescribeIntList(this->jobs_submitted_numel_) << "#"
+        << "\n    Submitted jobs: #" << jobs_submitted_num << "#"
+        << "\n    Submitted jobs sizes distribution: #" << jobs_submitted_numel_description << "#"
+        << "\n    Submitted jobs sizes histogram: #" << jobs_submitted_numel_histogram.str() << "#"
         << "\n    Finished jobs: #" << this->jobs_finished_num_ << "#"
+        << "\n    Finished jobs with deadlines: #" << this->deadline_jobs_finished_num_ << "#"
+        << "\n    Deadline misses: #" << this->deadline_misses_lateness_us_.size() << "#"
+        << "\n    Deadline misses lateness (us) distribution: #" << DescribeFloatList(this->deadline_misses_lateness_us_) << "#"
     ;
 
     // Add per worker stats
@@ -100,8 +125,15 @@ void Stats::LogStats() {
 void Stats::ResetStats() {
     // Clear global stats
     this->jobs_submitted_num_ = 0;
-    this->jobs_submitted_numel_.clear();
+    this->jobs_submitted_numel_sum_ = 0;
+    this->jobs_submitted_numel_max_ = 0;
+    this->jobs_submitted_numel_min_ = UINT64_MAX;
+    for(std::atomic<uint64_t>& bucket : this->jobs_submitted_numel_histogram_) {
+        bucket = 0;
+    }
     this->jobs_finished_num_ = 0;
+    this->deadline_jobs_finished_num_ = 0;
+    this->deadline_misses_lateness_us_.clear();
 
     // Clear worker thread stats
     for (WorkerTid i = 0; i < this->num_worker_threads_; i++)
@@ -115,34 +147,6 @@ void Stats::ResetStats() {
     }
 }
 
-std::string Stats::DescribeIntList(std::vector<uint64_t> list) {
-    if(list.size() == 0) {
-        return "";
-    }
-    // Sum
-    uint64_t sum = std::accumulate(list.begin(), list.end(), (uint64_t)0);
-    // Mean
-    double mean = sum / list.size();
-    // Max
-    uint64_t max = *std::max_element(list.begin(), list.end());
-    // Min
-    uint64_t min = *std::min_element(list.begin(), list.end());
-    // Median
-    size_t median_idx = list.size() / 2;
-    std::nth_element(list.begin(), list.begin() + median_idx, list.end());
-    uint64_t median = list[median_idx];
-    // Standard deviation
-    std::vector<double> diff(list.size());
-    std::transform(list.begin(), list.end(), diff.begin(), [mean](double x) { return x - mean; });
-    double sq_sum = std::inner_product(diff.begin(), diff.end(), diff.begin(), 0.0);
-    double std_dev = std::sqrt(sq_sum / double(list.size()));
-
-    char buffer[200];
-    sprintf(buffer, "Sum: %-10ld Mean: %-10.4f Max: %-10ld Min: %-10ld Median: %-10ld Stdev: %-10.4f",
-            sum, mean, max, min, median, std_dev);
-    return std::string(buffer);
-}
-
 std::string Stats::DescribeFloatList(std::vector<double> list) {
     if(list.size() == 0) {
         return "";
@@ -171,18 +175,4 @@ std::string Stats::DescribeFloatList(std::vector<double> list) {
     return std::string(buffer);
 }
 
-template<typename T>
-std::string Stats::List2Str(std::vector<T> list) {
-    std::ostringstream output;
-    output << "[";
-    for(size_t i = 0; i < list.size(); i++) {
-        output << list[i] << ",";
-    }
-    output << "]";
-    return output.str();
-}
-
-template std::string Stats::List2Str(std::vector<uint64_t> list);
-template std::string Stats::List2Str(std::vector<double> list);
-
 } // namespace switchml
\ No newline at end of file
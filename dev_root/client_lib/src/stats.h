@@ -24,7 +24,9 @@
 #define SWITCHML_STATISTICS_H_
 
 #include <vector>
+#include <atomic>
 #include <string>
+#include <chrono>
 
 #include "common.h"
 
@@ -79,16 +81,6 @@ class Stats {
      */
     void ResetStats();
 
-    /**
-     * @brief Describe the distribution of a list of integers.
-     * 
-     * Computes sum, mean, max, min, median, stdev
-     * 
-     * @param list The list of integers to describe
-     * @return std::string a single line with all of the metrics.
-     */
-    std::string DescribeIntList(std::vector<uint64_t> list);
-
     /**
      * @brief Describe the distribution of a list of doubles.
      * 
@@ -99,27 +91,42 @@ class Stats {
      */
     std::string DescribeFloatList(std::vector<double> list);
 
-    template<typename T>
-    /**
-     * @brief Create a string representation of a list.
-     * 
-     * @param list The vector representing the list
-     * @return std::string A single line with all of the elements
-     */
-    std::string List2Str(std::vector<T> list);
+    // The submission stats are updated by the submitting threads without holding any lock
+    // so they are kept in atomics rather than in a list of all job sizes.
 
     inline void IncJobsSubmittedNum() {
-        this->jobs_submitted_num_++;
+        this->jobs_submitted_num_.fetch_add(1, std::memory_order_relaxed);
     }
 
     inline void AppendJobSubmittedNumel(uint64_t size) {
-        this->jobs_submitted_numel_.push_back(size);
+        this->jobs_submitted_numel_sum_.fetch_add(size, std::memory_order_relaxed);
+        uint64_t current = this->jobs_submitted_numel_max_.load(std::memory_order_relaxed);
+        while(size > current && !this->jobs_submitted_numel_max_.compare_exchange_weak(current, size, std::memory_order_relaxed));
+        current = this->jobs_submitted_numel_min_.load(std::memory_order_relaxed);
+        while(size < current && !this->jobs_submitted_numel_min_.compare_exchange_weak(current, size, std::memory_order_relaxed));
+        this->jobs_submitted_numel_histogram_[Log2Bucket(size)].fetch_add(1, std::memory_order_relaxed);
     }
 
     inline void IncJobsFinishedNum() {
         this->jobs_finished_num_++;
     }
 
+    inline void AddJobsFinishedNum(uint64_t to_add) {
+        this->jobs_finished_num_ += to_add;
+    }
+
+    /**
+     * @brief Record that a job with a deadline has finished.
+     * 
+     * @param [in] lateness How long after its deadline the job finished. Negative if the job made its deadline.
+     */
+    inline void AddDeadlineJobFinished(clock::duration lateness) {
+        this->deadline_jobs_finished_num_++;
+        if(lateness > clock::duration::zero()) {
+            this->deadline_misses_lateness_us_.push_back(std::chrono::duration<double, std::micro>(lateness).count());
+        }
+    }
+
     inline void AddTotalPktsSent(WorkerTid wtid, uint64_t to_add) {
         this->total_pkts_sent_[wtid] += to_add;
     }
@@ -140,18 +147,43 @@ class Stats {
     
 
   private:
+    /**
+     * @brief Get the histogram bucket of a job size.
+     * 
+     * @param [in] size The job size.
+     * @return int floor(log2(size)) or 0 if size is 0.
+     */
+    static inline int Log2Bucket(uint64_t size) {
+        return size == 0 ? 0 : 63 - __builtin_clzll(size);
+    }
+
     /** The number of worker threads in the configuration */
     WorkerTid num_worker_threads_;
 
     /** The total number of jobs submitted to the context */
-    uint64_t jobs_submitted_num_;
+    std::atomic<uint64_t> jobs_submitted_num_;
+
+    /** The sum of all the job sizes submitted to the context */
+    std::atomic<uint64_t> jobs_submitted_numel_sum_;
+
+    /** The largest job size submitted to the context */
+    std::atomic<uint64_t> jobs_submitted_numel_max_;
 
-    /** A list of all the job sizes submitted to the context */
-    std::vector<uint64_t> jobs_submitted_numel_;
+    /** The smallest job size submitted to the context */
+    std::atomic<uint64_t> jobs_submitted_numel_min_;
+
+    /** How many submitted jobs had sizes in [2^i, 2^(i+1)) for each i (Sizes of 0 are counted with 1). */
+    std::atomic<uint64_t> jobs_submitted_numel_histogram_[64];
 
     /** The total number of jobs finished */
     uint64_t jobs_finished_num_;
 
+    /** The number of finished jobs that had a deadline */
+    uint64_t deadline_jobs_finished_num_;
+
+    /** How late in microseconds each job that missed its deadline was. Its size is the number of deadline misses. */
+    std::vector<double> deadline_misses_lateness_us_;
+
     // What follows are per worker thread statistics so we use an array to keep the stats
     // stat_name[0] for worker thread 0 stat_name[1] for worker thread 1 and so on.
 
@@ -24,6 +24,9 @@
 #define SWITCHML_UTILS_H_
 
 #include <mutex>
+#include <atomic>
+#include <memory>
+#include <vector>
 #include <condition_variable>
 
 #include "common.h"
@@ -80,6 +83,364 @@ class Barrier {
     bool flag_;
 };
 
+/**
+ * @brief A standard allocator that recycles single objects through free lists instead of returning them to the heap.
+ * 
+ * All allocators of the same type share the same free lists which live for the whole process so objects allocated with it
+ * can safely outlive the context. Use it with std::allocate_shared so that the object and its control block are recycled together.
+ * The free lists only grow up to the largest number of objects that were alive at the same time so once the pool is warm
+ * allocations no longer touch the heap. Arrays are still allocated from the heap.
+ * 
+ * It is lock free. Each thread allocates from its own free list. Freed objects are pushed to a shared free list
+ * (Objects are often freed by a different thread than the one that allocated them) and a thread whose own
+ * free list is empty takes the whole shared free list at once. Since nothing is ever popped from the shared free list,
+ * this is not affected by the ABA problem.
+ * 
+ * @tparam T The type of the objects to allocate.
+ */
+template <typename T>
+class PoolAllocator {
+  public:
+    typedef T value_type;
+
+    PoolAllocator() = default;
+
+    template <typename U>
+    PoolAllocator(const PoolAllocator<U>&) {}
+
+    /**
+     * @brief Take storage for n objects from the free lists (Or from the heap if they are empty or n is not 1).
+     * 
+     * @param [in] n The number of objects.
+     * @return T* A pointer to uninitialized storage.
+     */
+    T* allocate(std::size_t n) {
+        if(n != 1) {
+            return static_cast<T*>(::operator new(n * sizeof(T)));
+        }
+        ThreadFreeList& thread_free_list = GetThreadFreeList();
+        if(thread_free_list.head == nullptr) {
+            thread_free_list.head = GetSharedFreeList().exchange(nullptr, std::memory_order_acquire);
+        }
+        if(thread_free_list.head != nullptr) {
+            Block* block = thread_free_list.head;
+            thread_free_list.head = block->next;
+            return reinterpret_cast<T*>(block);
+        }
+        return reinterpret_cast<T*>(new Block);
+    }
+
+    /**
+     * @brief Give the storage of n objects back to the shared free list (Or to the heap if n is not 1).
+     * 
+     * @param [in] ptr The storage returned by allocate().
+     * @param [in] n The number of objects that was passed to allocate().
+     */
+    void deallocate(T* ptr, std::size_t n) {
+        if(n != 1) {
+            ::operator delete(ptr);
+            return;
+        }
+        Block* block = reinterpret_cast<Block*>(ptr);
+        Push(block, block);
+    }
+
+    template <typename U>
+    bool operator==(const PoolAllocator<U>&) const { return true; }
+
+    template <typename U>
+    bool operator!=(const PoolAllocator<U>&) const { return false; }
+
+  private:
+    /** Storage for a single object that links to the next free block while it is unused. */
+    union Block {
+        Block* next;
+        alignas(T) unsigned char storage[sizeof(T)];
+    };
+
+    /** The free blocks that only the owning thread allocates from. */
+    struct ThreadFreeList {
+        Block* head = nullptr;
+
+        /** Give the blocks back to the shared free list when the thread exits so that other threads can use them. */
+        ~ThreadFreeList() {
+            if(this->head != nullptr) {
+                Block* last = this->head;
+                while(last->next != nullptr) {
+                    last = last->next;
+                }
+                Push(this->head, last);
+            }
+        }
+    };
+
+    /**
+     * @brief Push a linked list of blocks to the shared free list.
+     * 
+     * @param [in] first The first block of the list.
+     * @param [in] last The last block of the list.
+     */
+    static void Push(Block* first, Block* last) {
+        std::atomic<Block*>& shared_free_list = GetSharedFreeList();
+        last->next = shared_free_list.load(std::memory_order_relaxed);
+        while(!shared_free_list.compare_exchange_weak(last->next, first, std::memory_order_release, std::memory_order_relaxed));
+    }
+
+    /**
+     * @brief Get the free list shared by all threads and allocators of this type.
+     * 
+     * It is never destroyed so that objects released during static destruction can still be returned to it.
+     */
+    static std::atomic<Block*>& GetSharedFreeList() {
+        static std::atomic<Block*>* shared_free_list = new std::atomic<Block*>(nullptr);
+        return *shared_free_list;
+    }
+
+    /**
+     * @brief Get the calling thread's free list for this type.
+     */
+    static ThreadFreeList& GetThreadFreeList() {
+        thread_local ThreadFreeList thread_free_list;
+        return thread_free_list;
+    }
+};
+
+/**
+ * @brief A FIFO queue stored in a ring buffer.
+ * 
+ * Unlike std::queue on top of std::deque, pushing and popping do not allocate or free any memory
+ * unless the queue grows past its largest size so far (In which case the buffer's capacity is doubled).
+ * It is not thread safe.
+ * 
+ * @tparam T The type of the queued elements.
+ */
+template <typename T>
+class RingQueue {
+  public:
+    /**
+     * @brief Construct a new RingQueue object.
+     * 
+     * @param [in] initial_capacity How many elements the queue can hold before it has to grow. Rounded up to a power of 2.
+     */
+    RingQueue(size_t initial_capacity = 64) : buffer_(), head_(0), size_(0) {
+        size_t capacity = 1;
+        while(capacity < initial_capacity) {
+            capacity <<= 1;
+        }
+        this->buffer_.resize(capacity);
+    }
+
+    inline bool empty() const { return this->size_ == 0; }
+
+    inline size_t size() const { return this->size_; }
+
+    inline T& front() { return this->buffer_[this->head_]; }
+
+    inline T& back() { return this->buffer_[(this->head_ + this->size_ - 1) & (this->buffer_.size() - 1)]; }
+
+    /**
+     * @brief Add an element to the back of the queue.
+     * 
+     * @param [in] value The element to add.
+     */
+    void push_back(T value) {
+        if(this->size_ == this->buffer_.size()) {
+            // Grow by moving the elements in order to the start of a buffer with double the capacity.
+            std::vector<T> buffer(this->buffer_.size() * 2);
+            for(size_t i = 0; i < this->size_; i++) {
+                buffer[i] = std::move(this->buffer_[(this->head_ + i) & (this->buffer_.size() - 1)]);
+            }
+            this->buffer_.swap(buffer);
+            this->head_ = 0;
+        }
+        this->buffer_[(this->head_ + this->size_) & (this->buffer_.size() - 1)] = std::move(value);
+        this->size_++;
+    }
+
+    /**
+     * @brief Remove the element at the front of the queue.
+     * 
+     * The element's slot is reset so that it does not keep any resources alive.
+     */
+    void pop_front() {
+        this->buffer_[this->head_] = T();
+        this->head_ = (this->head_ + 1) & (this->buffer_.size() - 1);
+        this->size_--;
+    }
+
+    /**
+     * @brief Remove all elements from the queue.
+     */
+    void clear() {
+        while(!this->empty()) {
+            this->pop_front();
+        }
+    }
+
+  private:
+    /** The ring buffer. Its size is always a power of 2. */
+    std::vector<T> buffer_;
+
+    /** The index of the front of the queue in the buffer */
+    size_t head_;
+
+    /** The number of elements in the queue */
+    size_t size_;
+};
+
+/**
+ * @brief A bounded lock free FIFO queue for many producer threads and a single consumer thread.
+ * 
+ * Each slot has a sequence number that tells producers whether it is free and the consumer whether it holds an element
+ * so producers only contend on the tail index and never on the consumer.
+ * 
+ * @tparam T The type of the queued elements.
+ */
+template <typename T>
+class MpscQueue {
+  public:
+    /**
+     * @brief Construct a new MpscQueue object.
+     * 
+     * @param [in] capacity How many elements the queue can hold. Rounded up to a power of 2.
+     */
+    MpscQueue(size_t capacity = 4096) : slots_(), mask_(0), head_(0), tail_(0) {
+        size_t rounded_capacity = 1;
+        while(rounded_capacity < capacity) {
+            rounded_capacity <<= 1;
+        }
+        this->slots_.reset(new Slot[rounded_capacity]);
+        this->mask_ = rounded_capacity - 1;
+        for(size_t i = 0; i < rounded_capacity; i++) {
+            this->slots_[i].sequence.store(i, std::memory_order_relaxed);
+        }
+    }
+
+    MpscQueue(MpscQueue const&) = delete;
+    void operator=(MpscQueue const&) = delete;
+
+    /**
+     * @brief Add an element to the back of the queue. Can be called by any number of threads concurrently.
+     * 
+     * @param [in] value The element to add.
+     * @return true if the element was added.
+     * @return false if the queue is full.
+     */
+    bool TryPush(T& value) {
+        size_t position = this->tail_.load(std::memory_order_relaxed);
+        Slot* slot;
+        while(true) {
+            slot = &this->slots_[position & this->mask_];
+            intptr_t difference = (intptr_t) slot->sequence.load(std::memory_order_acquire) - (intptr_t) position;
+            if(difference == 0) {
+                // The slot is free. Try to claim it.
+                if(this->tail_.compare_exchange_weak(position, position + 1, std::memory_order_relaxed)) {
+                    break;
+                }
+            } else if(difference < 0) {
+                // The slot still holds an element from the previous round so the queue is full.
+                return false;
+            } else {
+                // Another producer claimed the slot first.
+                position = this->tail_.load(std::memory_order_relaxed);
+            }
+        }
+        slot->value = std::move(value);
+        slot->sequence.store(position + 1, std::memory_order_release);
+        return true;
+    }
+
+    /**
+     * @brief Remove the element at the front of the queue. Must only be called by the consumer thread.
+     * 
+     * @param [out] value Where to move the element to.
+     * @return true if an element was removed.
+     * @return false if the queue is empty (Or the producer of the front element has not finished adding it yet).
+     */
+    bool TryPop(T& value) {
+        Slot& slot = this->slots_[this->head_ & this->mask_];
+        if(slot.sequence.load(std::memory_order_acquire) != this->head_ + 1) {
+            return false;
+        }
+        value = std::move(slot.value);
+        slot.value = T();
+        slot.sequence.store(this->head_ + this->mask_ + 1, std::memory_order_release);
+        this->head_++;
+        return true;
+    }
+
+    /**
+     * @brief Check whether the queue has no element ready to be removed. Must only be called by the consumer thread.
+     */
+    bool Empty() const {
+        return this->slots_[this->head_ & this->mask_].sequence.load(std::memory_order_acquire) != this->head_ + 1;
+    }
+
+  private:
+    /** A single element and its sequence number. */
+    struct Slot {
+        std::atomic<size_t> sequence;
+        T value;
+    };
+
+    /** The ring buffer of slots. */
+    std::unique_ptr<Slot[]> slots_;
+
+    /** The capacity of the ring buffer minus 1 */
+    size_t mask_;
+
+    /** The position of the front of the queue. Only accessed by the consumer thread. */
+    size_t head_;
+
+    /** The position where the next element will be added. It is on its own cache line since all producers update it. */
+    alignas(64) std::atomic<size_t> tail_;
+};
+
+/**
+ * @brief Tell the CPU that we are in a spin loop.
+ * 
+ * This lowers the power used by spinning and frees up resources for the other hyperthread of the core.
+ */
+inline void CpuRelax() {
+#if defined(__x86_64__) || defined(__i386__)
+    __builtin_ia32_pause();
+#elif defined(__aarch64__)
+    asm volatile("yield");
+#endif
+}
+
+/**
+ * @brief Spin until a predicate becomes true as allowed by a wait policy.
+ * 
+ * The caller should block if this returns false.
+ * 
+ * @param [in] wait_policy How to wait. BLOCK does not spin at all, SPIN_THEN_BLOCK spins for up to spin_duration
+ * and BUSY_POLL spins until the predicate becomes true. It must not be DEFAULT_WAIT.
+ * @param [in] spin_duration The maximum time to spin for when using SPIN_THEN_BLOCK.
+ * @param [in] predicate The condition to wait for.
+ * @return true if the predicate became true.
+ * @return false if the caller should block.
+ */
+template <typename Predicate>
+inline bool SpinWait(WaitPolicy wait_policy, clock::duration spin_duration, Predicate predicate) {
+    if(wait_policy == WaitPolicy::BLOCK) {
+        return false;
+    }
+    clock::time_point end = clock::now() + spin_duration;
+    while(true) {
+        // Only check the clock every few iterations since reading it is slower than a pause.
+        for(int i = 0; i < 64; i++) {
+            if(predicate()) {
+                return true;
+            }
+            CpuRelax();
+        }
+        if(wait_policy != WaitPolicy::BUSY_POLL && clock::now() >= end) {
+            return false;
+        }
+    }
+}
+
 /**
  * @brief A function to execute any command on the system and return the standard output as a string.
  * 